@@ -0,0 +1,142 @@
+#pragma once
+
+#include <math.h>
+
+namespace Fractal
+{
+	// 32 bit limbs, the most significant one is the integer part
+	// 23 fractional limbs keep 736 bits after the point, enough for zooms around 1e-200
+	const unsigned int big_limbs = 24;
+
+	// Fixed point number, slow but as precise as needed
+	// Only the reference orbits of zooms too deep for quad-double use it, every other pixel is computed in double
+	// Stored in two's complement, the integer part must stay within 32 bits which orbits that haven't escaped always do
+	class BigFixed
+	{
+	private:
+		unsigned int limb[big_limbs];	// Least significant first
+
+		inline bool Negative() const
+		{
+			return (limb[big_limbs - 1] & 0x80000000u) != 0;
+		}
+		inline BigFixed Magnitude() const
+		{
+			return Negative() ? -*this : *this;
+		}
+	public:
+		BigFixed()
+		{
+			for (unsigned int i = 0; i < big_limbs; i++) limb[i] = 0;
+		}
+		// Exact, a double is a fixed point number with at most 53 significant bits
+		BigFixed(double value)
+		{
+			for (unsigned int i = 0; i < big_limbs; i++) limb[i] = 0;
+			bool negative = value < 0.0;
+			double magnitude = fabs(value);
+			double integer = floor(magnitude);
+			limb[big_limbs - 1] = (unsigned int)integer;
+			double fraction = magnitude - integer;
+			for (unsigned int i = big_limbs - 1; i-- > 0 && fraction != 0.0;)
+			{
+				fraction *= 4294967296.0;
+				double digit = floor(fraction);
+				limb[i] = (unsigned int)digit;
+				fraction -= digit;
+			}
+			if (negative) *this = -*this;
+		}
+
+		inline double ToDouble() const
+		{
+			BigFixed magnitude = Magnitude();
+			// Only the 4 limbs from the most significant one that isn't zero reach the 53 bits of a double,
+			// small numbers keep their precision which splitting into double-double / quad-double relies on
+			unsigned int top = big_limbs - 1;
+			while (top > 3 && magnitude.limb[top] == 0) top--;
+			double value = 0.0;
+			for (unsigned int i = top - 3; i <= top; i++)
+				value += ldexp(double(magnitude.limb[i]), 32 * (int(i) - int(big_limbs - 1)));
+			return Negative() ? -value : value;
+		}
+
+		inline BigFixed operator-() const
+		{
+			BigFixed result;
+			unsigned long long carry = 1;
+			for (unsigned int i = 0; i < big_limbs; i++)
+			{
+				carry += (unsigned int)~limb[i];
+				result.limb[i] = (unsigned int)carry;
+				carry >>= 32;
+			}
+			return result;
+		}
+
+		inline BigFixed operator+(const BigFixed& B) const
+		{
+			BigFixed result;
+			unsigned long long carry = 0;
+			for (unsigned int i = 0; i < big_limbs; i++)
+			{
+				carry += (unsigned long long)limb[i] + B.limb[i];
+				result.limb[i] = (unsigned int)carry;
+				carry >>= 32;
+			}
+			return result;
+		}
+
+		inline BigFixed operator-(const BigFixed& B) const
+		{
+			return *this + -B;
+		}
+
+		// Truncated to the precision of the operands
+		BigFixed operator*(const BigFixed& B) const
+		{
+			BigFixed a = Magnitude();
+			BigFixed b = B.Magnitude();
+			// Only the product limbs from big_limbs - 1 on are kept, the ones below only matter through their carries
+			unsigned int product[2 * big_limbs] = {};
+			for (unsigned int i = 0; i < big_limbs; i++)
+			{
+				if (a.limb[i] == 0) continue;
+				unsigned long long carry = 0;
+				for (unsigned int j = 0; j < big_limbs; j++)
+				{
+					carry += (unsigned long long)a.limb[i] * b.limb[j] + product[i + j];
+					product[i + j] = (unsigned int)carry;
+					carry >>= 32;
+				}
+				product[i + big_limbs] = (unsigned int)carry;
+			}
+
+			BigFixed result;
+			for (unsigned int i = 0; i < big_limbs; i++) result.limb[i] = product[i + big_limbs - 1];
+			return Negative() != B.Negative() ? -result : result;
+		}
+
+		inline void operator+=(const BigFixed& B)
+		{
+			*this = *this + B;
+		}
+
+		inline void operator-=(const BigFixed& B)
+		{
+			*this = *this - B;
+		}
+
+		inline bool operator==(const BigFixed& B) const
+		{
+			for (unsigned int i = 0; i < big_limbs; i++)
+				if (limb[i] != B.limb[i]) return false;
+			return true;
+		}
+
+		inline bool operator!=(const BigFixed& B) const
+		{
+			return !(*this == B);
+		}
+	};
+};
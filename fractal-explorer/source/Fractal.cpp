@@ -1,16 +1,40 @@
 #include "Fractal.h"
 #include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
 
-Fractal::Fractal::Fractal(unsigned int vpWidth, unsigned int vpHeight, unsigned short max_iterations, D3DCOLOR* pRenderTarget, bool autoAnimate) : max_iterations(max_iterations), animationState(true)
+Fractal::Fractal::Fractal(unsigned int vpWidth, unsigned int vpHeight, unsigned short max_iterations, D3DCOLOR* pRenderTarget, bool autoAnimate) : max_iterations(max_iterations < max_iterations_limit ? max_iterations : max_iterations_limit), animationState(true), pool(1)
 {
 	// Initialize fields
 	fractal = pRenderTarget;
 	this->autoAnimate = autoAnimate;
+	interiorShortcuts = true;
+	smoothColoring = false;
+	singlePrecision = false;
+	skippedIterations = 0;
+	renderMode = RENDER_PIXELS;
+	filledPixels = 0;
+	perturbation = false;
+	seriesApproximation = true;
+	seriesSkip = 0;
+	referencePrecision = REFERENCE_DOUBLE_DOUBLE;
+	frameValid = false;
+	panX = 0.0;
+	panY = 0.0;
+	reusedPixels = 0;
+	frameBudget = 0.0;
 	cursorPosition = 0;
+	kernelLevelSupported = DetectKernelLevel();
+	kernelLevel = kernelLevelSupported;
 	// Initial viewport
 	pxViewportWidth = vpWidth;
 	pxViewportHeight = vpHeight;
 	pxViewportArea = vpWidth * vpHeight;
+	frame.resize(pxViewportArea);
+	frameFractions.resize(pxViewportArea);
+	tileStride.resize(((vpWidth + tile_size - 1) / tile_size) * ((vpHeight + tile_size - 1) / tile_size));
 
 	// Pixel LUT
 	pxLUT = new PixelLUT[vpWidth * vpHeight];
@@ -46,11 +70,15 @@ void Fractal::Fractal::Scale(double zoom, Ved2 region)
 void Fractal::Fractal::TranslateY(double dy)
 {
 	normalizer.oy += normalizer.dy * dy;
+	originY -= BigFixed(normalizer.dy * dy);
+	panY += dy * pxViewportHeight;
 }
 
 void Fractal::Fractal::TranslateX(double dx)
 {
 	normalizer.ox += normalizer.dx * dx;
+	originX -= BigFixed(normalizer.dx * dx);
+	panX += dx * pxViewportWidth;
 }
 
 void Fractal::Fractal::AnimateColor(unsigned short offset)
@@ -63,4 +91,540 @@ void Fractal::Fractal::Reset()
 {
 	vp = vp_rst;
 	normalizer = normalizer_rst;
+	originX = BigFixed(-normalizer.ox);
+	originY = BigFixed(-normalizer.oy);
+	frameValid = false;
+}
+
+void Fractal::Fractal::SetKernelLevel(KernelLevel level)
+{
+	kernelLevel = level < kernelLevelSupported ? level : kernelLevelSupported;
+	frameValid = false;
+}
+
+Fractal::KernelLevel Fractal::Fractal::GetKernelLevel() const
+{
+	return kernelLevel;
+}
+
+const Fractal::ThreadPool& Fractal::Fractal::GetThreadPool() const
+{
+	return pool;
+}
+
+unsigned long long Fractal::Fractal::GetSkippedIterations() const
+{
+	return skippedIterations;
+}
+
+void Fractal::Fractal::SetRenderMode(RenderMode mode)
+{
+	renderMode = mode;
+	frameValid = false;
+}
+
+Fractal::RenderMode Fractal::Fractal::GetRenderMode() const
+{
+	return renderMode;
+}
+
+unsigned int Fractal::Fractal::GetFilledPixels() const
+{
+	return filledPixels;
+}
+
+bool Fractal::Fractal::UsesPerturbation() const
+{
+	return perturbation;
+}
+
+unsigned int Fractal::Fractal::GetSeriesSkip() const
+{
+	return seriesSkip;
+}
+
+Fractal::ReferencePrecision Fractal::Fractal::GetReferencePrecision() const
+{
+	return referencePrecision;
+}
+
+unsigned int Fractal::Fractal::GetReusedPixels() const
+{
+	return reusedPixels;
+}
+
+void Fractal::Fractal::SetFrameBudget(double seconds)
+{
+	frameBudget = seconds;
+}
+
+double Fractal::Fractal::GetFrameBudget() const
+{
+	return frameBudget;
+}
+
+unsigned int Fractal::Fractal::GetRefinement() const
+{
+	unsigned int coarsest = 1;
+	for (unsigned char stride : tileStride)
+		coarsest = stride > coarsest ? stride : coarsest;
+	return coarsest;
+}
+
+// Same orbit in any of the precise number types
+template <typename Number>
+static void IterateReference(const Fractal::BigFixed& x, const Fractal::BigFixed& y, const Fractal::EscapeParams& params, std::vector<double>& referenceR, std::vector<double>& referenceI)
+{
+	Number zr = params.julia ? Number(x) : Number(0.0);
+	Number zi = params.julia ? Number(y) : Number(0.0);
+	Number cr = params.julia ? Number(params.cr) : Number(x);
+	Number ci = params.julia ? Number(params.ci) : Number(y);
+	referenceR.clear();
+	referenceI.clear();
+	referenceR.push_back(zr.ToDouble());
+	referenceI.push_back(zi.ToDouble());
+	for (unsigned short k = 0; k < params.max_iterations; k++)
+	{
+		Number zr2 = zr * zr;
+		Number zi2 = zi * zi;
+		if ((zr2 + zi2).ToDouble() > Fractal::bailout_sq) break;
+		Number zri = zr * zi;
+		zi = zri + zri + ci;
+		zr = zr2 - zi2 + cr;
+		referenceR.push_back(zr.ToDouble());
+		referenceI.push_back(zi.ToDouble());
+	}
+}
+
+void Fractal::Fractal::ComputeReference(const EscapeParams& params, double dx, double dy)
+{
+	BigFixed x = originX + BigFixed(dx * (pxViewportWidth / 2));
+	BigFixed y = originY + BigFixed(dy * (pxViewportHeight / 2));
+	double spacing = fmin(fabs(dx), fabs(dy));
+	ReferencePrecision precision = spacing > double_double_limit ? REFERENCE_DOUBLE_DOUBLE : spacing > quad_double_limit ? REFERENCE_QUAD_DOUBLE : REFERENCE_BIG_FIXED;
+	if (!referenceR.empty() && x == referenceX && y == referenceY && precision == referencePrecision && params.max_iterations == referenceParams.max_iterations &&
+		params.julia == referenceParams.julia && params.cr == referenceParams.cr && params.ci == referenceParams.ci)
+		return;
+	referenceX = x;
+	referenceY = y;
+	referenceParams = params;
+	referencePrecision = precision;
+
+	switch (precision)
+	{
+	case REFERENCE_DOUBLE_DOUBLE:
+		IterateReference<DoubleDouble>(x, y, params, referenceR, referenceI);
+		break;
+	case REFERENCE_QUAD_DOUBLE:
+		IterateReference<QuadDouble>(x, y, params, referenceR, referenceI);
+		break;
+	default:
+		IterateReference<BigFixed>(x, y, params, referenceR, referenceI);
+		break;
+	}
+}
+
+void Fractal::Fractal::ComputeSeries(Reference& reference, const EscapeParams& params, double dx, double dy)
+{
+	// A' = 2 * Z * A + 1 (Mandelbrot) or 2 * Z * A (Julia, where A starts at 1), B' = 2 * Z * B + A^2, C' = 2 * Z * C + 2 * A * B
+	Complex A(params.julia ? 1.0 : 0.0);
+	Complex B;
+	Complex C;
+	Complex one(params.julia ? 0.0 : 1.0);
+	reference.skip = 0;
+	if (seriesApproximation)
+	{
+		// The corners are the pixels furthest from the reference, their offsets are iterated exactly to check the series
+		double left = -dx * (pxViewportWidth / 2);
+		double top = -dy * (pxViewportHeight / 2);
+		double right = left + dx * (pxViewportWidth - 1);
+		double bottom = top + dy * (pxViewportHeight - 1);
+		Complex corners[4] = { Complex(left, top), Complex(right, top), Complex(left, bottom), Complex(right, bottom) };
+		Complex offsets[4];
+		double radius = 0.0;
+		for (unsigned int p = 0; p < 4; p++)
+		{
+			offsets[p] = params.julia ? corners[p] : Complex();
+			radius = corners[p].abs() > radius ? corners[p].abs() : radius;
+		}
+		// An error E in dz is the same as moving the pixel by E / |A|, which must stay a fraction of a pixel
+		double pixel = fabs(dx) < fabs(dy) ? fabs(dx) : fabs(dy);
+		double tolerance = series_tolerance * pixel;
+
+		for (unsigned int n = 0; n + 2 < reference.length; n++)
+		{
+			Complex Z(reference.zr[n], reference.zi[n]);
+			Complex Z2 = Z + Z;
+			Complex AA = A * A;
+			Complex AB = A * B;
+			Complex nextA = Z2 * A + one;
+			Complex nextB = Z2 * B + AA;
+			Complex nextC = Z2 * C + AB + AB;
+			double limit = tolerance * nextA.abs();
+
+			// The first term left out is about the size of the last one kept
+			bool valid = nextC.abs() * radius * radius * radius <= limit;
+			Complex next(reference.zr[n + 1], reference.zi[n + 1]);
+			for (unsigned int p = 0; p < 4 && valid; p++)
+			{
+				Complex d = corners[p];
+				Complex dc = params.julia ? Complex() : d;
+				Complex square = offsets[p].sq();
+				offsets[p] = Z2 * offsets[p] + square + dc;
+
+				Complex d2 = d.sq();
+				Complex d3 = d2 * d;
+				Complex termB = nextB * d2;
+				Complex termC = nextC * d3;
+				Complex series = nextA * d + termB + termC;
+				Complex error = series - offsets[p];
+				// Pixels that would have to be rebased by then can't start from the series
+				Complex pixelZ = next + offsets[p];
+				valid = error.abs() <= limit && pixelZ.abs() >= offsets[p].abs();
+			}
+			if (!valid) break;
+			A = nextA;
+			B = nextB;
+			C = nextC;
+			reference.skip = n + 1;
+		}
+	}
+	reference.ar = A.real;
+	reference.ai = A.img;
+	reference.br = B.real;
+	reference.bi = B.img;
+	reference.cr = C.real;
+	reference.ci = C.img;
+	seriesSkip = reference.skip;
+}
+
+// Iterates count pixels of a tile row, starting at column x and stride columns apart
+static void ComputeRow(Fractal::Tile& tile, unsigned int x, unsigned int y, unsigned int count, unsigned int stride = 1)
+{
+	Fractal::Span span = { tile.x0, tile.dx, tile.y0 + tile.dy * (tile.top + y), 0.0, tile.left + x, count, stride };
+	unsigned short* iterations = tile.iterations + y * Fractal::tile_size + x;
+	unsigned char* fractions = tile.fractions + y * Fractal::tile_size + x;
+	if (stride == 1)
+	{
+		tile.skipped += tile.kernel(*tile.params, span, iterations, fractions);
+		return;
+	}
+	unsigned short samples[Fractal::tile_size];
+	unsigned char sampleFractions[Fractal::tile_size];
+	tile.skipped += tile.kernel(*tile.params, span, samples, sampleFractions);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		iterations[i * stride] = samples[i];
+		fractions[i * stride] = sampleFractions[i];
+	}
+}
+
+// Columns are computed as vertical spans, so they are as wide as rows for the vector kernels
+static void ComputeColumn(Fractal::Tile& tile, unsigned int x, unsigned int y, unsigned int count)
+{
+	unsigned short column[Fractal::tile_size];
+	unsigned char columnFractions[Fractal::tile_size];
+	Fractal::Span span = { tile.x0 + tile.dx * (tile.left + x), 0.0, tile.y0, tile.dy, tile.top + y, count, 1 };
+	tile.skipped += tile.kernel(*tile.params, span, column, columnFractions);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		tile.iterations[(y + i) * Fractal::tile_size + x] = column[i];
+		tile.fractions[(y + i) * Fractal::tile_size + x] = columnFractions[i];
+	}
+}
+
+void Fractal::Fractal::ScrollFrame(int shiftX, int shiftY)
+{
+	unsigned int width = pxViewportWidth - abs(shiftX);
+	unsigned int height = pxViewportHeight - abs(shiftY);
+	unsigned int toX = shiftX > 0 ? shiftX : 0;
+	unsigned int fromX = shiftX > 0 ? 0 : -shiftX;
+	// Moving down starts from the bottom row so that no row is overwritten before it's moved
+	for (unsigned int i = 0; i < height; i++)
+	{
+		unsigned int row = shiftY > 0 ? height - 1 - i : i;
+		unsigned int toY = shiftY > 0 ? row + shiftY : row;
+		unsigned int fromY = shiftY > 0 ? row : row - shiftY;
+		memmove(&frame[toY * pxViewportWidth + toX], &frame[fromY * pxViewportWidth + fromX], width * sizeof(unsigned short));
+		memmove(&frameFractions[toY * pxViewportWidth + toX], &frameFractions[fromY * pxViewportWidth + fromX], width);
+	}
+}
+
+void Fractal::Fractal::Subdivide(Tile& tile, unsigned int x, unsigned int y, unsigned int width, unsigned int height) const
+{
+	if (width < 3 || height < 3) return;
+
+	unsigned short* iterations = tile.iterations;
+	unsigned short border = iterations[y * tile_size + x];
+	bool uniform = true;
+	for (unsigned int i = x; i < x + width && uniform; i++)
+		uniform = iterations[y * tile_size + i] == border && iterations[(y + height - 1) * tile_size + i] == border;
+	for (unsigned int j = y + 1; j < y + height - 1 && uniform; j++)
+		uniform = iterations[j * tile_size + x] == border && iterations[j * tile_size + x + width - 1] == border;
+
+	// A small island inside the rectangle doesn't touch its border, strict mode looks for one at the center and the quarters
+	if (uniform && renderMode == RENDER_SUBDIVIDE_STRICT)
+	{
+		const unsigned int samples[5][2] = { { 2, 2 }, { 1, 1 }, { 3, 1 }, { 1, 3 }, { 3, 3 } };
+		for (unsigned int s = 0; s < 5 && uniform; s++)
+		{
+			unsigned int i = x + width * samples[s][0] / 4;
+			unsigned int j = y + height * samples[s][1] / 4;
+			ComputeRow(tile, i, j, 1);
+			uniform = iterations[j * tile_size + i] == border;
+		}
+	}
+
+	if (uniform)
+	{
+		// Filled pixels take the fraction of the corner, the border's fractions differ
+		unsigned char fraction = tile.fractions[y * tile_size + x];
+		for (unsigned int j = y + 1; j < y + height - 1; j++)
+			for (unsigned int i = x + 1; i < x + width - 1; i++)
+			{
+				iterations[j * tile_size + i] = border;
+				tile.fractions[j * tile_size + i] = fraction;
+			}
+		tile.filled += (width - 2) * (height - 2);
+	}
+	else if (width <= subdivide_min || height <= subdivide_min)
+	{
+		for (unsigned int j = y + 1; j < y + height - 1; j++)
+			ComputeRow(tile, x + 1, j, width - 2);
+	}
+	else if (width >= height)
+	{
+		// The dividing column is the shared border of both halves
+		unsigned int middle = x + width / 2;
+		ComputeColumn(tile, middle, y + 1, height - 2);
+		Subdivide(tile, x, y, middle - x + 1, height);
+		Subdivide(tile, middle, y, x + width - middle, height);
+	}
+	else
+	{
+		unsigned int middle = y + height / 2;
+		ComputeRow(tile, x + 1, middle, width - 2);
+		Subdivide(tile, x, y, width, middle - y + 1);
+		Subdivide(tile, x, middle, width, y + height - middle);
+	}
+}
+
+void Fractal::Fractal::Render(unsigned char nThreads, const EscapeParams& params)
+{
+	// Same mapping as normalizeX / normalizeY
+	double dx = normalizer.dx / pxViewportWidth;
+	double dy = normalizer.dy / pxViewportHeight;
+	// Rounding errors grow with every iteration, so the more iterations the further apart pixels have to be
+	double limit = single_precision_limit * params.max_iterations;
+	bool single = singlePrecision && fabs(dx) > limit && fabs(dy) > limit;
+	EscapeKernel kernel = SelectKernel(kernelLevel, single);
+
+	// Deep zooms iterate offsets from a reference orbit at the center of the viewport
+	EscapeParams escape = params;
+	Reference reference;
+	perturbation = fabs(dx) < perturbation_limit || fabs(dy) < perturbation_limit;
+	seriesSkip = 0;
+	if (perturbation)
+	{
+		ComputeReference(params, dx, dy);
+		reference.zr = referenceR.data();
+		reference.zi = referenceI.data();
+		reference.length = referenceR.size();
+		ComputeSeries(reference, params, dx, dy);
+		escape.reference = &reference;
+		// Periodicity compares the orbit with a tolerance far coarser than the pixels
+		escape.interior = false;
+		kernel = SelectPerturbationKernel(kernelLevel);
+	}
+
+	unsigned int tilesX = (pxViewportWidth + tile_size - 1) / tile_size;
+	unsigned int tilesY = (pxViewportHeight + tile_size - 1) / tile_size;
+	bool complete = true;
+	for (unsigned int index = 0; index < tilesX * tilesY; index++)
+		complete = complete && tileStride[index] == 1;
+
+	// The same view resumes the refinement of the last frame
+	// A pan by a whole number of pixels keeps every pixel that stays on screen, only the exposed strips are iterated
+	int shiftX = int(floor(panX + 0.5));
+	int shiftY = int(floor(panY + 0.5));
+	bool same = frameValid && dx == frameDx && dy == frameDy &&
+		params.max_iterations == frameParams.max_iterations && params.julia == frameParams.julia &&
+		params.cr == frameParams.cr && params.ci == frameParams.ci && params.interior == frameParams.interior && single == frameSingle &&
+		fabs(panX - shiftX) < pan_tolerance && fabs(panY - shiftY) < pan_tolerance;
+	bool scroll = same && (shiftX != 0 || shiftY != 0) && complete &&
+		unsigned(abs(shiftX)) < pxViewportWidth && unsigned(abs(shiftY)) < pxViewportHeight;
+	// Pixels in [keptLeft, keptRight) x [keptTop, keptBottom) come from the last frame
+	unsigned int keptLeft = 0;
+	unsigned int keptRight = 0;
+	unsigned int keptTop = 0;
+	unsigned int keptBottom = 0;
+	if (scroll)
+	{
+		ScrollFrame(shiftX, shiftY);
+		keptLeft = shiftX > 0 ? shiftX : 0;
+		keptRight = shiftX > 0 ? pxViewportWidth : pxViewportWidth + shiftX;
+		keptTop = shiftY > 0 ? shiftY : 0;
+		keptBottom = shiftY > 0 ? pxViewportHeight : pxViewportHeight + shiftY;
+		// The fraction of a pixel left over is carried, once it adds up the frame is rendered again
+		panX -= shiftX;
+		panY -= shiftY;
+		reusedPixels = (keptRight - keptLeft) * (keptBottom - keptTop);
+		// Tiles that were entirely on screen are done, the others start over
+		for (unsigned int index = 0; index < tilesX * tilesY; index++)
+		{
+			unsigned int x0 = (index % tilesX) * tile_size;
+			unsigned int y0 = (index / tilesX) * tile_size;
+			unsigned int x1 = x0 + tile_size < pxViewportWidth ? x0 + tile_size : pxViewportWidth;
+			unsigned int y1 = y0 + tile_size < pxViewportHeight ? y0 + tile_size : pxViewportHeight;
+			tileStride[index] = x0 >= keptLeft && x1 <= keptRight && y0 >= keptTop && y1 <= keptBottom ? 1 : 0;
+		}
+	}
+	else if (same && shiftX == 0 && shiftY == 0)
+	{
+		reusedPixels = pxViewportArea;
+	}
+	else
+	{
+		panX = 0.0;
+		panY = 0.0;
+		reusedPixels = 0;
+		for (unsigned int index = 0; index < tilesX * tilesY; index++)
+			tileStride[index] = 0;
+	}
+	frameValid = true;
+	frameParams = params;
+	frameDx = dx;
+	frameDy = dy;
+	frameSingle = single;
+
+	// Without a budget every tile is rendered at full resolution right away
+	unsigned int first = frameBudget > 0.0 ? progressive_stride : 1;
+	auto start = std::chrono::high_resolution_clock::now();
+	std::atomic<unsigned long long> skipped(0);
+	std::atomic<unsigned int> filled(0);
+	pool.Resize(nThreads);
+	pool.ClearStatistics();
+	for (unsigned int stride = first; stride >= 1; stride /= 2)
+	{
+		pool.Run(tilesX * tilesY, [&](unsigned int index, unsigned int worker)
+		{
+			// Tiles go through the passes in order, the coarsest one is always finished so that the whole view shows
+			unsigned char reached = tileStride[index];
+			if (reached == 0 ? stride != first : reached <= stride || (stride != first && reached != 2 * stride)) return;
+			if (stride != first && std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() > frameBudget) return;
+
+			unsigned int x0 = (index % tilesX) * tile_size;
+			unsigned int y0 = (index / tilesX) * tile_size;
+			unsigned int width = pxViewportWidth - x0 < tile_size ? pxViewportWidth - x0 : tile_size;
+			unsigned int height = pxViewportHeight - y0 < tile_size ? pxViewportHeight - y0 : tile_size;
+
+			Tile tile;
+			tile.kernel = kernel;
+			tile.params = &escape;
+			tile.x0 = perturbation ? -dx * (pxViewportWidth / 2) : -normalizer.ox;
+			tile.y0 = perturbation ? -dy * (pxViewportHeight / 2) : -normalizer.oy;
+			tile.dx = dx;
+			tile.dy = dy;
+			tile.left = x0;
+			tile.top = y0;
+			tile.skipped = 0;
+			tile.filled = 0;
+			// Samples of the coarser passes and pixels kept from the last frame
+			for (unsigned int y = 0; y < height; y++)
+			{
+				memcpy(tile.iterations + y * tile_size, &frame[(y0 + y) * pxViewportWidth + x0], width * sizeof(unsigned short));
+				memcpy(tile.fractions + y * tile_size, &frameFractions[(y0 + y) * pxViewportWidth + x0], width);
+			}
+
+			// Kept columns and rows, in tile coordinates
+			unsigned int left = keptLeft > x0 ? keptLeft - x0 < width ? keptLeft - x0 : width : 0;
+			unsigned int right = keptRight > x0 ? keptRight - x0 < width ? keptRight - x0 : width : 0;
+			unsigned int top = keptTop > y0 ? keptTop - y0 < height ? keptTop - y0 : height : 0;
+			unsigned int bottom = keptBottom > y0 ? keptBottom - y0 < height ? keptBottom - y0 : height : 0;
+
+			if (left < right && top < bottom)
+			{
+				// Partly exposed, the exposed pixels are iterated around the kept ones, strips are too thin to refine or subdivide
+				for (unsigned int y = 0; y < height; y++)
+				{
+					if (y < top || y >= bottom)
+					{
+						ComputeRow(tile, 0, y, width);
+						continue;
+					}
+					if (left > 0) ComputeRow(tile, 0, y, left);
+					if (right < width) ComputeRow(tile, right, y, width - right);
+				}
+				reached = 1;
+			}
+			else if (stride == 1 && renderMode != RENDER_PIXELS)
+			{
+				ComputeRow(tile, 0, 0, width);
+				if (height > 1) ComputeRow(tile, 0, height - 1, width);
+				if (height > 2)
+				{
+					ComputeColumn(tile, 0, 1, height - 2);
+					if (width > 1) ComputeColumn(tile, width - 1, 1, height - 2);
+				}
+				Subdivide(tile, 0, 0, width, height);
+				reached = 1;
+			}
+			else
+			{
+				// Pixels on multiples of stride, rows that the last pass sampled already have every other one
+				for (unsigned int y = 0; y < height; y += stride)
+				{
+					bool sampled = reached == 2 * stride && y % reached == 0;
+					unsigned int x = sampled ? stride : 0;
+					unsigned int step = sampled ? reached : stride;
+					if (x < width) ComputeRow(tile, x, y, (width - x + step - 1) / step, step);
+				}
+				reached = stride;
+			}
+
+			for (unsigned int y = 0; y < height; y++)
+			{
+				memcpy(&frame[(y0 + y) * pxViewportWidth + x0], tile.iterations + y * tile_size, width * sizeof(unsigned short));
+				memcpy(&frameFractions[(y0 + y) * pxViewportWidth + x0], tile.fractions + y * tile_size, width);
+			}
+			tileStride[index] = reached;
+			skipped += tile.skipped;
+			filled += tile.filled;
+		});
+	}
+	skippedIterations = skipped;
+	filledPixels = filled;
+
+	Colorize();
+}
+
+void Fractal::Fractal::Colorize()
+{
+	// D3DCOLOR is a 32 bit DWORD, the color kernels work on it as unsigned int
+	static_assert(sizeof(D3DCOLOR) == sizeof(unsigned int), "D3DCOLOR must be 32 bits");
+	ColorKernel kernel = SelectColorKernel(kernelLevel);
+	ColorParams colors = { (const unsigned int*)palette, color_i(PALLETE_SIZE), cursorPosition, smoothColoring };
+	unsigned int tilesX = (pxViewportWidth + tile_size - 1) / tile_size;
+	unsigned int tilesY = (pxViewportHeight + tile_size - 1) / tile_size;
+
+	pool.Run(tilesX * tilesY, [&](unsigned int index, unsigned int worker)
+	{
+		unsigned int x0 = (index % tilesX) * tile_size;
+		unsigned int y0 = (index / tilesX) * tile_size;
+		unsigned int width = pxViewportWidth - x0 < tile_size ? pxViewportWidth - x0 : tile_size;
+		unsigned int height = pxViewportHeight - y0 < tile_size ? pxViewportHeight - y0 : tile_size;
+		// Pixels that aren't computed yet take the color of the sample at the top left of their block
+		unsigned int block = ~(tileStride[index] - 1u);
+
+		// Drawing to pixel from the color palette, relative to the current position of the cursor
+		for (unsigned int y = 0; y < height; y++)
+		{
+			unsigned int sample = (y0 + (y & block)) * pxViewportWidth + x0;
+			D3DCOLOR* row = fractal + (y0 + y) * pxViewportWidth + x0;
+			kernel(colors, &frame[sample], &frameFractions[sample], width, (unsigned int*)row);
+			// Samples are left where they are, so every pixel copies one that is already colored
+			if (block != ~0u)
+				for (unsigned int x = 0; x < width; x++) row[x] = row[x & block];
+		}
+	});
 }
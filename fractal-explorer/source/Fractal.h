@@ -2,8 +2,10 @@
 
 #include "Complex.h"
 #include "Vec2.h"
-
-#include <thread>
+#include "Kernels.h"
+#include "ThreadPool.h"
+#include "BigFixed.h"
+#include "MultiDouble.h"
 
 #define PALLETE_SIZE 1
 #define color_i(x) (max_iterations * x)
@@ -53,10 +55,59 @@ namespace Fractal
 
 	typedef D3DCOLOR* Palette;
 
+	// Frames are rendered in square tiles, small enough that the threads can balance the work by stealing them
+	const unsigned int tile_size = 32;
+	// Rectangles this narrow are computed pixel by pixel instead of being split again
+	const unsigned int subdivide_min = 6;
+	// Pixels closer than this are rendered by perturbation, plain doubles would turn them into blocks
+	const double perturbation_limit = 1.0 / (1ull << 40);
+	// Reference orbits are computed in the cheapest numbers whose last bits stay far below the pixel spacing
+	// Double-double keeps 106 bits and quad-double 212, deeper zooms need BigFixed
+	const double double_double_limit = 1.0 / (1ull << 40) / (1ull << 40);
+	const double quad_double_limit = double_double_limit / (1ull << 50) / (1ull << 50);
+	// Progressive rendering starts with one pixel out of progressive_stride x progressive_stride and halves the stride every pass
+	const unsigned int progressive_stride = 8;
+	// Pans within this distance of a whole number of pixels scroll the last frame instead of rendering it again
+	const double pan_tolerance = 1.0 / (1 << 20);
+	// Largest error of the series approximation, in pixels, allowed before the pixels have to be iterated
+	const double series_tolerance = 1.0 / 64;
+
+	enum ReferencePrecision
+	{
+		REFERENCE_DOUBLE_DOUBLE,
+		REFERENCE_QUAD_DOUBLE,
+		REFERENCE_BIG_FIXED
+	};
+
+	enum RenderMode
+	{
+		RENDER_PIXELS,				// Every pixel is iterated
+		RENDER_SUBDIVIDE,			// Mariani-Silver, rectangles whose border has a single iteration count are filled with it
+		RENDER_SUBDIVIDE_STRICT		// Same, but a few pixels inside the rectangle are iterated and must match before it's filled
+	};
+
+	// Iteration counts and fractions of one tile while it's being rendered
+	typedef struct Tile
+	{
+		EscapeKernel kernel;
+		const EscapeParams* params;
+		double x0;						// Top left of the viewport
+		double y0;
+		double dx;						// Distance between two pixels
+		double dy;
+		unsigned int left;				// Position of the tile in the viewport, in pixels
+		unsigned int top;
+		unsigned short iterations[tile_size * tile_size];
+		unsigned char fractions[tile_size * tile_size];
+		unsigned long long skipped;		// Iterations skipped by the interior shortcuts
+		unsigned int filled;			// Pixels filled without being iterated
+	} Tile, *pTile;
+
 	class Fractal
 	{
 	public:
 		// In plain english, this will affect how good the fractal looks, if you increase it you will be able to zoom in more
+		// Larger values than max_iterations_limit are lowered to it
 		const unsigned short max_iterations;
 	protected:
 		// Viewport / screen resolution in pixels
@@ -80,6 +131,60 @@ namespace Fractal
 		// Pointer to current position in paletter, for animation effects
 		unsigned short cursorPosition;
 		bool animationState;
+		// Instruction set of the escape time kernels, the best one the CPU supports unless lowered
+		KernelLevel kernelLevel;
+		KernelLevel kernelLevelSupported;
+		// Workers are kept between frames
+		ThreadPool pool;
+		// Iterations the interior shortcuts saved during the last frame
+		unsigned long long skippedIterations;
+		RenderMode renderMode;
+		// Pixels the subdivision filled during the last frame
+		unsigned int filledPixels;
+		// Top left of the viewport in high precision, normalizer.ox / oy lose the digits deep zooms need
+		BigFixed originX;
+		BigFixed originY;
+		// Reference orbit of the last perturbation frame, kept while the reference pixel and the parameters don't change
+		bool perturbation;
+		std::vector<double> referenceR;
+		std::vector<double> referenceI;
+		BigFixed referenceX;
+		BigFixed referenceY;
+		EscapeParams referenceParams;
+		ReferencePrecision referencePrecision;
+		// Iterations the series approximation skipped for every pixel during the last frame
+		unsigned int seriesSkip;
+		// Iteration counts and fractions of the last frame, kept to be scrolled when the next frame is only a pan
+		// and to be colored again when only the palette moves
+		std::vector<unsigned short> frame;
+		std::vector<unsigned char> frameFractions;
+		bool frameValid;
+		EscapeParams frameParams;
+		double frameDx;
+		double frameDy;
+		bool frameSingle;
+		// Pixels the viewport moved by since the last frame, the content moves right / down when they're positive
+		double panX;
+		double panY;
+		// Pixels the last frame kept from the one before
+		unsigned int reusedPixels;
+		// Progressive rendering, passes that don't fit in the budget are left for the next frames
+		// Every tile stores the stride of the last pass it went through, 1 when it's done and 0 before the first pass
+		double frameBudget;
+		std::vector<unsigned char> tileStride;
+
+		// Refines the viewport with the fastest kernel that is precise enough, as far as the frame budget allows, and colors it
+		void Render(unsigned char nThreads, const EscapeParams& params);
+		// Iterates the pixel at the center of the viewport in the cheapest precision that is enough for the zoom
+		void ComputeReference(const EscapeParams& params, double dx, double dy);
+		// Finds how many iterations of the reference orbit the series approximation can skip for the whole viewport
+		void ComputeSeries(Reference& reference, const EscapeParams& params, double dx, double dy);
+		// frame(x, y) = frame(x - shiftX, y - shiftY), the pixels that don't come from the last frame are left as they were
+		void ScrollFrame(int shiftX, int shiftY);
+		// Maps the iteration counts through the palette into the render target, nothing is iterated
+		void Colorize();
+		// Mariani-Silver, the border of the rectangle is already computed
+		void Subdivide(Tile& tile, unsigned int x, unsigned int y, unsigned int width, unsigned int height) const;
 	public:
 		// Normalizes viewport positions in mandelbrot's scale
 		inline double normalizeX(const unsigned int x) const
@@ -91,6 +196,15 @@ namespace Fractal
 			return normalizer.dy * y / pxViewportHeight - normalizer.oy;
 		}
 		bool autoAnimate;
+		// Skip the first iterations of deep zooms with a series approximation of the offsets
+		bool seriesApproximation;
+		// Cardioid / bulb tests and periodicity checking, pixels inside the set stop before max_iterations
+		bool interiorShortcuts;
+		// Blends the colors of neighbouring iteration counts by how far past its last iteration every pixel escaped
+		bool smoothColoring;
+		// Float kernels while pixels are far enough apart for max_iterations, about twice as fast but a few pixels
+		// along the border of the set get other counts than in double, off by default
+		bool singlePrecision;
 		Fractal(unsigned int vpWidth, unsigned int vpHeight, unsigned short max_iterations, D3DCOLOR* pRenderTarget, bool autoAnimate = false);
 		~Fractal();
 
@@ -109,5 +223,24 @@ namespace Fractal
 		// Renders the fractal to the draw target
 		virtual void DrawFractal(unsigned char nThreads) = 0;
 		void Reset();
+		// Lowering the level is useful to compare kernels, levels the CPU doesn't support are ignored
+		void SetKernelLevel(KernelLevel level);
+		KernelLevel GetKernelLevel() const;
+		// Per thread statistics of the last frame
+		const ThreadPool& GetThreadPool() const;
+		unsigned long long GetSkippedIterations() const;
+		void SetRenderMode(RenderMode mode);
+		RenderMode GetRenderMode() const;
+		unsigned int GetFilledPixels() const;
+		// Whether the last frame was deep enough to be rendered by perturbation
+		bool UsesPerturbation() const;
+		unsigned int GetSeriesSkip() const;
+		ReferencePrecision GetReferencePrecision() const;
+		unsigned int GetReusedPixels() const;
+		// Seconds a frame may spend refining the view, 0 renders every frame at full resolution
+		void SetFrameBudget(double seconds);
+		double GetFrameBudget() const;
+		// Stride of the coarsest tile of the last frame, 1 once the view is fully refined
+		unsigned int GetRefinement() const;
 	};
 };
\ No newline at end of file
@@ -4,8 +4,20 @@ static double scale_k = 0.25;
 static double translate_speed = 0.01;
 // More iterations = more zoom in = slower
 static unsigned short max_iterations = 64;
+// Time a frame may spend rendering, slow views are shown coarse first and refined over the next frames (0 = always render in full)
+static double frame_budget = 1.0 / 60;
 // Animation
 static bool animate_locked = false;
+// Interior shortcuts
+static bool interior_locked = false;
+// Render mode
+static bool render_mode_locked = false;
+// Series approximation
+static bool series_locked = false;
+// Smooth coloring
+static bool smooth_locked = false;
+// Single precision kernels
+static bool single_locked = false;
 // Benchmark
 static Timer timer;
 // Doesn't do anything while paused
@@ -15,6 +27,7 @@ static bool pause_locked = false;
 static unsigned char thread_count = 16;
 static bool thread_count_lockedup = false;
 static bool thread_count_lockeddn = false;
+static bool thread_stats_locked = false;
 
 static bool mouse_lock = false;
 static bool mouse_locked = false;
@@ -37,8 +50,10 @@ Game::Game(HWND hWnd, KeyboardServer& kServer, const MouseServer& mServer)
 
 	mandelbrot = new Mandelbrot(gfx.SCREENWIDTH, gfx.SCREENHEIGHT, max_iterations, gfx.pSysBuffer, palette, false);
 	julia = new Julia(gfx.SCREENWIDTH, gfx.SCREENHEIGHT, max_iterations, gfx.pSysBuffer, palette, false);
+	mandelbrot->SetFrameBudget(frame_budget);
+	julia->SetFrameBudget(frame_budget);
 
-	std::cout << "\n\nWelcome to FractalX\n\nNotes:\n1 - Performance will probably be horrible no matter how good your computer is\n2 - You can edit the color palette and the animation style\n3 - If your system is 64 bit, you should build to the x64 platform\n4 - Be sure to set to Release otherwise the lag will be unbearable\n\nUser controls:\n[Scaling]\nQ - Zoom out\nE - Zoom in\n[Movement]\nW - Move up\nA - Move left\nS - Move down\nD - Move right\n[Animation]\nZ - Toggle animate\n[Threads]\nT - Increase thread count\nY - Decrease thread count\n[General]\nP - Toggle pause\nJ - Toggle Julia / Mandelbrot\nR - Reset model\n\nFocus the application window and press P to start / pause, have fun! >;)\n";
+	std::cout << "\n\nWelcome to FractalX\n\nNotes:\n1 - Performance will probably be horrible no matter how good your computer is\n2 - You can edit the color palette and the animation style\n3 - If your system is 64 bit, you should build to the x64 platform\n4 - Be sure to set to Release otherwise the lag will be unbearable\n\nUser controls:\n[Scaling]\nQ - Zoom out\nE - Zoom in\n[Movement]\nW - Move up\nA - Move left\nS - Move down\nD - Move right\n[Animation]\nZ - Toggle animate\n[Interior]\nI - Toggle cardioid / bulb tests and periodicity checking\nM - Cycle render mode (every pixel / rectangle subdivision / strict subdivision)\nO - Toggle series approximation at deep zooms\nC - Toggle smooth coloring\nF - Toggle single precision kernels\n[Threads]\nT - Increase thread count\nY - Decrease thread count\nB - Print how busy every thread was during the last frame\n[General]\nP - Toggle pause\nJ - Toggle Julia / Mandelbrot\nR - Reset model\n\nFocus the application window and press P to start / pause, have fun! >;)\n";
 }
 
 Game::~Game()
@@ -118,6 +133,27 @@ void Game::UpdateModel()
 	else if (!kbd.KeyIsPressed('Y'))
 		thread_count_lockeddn = false;
 
+	// Load balance of the last frame, a balanced frame has every thread busy for about the same time
+	if (kbd.KeyIsPressed('B') && !thread_stats_locked)
+	{
+		const ThreadPool& pool = draw_julia ? julia->GetThreadPool() : mandelbrot->GetThreadPool();
+		for (unsigned int t = 0; t < pool.Size(); t++)
+			std::cout << "Thread " << t << ": " << pool.BusyTime(t) * 1000.0 << " ms busy, " << pool.ItemsDone(t) << " tile passes (" << pool.ItemsStolen(t) << " stolen)\n";
+		std::cout << "Iterations skipped inside the set: " << (draw_julia ? julia->GetSkippedIterations() : mandelbrot->GetSkippedIterations()) << "\n";
+		std::cout << "Pixels filled by subdivision: " << (draw_julia ? julia->GetFilledPixels() : mandelbrot->GetFilledPixels()) << "\n";
+		std::cout << "Pixels kept from the previous frame: " << (draw_julia ? julia->GetReusedPixels() : mandelbrot->GetReusedPixels()) << "\n";
+		std::cout << "Coarsest tile computes 1 pixel out of " << (draw_julia ? julia->GetRefinement() : mandelbrot->GetRefinement()) << " on each axis\n";
+		if (draw_julia ? julia->UsesPerturbation() : mandelbrot->UsesPerturbation())
+		{
+			const char* precisions[] = { "double-double", "quad-double", "fixed point" };
+			std::cout << "Deep zoom, rendered by perturbation, series approximation skipped " << (draw_julia ? julia->GetSeriesSkip() : mandelbrot->GetSeriesSkip()) << " iterations\n";
+			std::cout << "Reference orbit computed in " << precisions[draw_julia ? julia->GetReferencePrecision() : mandelbrot->GetReferencePrecision()] << "\n";
+		}
+		thread_stats_locked = true;
+	}
+	else if (!kbd.KeyIsPressed('B'))
+		thread_stats_locked = false;
+
 	// Zoom in
 	if (kbd.KeyIsPressed('Q'))
 		draw_julia ? julia->Scale(scale_k, Ved2(0.5, 0.5)) : mandelbrot->Scale(scale_k, Ved2(0.5, 0.5));
@@ -143,6 +179,63 @@ void Game::UpdateModel()
 	else if (!kbd.KeyIsPressed('Z'))
 		animate_locked = false;
 
+	// Interior shortcuts
+	if (kbd.KeyIsPressed('I') && !interior_locked)
+	{
+		mandelbrot->interiorShortcuts = !mandelbrot->interiorShortcuts;
+		julia->interiorShortcuts = mandelbrot->interiorShortcuts;
+		std::cout << (mandelbrot->interiorShortcuts ? "Interior shortcuts enabled\n" : "Interior shortcuts disabled\n");
+		interior_locked = true;
+	}
+	else if (!kbd.KeyIsPressed('I'))
+		interior_locked = false;
+
+	// Render mode
+	if (kbd.KeyIsPressed('M') && !render_mode_locked)
+	{
+		RenderMode mode = RenderMode((mandelbrot->GetRenderMode() + 1) % (RENDER_SUBDIVIDE_STRICT + 1));
+		mandelbrot->SetRenderMode(mode);
+		julia->SetRenderMode(mode);
+		const char* names[] = { "every pixel", "rectangle subdivision", "strict rectangle subdivision" };
+		std::cout << "Render mode: " << names[mode] << "\n";
+		render_mode_locked = true;
+	}
+	else if (!kbd.KeyIsPressed('M'))
+		render_mode_locked = false;
+
+	// Series approximation
+	if (kbd.KeyIsPressed('O') && !series_locked)
+	{
+		mandelbrot->seriesApproximation = !mandelbrot->seriesApproximation;
+		julia->seriesApproximation = mandelbrot->seriesApproximation;
+		std::cout << (mandelbrot->seriesApproximation ? "Series approximation enabled\n" : "Series approximation disabled\n");
+		series_locked = true;
+	}
+	else if (!kbd.KeyIsPressed('O'))
+		series_locked = false;
+
+	// Smooth coloring, only the colors are computed again
+	if (kbd.KeyIsPressed('C') && !smooth_locked)
+	{
+		mandelbrot->smoothColoring = !mandelbrot->smoothColoring;
+		julia->smoothColoring = mandelbrot->smoothColoring;
+		std::cout << (mandelbrot->smoothColoring ? "Smooth coloring enabled\n" : "Smooth coloring disabled\n");
+		smooth_locked = true;
+	}
+	else if (!kbd.KeyIsPressed('C'))
+		smooth_locked = false;
+
+	// Single precision kernels, faster but not quite the same picture
+	if (kbd.KeyIsPressed('F') && !single_locked)
+	{
+		mandelbrot->singlePrecision = !mandelbrot->singlePrecision;
+		julia->singlePrecision = mandelbrot->singlePrecision;
+		std::cout << (mandelbrot->singlePrecision ? "Single precision enabled\n" : "Single precision disabled\n");
+		single_locked = true;
+	}
+	else if (!kbd.KeyIsPressed('F'))
+		single_locked = false;
+
 	// Change julia set
 	if (kbd.KeyIsPressed('X') && !mouse_locked)
 	{
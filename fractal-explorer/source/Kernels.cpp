@@ -0,0 +1,797 @@
+#include "Kernels.h"
+
+#include <immintrin.h>
+#include <cmath>
+#include <string.h>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// MSVC compiles any intrinsic anywhere, other compilers need to be told which functions may use them
+#ifdef _MSC_VER
+#define TARGET_AVX2
+#define TARGET_AVX512
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+namespace Fractal
+{
+	// Main cardioid and period 2 bulb, the two largest components of the interior of the Mandelbrot set
+	template <typename T>
+	static inline bool InsideBulbs(T x, T y)
+	{
+		T xq = x - T(0.25);
+		T q = xq * xq + y * y;
+		if (q * (q + xq) <= T(0.25) * y * y) return true;
+		return (x + 1) * (x + 1) + y * y <= T(0.0625);
+	}
+
+	// Smooth fractions only depend on |Z|^2, and only between the bailout and its square, Z escaped fast enough beyond it for the fraction to be 0
+	// That range is tabulated by the top bits of |Z|^2 as a float, entries are 2^-8 apart in relative terms which moves the fraction by at most a 256th
+	// The logarithms cost as much as iterating a pixel that escapes quickly
+	const unsigned int fraction_shift = 15;
+
+	static inline unsigned int FloatBits(float value)
+	{
+		unsigned int bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	typedef struct FractionTable
+	{
+		unsigned int first;		// Entry of the bailout
+		std::vector<unsigned char> fraction;
+
+		FractionTable()
+		{
+			first = FloatBits(float(bailout_sq)) >> fraction_shift;
+			unsigned int last = FloatBits(float(bailout_sq * bailout_sq)) >> fraction_shift;
+			for (unsigned int entry = first; entry <= last; entry++)
+			{
+				// Middle of the magnitudes that share the entry
+				unsigned int bits = (entry << fraction_shift) | (1u << (fraction_shift - 1));
+				float middle;
+				memcpy(&middle, &bits, sizeof(middle));
+				double value = 256.0 * (1.0 - std::log2(std::log2(double(middle)) / std::log2(bailout_sq)));
+				fraction.push_back((unsigned char)(value < 0.0 ? 0.0 : value > 255.0 ? 255.0 : value));
+			}
+		}
+	} FractionTable;
+
+	static const FractionTable fraction_table;
+
+	// Fraction of an iteration, in 256ths, from |Z|^2 at the first point beyond the bailout
+	// Called once per pixel after it's done iterating, every kernel gets the same fraction from the same |Z|^2
+	static inline unsigned char EscapeFraction(double magnitude)
+	{
+		if (!(magnitude > bailout_sq)) return 0;
+		unsigned int entry = (FloatBits(float(magnitude)) >> fraction_shift) - fraction_table.first;
+		return entry < fraction_table.fraction.size() ? fraction_table.fraction[entry] : 0;
+	}
+
+	// Reference kernel, the vector kernels in double precision give the same counts unless the compiler fuses multiplies and adds
+	template <typename T>
+	static unsigned int EscapeScalar(const EscapeParams& params, const Span& span, unsigned short* iterations, unsigned char* fractions)
+	{
+		const T bailout = T(bailout_sq);
+		const T tolerance = sizeof(T) == sizeof(float) ? T(period_tolerance_single) : T(period_tolerance);
+		const unsigned short inside = params.max_iterations + 1;
+		unsigned int skipped = 0;
+		for (unsigned int i = 0; i < span.count; i++)
+		{
+			T x = T(span.x0 + span.dx * (span.first + span.stride * i));
+			T y = T(span.y0 + span.dy * (span.first + span.stride * i));
+			T zr = params.julia ? x : T(0);
+			T zi = params.julia ? y : T(0);
+			T cr = params.julia ? T(params.cr) : x;
+			T ci = params.julia ? T(params.ci) : y;
+
+			if (params.interior && !params.julia && InsideBulbs(x, y))
+			{
+				iterations[i] = inside;
+				fractions[i] = 0;
+				skipped += params.max_iterations;
+				continue;
+			}
+
+			// Saved point of the orbit, replaced every time the number of iterations reaches a power of two
+			T sr = zr;
+			T si = zi;
+			unsigned int checkpoint = 1;
+			unsigned short n = 1;
+			T magnitude = T(0);
+			for (unsigned short k = 0; k < params.max_iterations; k++)
+			{
+				T zr2 = zr * zr;
+				T zi2 = zi * zi;
+				magnitude = zr2 + zi2;
+				if (magnitude > bailout) break;
+				zi = 2 * zr * zi + ci;
+				zr = zr2 - zi2 + cr;
+				n++;
+
+				if (!params.interior) continue;
+				if (std::abs(zr - sr) < tolerance && std::abs(zi - si) < tolerance)
+				{
+					skipped += inside - n;
+					n = inside;
+					break;
+				}
+				if (unsigned(k) + 1 == checkpoint)
+				{
+					sr = zr;
+					si = zi;
+					checkpoint <<= 1;
+				}
+			}
+			iterations[i] = n;
+			fractions[i] = EscapeFraction(double(magnitude));
+		}
+		return skipped;
+	}
+
+	// Lanes past the end of the span are never stored
+	// Lanes set in the interior mask are completed to max_iterations + 1, returns the iterations that were skipped
+	// magnitude is the last |Z|^2 every lane compared with the bailout
+	template <unsigned int lanes, typename T>
+	static inline unsigned int StoreLanes(unsigned short* lane, const T* magnitude, unsigned int interior, unsigned short max_iterations,
+		unsigned short* iterations, unsigned char* fractions, unsigned int i, unsigned int count)
+	{
+		unsigned int skipped = 0;
+		for (unsigned int l = 0; l < lanes && i + l < count; l++)
+		{
+			if (interior & (1u << l))
+			{
+				skipped += max_iterations + 1 - lane[l];
+				lane[l] = max_iterations + 1;
+			}
+			iterations[i + l] = lane[l];
+			fractions[i + l] = interior & (1u << l) ? 0 : EscapeFraction(double(magnitude[l]));
+		}
+		return skipped;
+	}
+
+	// Float coordinates are computed in double and rounded, so a pixel gets the same value whichever span or lane computes it
+	TARGET_AVX2 static inline __m256 CoordinatesAVX2(double origin, double step, unsigned int first, unsigned int stride)
+	{
+		__m256d index = _mm256_add_pd(_mm256_set1_pd(double(first)), _mm256_mul_pd(_mm256_set_pd(3.0, 2.0, 1.0, 0.0), _mm256_set1_pd(double(stride))));
+		__m128 low = _mm256_cvtpd_ps(_mm256_add_pd(_mm256_set1_pd(origin), _mm256_mul_pd(_mm256_set1_pd(step), index)));
+		index = _mm256_add_pd(index, _mm256_set1_pd(4.0 * stride));
+		__m128 high = _mm256_cvtpd_ps(_mm256_add_pd(_mm256_set1_pd(origin), _mm256_mul_pd(_mm256_set1_pd(step), index)));
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+	}
+
+	TARGET_AVX512 static inline __m512 CoordinatesAVX512(double origin, double step, unsigned int first, unsigned int stride)
+	{
+		__m512d index = _mm512_add_pd(_mm512_set1_pd(double(first)), _mm512_mul_pd(_mm512_set_pd(7.0, 6.0, 5.0, 4.0, 3.0, 2.0, 1.0, 0.0), _mm512_set1_pd(double(stride))));
+		__m256 low = _mm512_cvtpd_ps(_mm512_add_pd(_mm512_set1_pd(origin), _mm512_mul_pd(_mm512_set1_pd(step), index)));
+		index = _mm512_add_pd(index, _mm512_set1_pd(8.0 * stride));
+		__m256 high = _mm512_cvtpd_ps(_mm512_add_pd(_mm512_set1_pd(origin), _mm512_mul_pd(_mm512_set1_pd(step), index)));
+		return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(low)), _mm256_castps_pd(high), 1));
+	}
+
+	TARGET_AVX2 static unsigned int EscapeAVX2Double(const EscapeParams& params, const Span& span, unsigned short* iterations, unsigned char* fractions)
+	{
+		const __m256d bailout = _mm256_set1_pd(bailout_sq);
+		const __m256d tolerance = _mm256_set1_pd(period_tolerance);
+		const __m256d sign = _mm256_set1_pd(-0.0);
+		const __m256d one = _mm256_set1_pd(1.0);
+		const __m256d lane = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+		const __m256d offsets = _mm256_mul_pd(lane, _mm256_set1_pd(double(span.stride)));
+		const __m256d dx = _mm256_set1_pd(span.dx);
+		const __m256d dy = _mm256_set1_pd(span.dy);
+		unsigned int skipped = 0;
+		for (unsigned int i = 0; i < span.count; i += 4)
+		{
+			__m256d index = _mm256_add_pd(_mm256_set1_pd(double(span.first + span.stride * i)), offsets);
+			__m256d x = _mm256_add_pd(_mm256_set1_pd(span.x0), _mm256_mul_pd(dx, index));
+			__m256d y = _mm256_add_pd(_mm256_set1_pd(span.y0), _mm256_mul_pd(dy, index));
+			__m256d zr = params.julia ? x : _mm256_setzero_pd();
+			__m256d zi = params.julia ? y : _mm256_setzero_pd();
+			__m256d cr = params.julia ? _mm256_set1_pd(params.cr) : x;
+			__m256d ci = params.julia ? _mm256_set1_pd(params.ci) : y;
+			__m256d n = one;
+			// Lanes past the end of the span start out escaped, so they don't keep the vector iterating
+			__m256d active = _mm256_cmp_pd(lane, _mm256_set1_pd(double(span.count - i)), _CMP_LT_OQ);
+			__m256d interior = _mm256_setzero_pd();
+			__m256d magnitude = _mm256_setzero_pd();
+
+			if (params.interior && !params.julia)
+			{
+				__m256d xq = _mm256_sub_pd(x, _mm256_set1_pd(0.25));
+				__m256d y2 = _mm256_mul_pd(y, y);
+				__m256d q = _mm256_add_pd(_mm256_mul_pd(xq, xq), y2);
+				__m256d cardioid = _mm256_cmp_pd(_mm256_mul_pd(q, _mm256_add_pd(q, xq)), _mm256_mul_pd(_mm256_set1_pd(0.25), y2), _CMP_LE_OQ);
+				__m256d x1 = _mm256_add_pd(x, one);
+				__m256d bulb = _mm256_cmp_pd(_mm256_add_pd(_mm256_mul_pd(x1, x1), y2), _mm256_set1_pd(0.0625), _CMP_LE_OQ);
+				interior = _mm256_or_pd(cardioid, bulb);
+				active = _mm256_andnot_pd(interior, active);
+			}
+
+			__m256d sr = zr;
+			__m256d si = zi;
+			unsigned int checkpoint = 1;
+			for (unsigned short k = 0; k < params.max_iterations; k++)
+			{
+				__m256d zr2 = _mm256_mul_pd(zr, zr);
+				__m256d zi2 = _mm256_mul_pd(zi, zi);
+				__m256d z2 = _mm256_add_pd(zr2, zi2);
+				// Lanes keep |Z|^2 until they escape, the last one gives the fraction
+				magnitude = _mm256_blendv_pd(magnitude, z2, active);
+				// NaN from lanes that escaped long ago compares false, so they stay out
+				active = _mm256_and_pd(active, _mm256_cmp_pd(z2, bailout, _CMP_LE_OQ));
+				if (_mm256_movemask_pd(active) == 0) break;
+				n = _mm256_add_pd(n, _mm256_and_pd(active, one));
+				zi = _mm256_add_pd(_mm256_mul_pd(_mm256_add_pd(zr, zr), zi), ci);
+				zr = _mm256_add_pd(_mm256_sub_pd(zr2, zi2), cr);
+
+				if (!params.interior) continue;
+				__m256d closeR = _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(zr, sr)), tolerance, _CMP_LT_OQ);
+				__m256d closeI = _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(zi, si)), tolerance, _CMP_LT_OQ);
+				__m256d cycle = _mm256_and_pd(active, _mm256_and_pd(closeR, closeI));
+				interior = _mm256_or_pd(interior, cycle);
+				active = _mm256_andnot_pd(cycle, active);
+				if (unsigned(k) + 1 == checkpoint)
+				{
+					sr = zr;
+					si = zi;
+					checkpoint <<= 1;
+				}
+			}
+
+			__m128i counts = _mm256_cvtpd_epi32(n);
+			alignas(16) unsigned int wide[4];
+			_mm_store_si128((__m128i*)wide, counts);
+			unsigned short narrow[4] = { (unsigned short)wide[0], (unsigned short)wide[1], (unsigned short)wide[2], (unsigned short)wide[3] };
+			alignas(32) double magnitudes[4];
+			_mm256_store_pd(magnitudes, magnitude);
+			skipped += StoreLanes<4>(narrow, magnitudes, _mm256_movemask_pd(interior), params.max_iterations, iterations, fractions, i, span.count);
+		}
+		return skipped;
+	}
+
+	TARGET_AVX2 static unsigned int EscapeAVX2Float(const EscapeParams& params, const Span& span, unsigned short* iterations, unsigned char* fractions)
+	{
+		const __m256 bailout = _mm256_set1_ps(float(bailout_sq));
+		const __m256 tolerance = _mm256_set1_ps(period_tolerance_single);
+		const __m256 sign = _mm256_set1_ps(-0.0f);
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 lane = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+		unsigned int skipped = 0;
+		for (unsigned int i = 0; i < span.count; i += 8)
+		{
+			__m256 x = CoordinatesAVX2(span.x0, span.dx, span.first + span.stride * i, span.stride);
+			__m256 y = CoordinatesAVX2(span.y0, span.dy, span.first + span.stride * i, span.stride);
+			__m256 zr = params.julia ? x : _mm256_setzero_ps();
+			__m256 zi = params.julia ? y : _mm256_setzero_ps();
+			__m256 cr = params.julia ? _mm256_set1_ps(float(params.cr)) : x;
+			__m256 ci = params.julia ? _mm256_set1_ps(float(params.ci)) : y;
+			__m256 n = one;
+			__m256 active = _mm256_cmp_ps(lane, _mm256_set1_ps(float(span.count - i)), _CMP_LT_OQ);
+			__m256 interior = _mm256_setzero_ps();
+			__m256 magnitude = _mm256_setzero_ps();
+
+			if (params.interior && !params.julia)
+			{
+				__m256 xq = _mm256_sub_ps(x, _mm256_set1_ps(0.25f));
+				__m256 y2 = _mm256_mul_ps(y, y);
+				__m256 q = _mm256_add_ps(_mm256_mul_ps(xq, xq), y2);
+				__m256 cardioid = _mm256_cmp_ps(_mm256_mul_ps(q, _mm256_add_ps(q, xq)), _mm256_mul_ps(_mm256_set1_ps(0.25f), y2), _CMP_LE_OQ);
+				__m256 x1 = _mm256_add_ps(x, one);
+				__m256 bulb = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(x1, x1), y2), _mm256_set1_ps(0.0625f), _CMP_LE_OQ);
+				interior = _mm256_or_ps(cardioid, bulb);
+				active = _mm256_andnot_ps(interior, active);
+			}
+
+			__m256 sr = zr;
+			__m256 si = zi;
+			unsigned int checkpoint = 1;
+			for (unsigned short k = 0; k < params.max_iterations; k++)
+			{
+				__m256 zr2 = _mm256_mul_ps(zr, zr);
+				__m256 zi2 = _mm256_mul_ps(zi, zi);
+				__m256 z2 = _mm256_add_ps(zr2, zi2);
+				magnitude = _mm256_blendv_ps(magnitude, z2, active);
+				active = _mm256_and_ps(active, _mm256_cmp_ps(z2, bailout, _CMP_LE_OQ));
+				if (_mm256_movemask_ps(active) == 0) break;
+				n = _mm256_add_ps(n, _mm256_and_ps(active, one));
+				zi = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(zr, zr), zi), ci);
+				zr = _mm256_add_ps(_mm256_sub_ps(zr2, zi2), cr);
+
+				if (!params.interior) continue;
+				__m256 closeR = _mm256_cmp_ps(_mm256_andnot_ps(sign, _mm256_sub_ps(zr, sr)), tolerance, _CMP_LT_OQ);
+				__m256 closeI = _mm256_cmp_ps(_mm256_andnot_ps(sign, _mm256_sub_ps(zi, si)), tolerance, _CMP_LT_OQ);
+				__m256 cycle = _mm256_and_ps(active, _mm256_and_ps(closeR, closeI));
+				interior = _mm256_or_ps(interior, cycle);
+				active = _mm256_andnot_ps(cycle, active);
+				if (unsigned(k) + 1 == checkpoint)
+				{
+					sr = zr;
+					si = zi;
+					checkpoint <<= 1;
+				}
+			}
+
+			// Counts fit in 16 bits, pack them with unsigned saturation
+			__m256i counts = _mm256_cvtps_epi32(n);
+			__m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(counts), _mm256_extracti128_si256(counts, 1));
+			alignas(16) unsigned short narrow[8];
+			_mm_store_si128((__m128i*)narrow, packed);
+			alignas(32) float magnitudes[8];
+			_mm256_store_ps(magnitudes, magnitude);
+			skipped += StoreLanes<8>(narrow, magnitudes, _mm256_movemask_ps(interior), params.max_iterations, iterations, fractions, i, span.count);
+		}
+		return skipped;
+	}
+
+	TARGET_AVX512 static unsigned int EscapeAVX512Double(const EscapeParams& params, const Span& span, unsigned short* iterations, unsigned char* fractions)
+	{
+		const __m512d bailout = _mm512_set1_pd(bailout_sq);
+		const __m512d tolerance = _mm512_set1_pd(period_tolerance);
+		const __m512d one = _mm512_set1_pd(1.0);
+		const __m512d lane = _mm512_set_pd(7.0, 6.0, 5.0, 4.0, 3.0, 2.0, 1.0, 0.0);
+		const __m512d offsets = _mm512_mul_pd(lane, _mm512_set1_pd(double(span.stride)));
+		const __m512d dx = _mm512_set1_pd(span.dx);
+		const __m512d dy = _mm512_set1_pd(span.dy);
+		unsigned int skipped = 0;
+		for (unsigned int i = 0; i < span.count; i += 8)
+		{
+			__m512d index = _mm512_add_pd(_mm512_set1_pd(double(span.first + span.stride * i)), offsets);
+			__m512d x = _mm512_add_pd(_mm512_set1_pd(span.x0), _mm512_mul_pd(dx, index));
+			__m512d y = _mm512_add_pd(_mm512_set1_pd(span.y0), _mm512_mul_pd(dy, index));
+			__m512d zr = params.julia ? x : _mm512_setzero_pd();
+			__m512d zi = params.julia ? y : _mm512_setzero_pd();
+			__m512d cr = params.julia ? _mm512_set1_pd(params.cr) : x;
+			__m512d ci = params.julia ? _mm512_set1_pd(params.ci) : y;
+			__m512d n = one;
+			__mmask8 active = span.count - i >= 8 ? 0xFF : __mmask8((1u << (span.count - i)) - 1);
+			__mmask8 interior = 0;
+			__m512d magnitude = _mm512_setzero_pd();
+
+			if (params.interior && !params.julia)
+			{
+				__m512d xq = _mm512_sub_pd(x, _mm512_set1_pd(0.25));
+				__m512d y2 = _mm512_mul_pd(y, y);
+				__m512d q = _mm512_add_pd(_mm512_mul_pd(xq, xq), y2);
+				__m512d x1 = _mm512_add_pd(x, one);
+				interior = _mm512_cmp_pd_mask(_mm512_mul_pd(q, _mm512_add_pd(q, xq)), _mm512_mul_pd(_mm512_set1_pd(0.25), y2), _CMP_LE_OQ)
+					| _mm512_cmp_pd_mask(_mm512_add_pd(_mm512_mul_pd(x1, x1), y2), _mm512_set1_pd(0.0625), _CMP_LE_OQ);
+				active &= ~interior;
+			}
+
+			__m512d sr = zr;
+			__m512d si = zi;
+			unsigned int checkpoint = 1;
+			for (unsigned short k = 0; k < params.max_iterations; k++)
+			{
+				__m512d zr2 = _mm512_mul_pd(zr, zr);
+				__m512d zi2 = _mm512_mul_pd(zi, zi);
+				__m512d z2 = _mm512_add_pd(zr2, zi2);
+				magnitude = _mm512_mask_mov_pd(magnitude, active, z2);
+				active = _mm512_mask_cmp_pd_mask(active, z2, bailout, _CMP_LE_OQ);
+				if (active == 0) break;
+				n = _mm512_mask_add_pd(n, active, n, one);
+				zi = _mm512_add_pd(_mm512_mul_pd(_mm512_add_pd(zr, zr), zi), ci);
+				zr = _mm512_add_pd(_mm512_sub_pd(zr2, zi2), cr);
+
+				if (!params.interior) continue;
+				__mmask8 cycle = _mm512_mask_cmp_pd_mask(active, _mm512_abs_pd(_mm512_sub_pd(zr, sr)), tolerance, _CMP_LT_OQ);
+				cycle = _mm512_mask_cmp_pd_mask(cycle, _mm512_abs_pd(_mm512_sub_pd(zi, si)), tolerance, _CMP_LT_OQ);
+				interior |= cycle;
+				active &= ~cycle;
+				if (unsigned(k) + 1 == checkpoint)
+				{
+					sr = zr;
+					si = zi;
+					checkpoint <<= 1;
+				}
+			}
+
+			__m256i counts = _mm512_cvtpd_epi32(n);
+			alignas(32) unsigned int wide[8];
+			_mm256_store_si256((__m256i*)wide, counts);
+			unsigned short narrow[8];
+			for (unsigned int l = 0; l < 8; l++) narrow[l] = (unsigned short)wide[l];
+			alignas(64) double magnitudes[8];
+			_mm512_store_pd(magnitudes, magnitude);
+			skipped += StoreLanes<8>(narrow, magnitudes, interior, params.max_iterations, iterations, fractions, i, span.count);
+		}
+		return skipped;
+	}
+
+	TARGET_AVX512 static unsigned int EscapeAVX512Float(const EscapeParams& params, const Span& span, unsigned short* iterations, unsigned char* fractions)
+	{
+		const __m512 bailout = _mm512_set1_ps(float(bailout_sq));
+		const __m512 tolerance = _mm512_set1_ps(period_tolerance_single);
+		const __m512 one = _mm512_set1_ps(1.0f);
+		unsigned int skipped = 0;
+		for (unsigned int i = 0; i < span.count; i += 16)
+		{
+			__m512 x = CoordinatesAVX512(span.x0, span.dx, span.first + span.stride * i, span.stride);
+			__m512 y = CoordinatesAVX512(span.y0, span.dy, span.first + span.stride * i, span.stride);
+			__m512 zr = params.julia ? x : _mm512_setzero_ps();
+			__m512 zi = params.julia ? y : _mm512_setzero_ps();
+			__m512 cr = params.julia ? _mm512_set1_ps(float(params.cr)) : x;
+			__m512 ci = params.julia ? _mm512_set1_ps(float(params.ci)) : y;
+			__m512 n = one;
+			__mmask16 active = span.count - i >= 16 ? 0xFFFF : __mmask16((1u << (span.count - i)) - 1);
+			__mmask16 interior = 0;
+			__m512 magnitude = _mm512_setzero_ps();
+
+			if (params.interior && !params.julia)
+			{
+				__m512 xq = _mm512_sub_ps(x, _mm512_set1_ps(0.25f));
+				__m512 y2 = _mm512_mul_ps(y, y);
+				__m512 q = _mm512_add_ps(_mm512_mul_ps(xq, xq), y2);
+				__m512 x1 = _mm512_add_ps(x, one);
+				interior = _mm512_cmp_ps_mask(_mm512_mul_ps(q, _mm512_add_ps(q, xq)), _mm512_mul_ps(_mm512_set1_ps(0.25f), y2), _CMP_LE_OQ)
+					| _mm512_cmp_ps_mask(_mm512_add_ps(_mm512_mul_ps(x1, x1), y2), _mm512_set1_ps(0.0625f), _CMP_LE_OQ);
+				active &= ~interior;
+			}
+
+			__m512 sr = zr;
+			__m512 si = zi;
+			unsigned int checkpoint = 1;
+			for (unsigned short k = 0; k < params.max_iterations; k++)
+			{
+				__m512 zr2 = _mm512_mul_ps(zr, zr);
+				__m512 zi2 = _mm512_mul_ps(zi, zi);
+				__m512 z2 = _mm512_add_ps(zr2, zi2);
+				magnitude = _mm512_mask_mov_ps(magnitude, active, z2);
+				active = _mm512_mask_cmp_ps_mask(active, z2, bailout, _CMP_LE_OQ);
+				if (active == 0) break;
+				n = _mm512_mask_add_ps(n, active, n, one);
+				zi = _mm512_add_ps(_mm512_mul_ps(_mm512_add_ps(zr, zr), zi), ci);
+				zr = _mm512_add_ps(_mm512_sub_ps(zr2, zi2), cr);
+
+				if (!params.interior) continue;
+				__mmask16 cycle = _mm512_mask_cmp_ps_mask(active, _mm512_abs_ps(_mm512_sub_ps(zr, sr)), tolerance, _CMP_LT_OQ);
+				cycle = _mm512_mask_cmp_ps_mask(cycle, _mm512_abs_ps(_mm512_sub_ps(zi, si)), tolerance, _CMP_LT_OQ);
+				interior |= cycle;
+				active &= ~cycle;
+				if (unsigned(k) + 1 == checkpoint)
+				{
+					sr = zr;
+					si = zi;
+					checkpoint <<= 1;
+				}
+			}
+
+			__m512i counts = _mm512_cvtps_epi32(n);
+			alignas(32) unsigned short narrow[16];
+			_mm256_store_si256((__m256i*)narrow, _mm512_cvtusepi32_epi16(counts));
+			alignas(64) float magnitudes[16];
+			_mm512_store_ps(magnitudes, magnitude);
+			skipped += StoreLanes<16>(narrow, magnitudes, interior, params.max_iterations, iterations, fractions, i, span.count);
+		}
+		return skipped;
+	}
+
+	static unsigned int PerturbScalar(const EscapeParams& params, const Span& span, unsigned short* iterations, unsigned char* fractions)
+	{
+		const Reference& reference = *params.reference;
+		for (unsigned int i = 0; i < span.count; i++)
+		{
+			double dr = span.x0 + span.dx * (span.first + span.stride * i);
+			double di = span.y0 + span.dy * (span.first + span.stride * i);
+			// Julia pixels start away from the reference, Mandelbrot pixels add their offset every iteration
+			double dcr = params.julia ? 0.0 : dr;
+			double dci = params.julia ? 0.0 : di;
+			double dzr = params.julia ? dr : 0.0;
+			double dzi = params.julia ? di : 0.0;
+			if (reference.skip)
+			{
+				double d2r = dr * dr - di * di;
+				double d2i = 2 * dr * di;
+				double d3r = d2r * dr - d2i * di;
+				double d3i = d2r * di + d2i * dr;
+				dzr = reference.ar * dr - reference.ai * di + reference.br * d2r - reference.bi * d2i + reference.cr * d3r - reference.ci * d3i;
+				dzi = reference.ar * di + reference.ai * dr + reference.br * d2i + reference.bi * d2r + reference.cr * d3i + reference.ci * d3r;
+			}
+
+			unsigned int m = reference.skip;
+			unsigned short n = 1 + reference.skip;
+			double magnitude = 0.0;
+			for (unsigned short k = reference.skip; k < params.max_iterations; k++)
+			{
+				double zr = reference.zr[m] + dzr;
+				double zi = reference.zi[m] + dzi;
+				double z2 = zr * zr + zi * zi;
+				magnitude = z2;
+				if (z2 > bailout_sq) break;
+				if (z2 < dzr * dzr + dzi * dzi || m + 1 == reference.length)
+				{
+					dzr = zr - reference.zr[0];
+					dzi = zi - reference.zi[0];
+					m = 0;
+				}
+				double Zr = reference.zr[m];
+				double Zi = reference.zi[m];
+				double t = 2 * (Zr * dzr - Zi * dzi) + dzr * dzr - dzi * dzi + dcr;
+				dzi = 2 * (Zr * dzi + Zi * dzr + dzr * dzi) + dci;
+				dzr = t;
+				m++;
+				n++;
+			}
+			iterations[i] = n;
+			fractions[i] = EscapeFraction(magnitude);
+		}
+		return 0;
+	}
+
+	// Every lane follows the reference at its own index once it has been rebased, the orbit is gathered
+	TARGET_AVX2 static unsigned int PerturbAVX2(const EscapeParams& params, const Span& span, unsigned short* iterations, unsigned char* fractions)
+	{
+		const Reference& reference = *params.reference;
+		const __m256d bailout = _mm256_set1_pd(bailout_sq);
+		const __m256d one = _mm256_set1_pd(1.0);
+		const __m256d two = _mm256_set1_pd(2.0);
+		const __m256d lane = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+		const __m256d offsets = _mm256_mul_pd(lane, _mm256_set1_pd(double(span.stride)));
+		const __m256d last = _mm256_set1_pd(double(reference.length - 1));
+		const __m256d startR = _mm256_set1_pd(reference.zr[0]);
+		const __m256d startI = _mm256_set1_pd(reference.zi[0]);
+		const __m256d ar = _mm256_set1_pd(reference.ar);
+		const __m256d ai = _mm256_set1_pd(reference.ai);
+		const __m256d br = _mm256_set1_pd(reference.br);
+		const __m256d bi = _mm256_set1_pd(reference.bi);
+		const __m256d cr = _mm256_set1_pd(reference.cr);
+		const __m256d ci = _mm256_set1_pd(reference.ci);
+		for (unsigned int i = 0; i < span.count; i += 4)
+		{
+			__m256d index = _mm256_add_pd(_mm256_set1_pd(double(span.first + span.stride * i)), offsets);
+			__m256d dr = _mm256_add_pd(_mm256_set1_pd(span.x0), _mm256_mul_pd(_mm256_set1_pd(span.dx), index));
+			__m256d di = _mm256_add_pd(_mm256_set1_pd(span.y0), _mm256_mul_pd(_mm256_set1_pd(span.dy), index));
+			__m256d dcr = params.julia ? _mm256_setzero_pd() : dr;
+			__m256d dci = params.julia ? _mm256_setzero_pd() : di;
+			__m256d dzr = params.julia ? dr : _mm256_setzero_pd();
+			__m256d dzi = params.julia ? di : _mm256_setzero_pd();
+			if (reference.skip)
+			{
+				__m256d d2r = _mm256_sub_pd(_mm256_mul_pd(dr, dr), _mm256_mul_pd(di, di));
+				__m256d d2i = _mm256_mul_pd(two, _mm256_mul_pd(dr, di));
+				__m256d d3r = _mm256_sub_pd(_mm256_mul_pd(d2r, dr), _mm256_mul_pd(d2i, di));
+				__m256d d3i = _mm256_add_pd(_mm256_mul_pd(d2r, di), _mm256_mul_pd(d2i, dr));
+				dzr = _mm256_add_pd(_mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(ar, dr), _mm256_mul_pd(ai, di)), _mm256_sub_pd(_mm256_mul_pd(br, d2r), _mm256_mul_pd(bi, d2i))), _mm256_sub_pd(_mm256_mul_pd(cr, d3r), _mm256_mul_pd(ci, d3i)));
+				dzi = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ar, di), _mm256_mul_pd(ai, dr)), _mm256_add_pd(_mm256_mul_pd(br, d2i), _mm256_mul_pd(bi, d2r))), _mm256_add_pd(_mm256_mul_pd(cr, d3i), _mm256_mul_pd(ci, d3r)));
+			}
+			__m256d m = _mm256_set1_pd(double(reference.skip));
+			__m256d n = _mm256_set1_pd(double(1 + reference.skip));
+			__m256d active = _mm256_cmp_pd(lane, _mm256_set1_pd(double(span.count - i)), _CMP_LT_OQ);
+			__m256d magnitude = _mm256_setzero_pd();
+
+			for (unsigned short k = reference.skip; k < params.max_iterations; k++)
+			{
+				__m128i gather = _mm256_cvttpd_epi32(m);
+				__m256d Zr = _mm256_i32gather_pd(reference.zr, gather, 8);
+				__m256d Zi = _mm256_i32gather_pd(reference.zi, gather, 8);
+				__m256d zr = _mm256_add_pd(Zr, dzr);
+				__m256d zi = _mm256_add_pd(Zi, dzi);
+				__m256d z2 = _mm256_add_pd(_mm256_mul_pd(zr, zr), _mm256_mul_pd(zi, zi));
+				magnitude = _mm256_blendv_pd(magnitude, z2, active);
+				active = _mm256_and_pd(active, _mm256_cmp_pd(z2, bailout, _CMP_LE_OQ));
+				if (_mm256_movemask_pd(active) == 0) break;
+				n = _mm256_add_pd(n, _mm256_and_pd(active, one));
+
+				// Escaped lanes are rebased too when they reach the end, which keeps their index inside the orbit
+				__m256d dz2 = _mm256_add_pd(_mm256_mul_pd(dzr, dzr), _mm256_mul_pd(dzi, dzi));
+				__m256d rebase = _mm256_or_pd(_mm256_cmp_pd(z2, dz2, _CMP_LT_OQ), _mm256_cmp_pd(m, last, _CMP_EQ_OQ));
+				dzr = _mm256_blendv_pd(dzr, _mm256_sub_pd(zr, startR), rebase);
+				dzi = _mm256_blendv_pd(dzi, _mm256_sub_pd(zi, startI), rebase);
+				Zr = _mm256_blendv_pd(Zr, startR, rebase);
+				Zi = _mm256_blendv_pd(Zi, startI, rebase);
+				m = _mm256_andnot_pd(rebase, m);
+
+				__m256d t = _mm256_add_pd(_mm256_mul_pd(two, _mm256_sub_pd(_mm256_mul_pd(Zr, dzr), _mm256_mul_pd(Zi, dzi))), _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(dzr, dzr), _mm256_mul_pd(dzi, dzi)), dcr));
+				dzi = _mm256_add_pd(_mm256_mul_pd(two, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(Zr, dzi), _mm256_mul_pd(Zi, dzr)), _mm256_mul_pd(dzr, dzi))), dci);
+				dzr = t;
+				m = _mm256_add_pd(m, one);
+			}
+
+			__m128i counts = _mm256_cvtpd_epi32(n);
+			alignas(16) unsigned int wide[4];
+			_mm_store_si128((__m128i*)wide, counts);
+			unsigned short narrow[4] = { (unsigned short)wide[0], (unsigned short)wide[1], (unsigned short)wide[2], (unsigned short)wide[3] };
+			alignas(32) double magnitudes[4];
+			_mm256_store_pd(magnitudes, magnitude);
+			StoreLanes<4>(narrow, magnitudes, 0, params.max_iterations, iterations, fractions, i, span.count);
+		}
+		return 0;
+	}
+
+	TARGET_AVX512 static unsigned int PerturbAVX512(const EscapeParams& params, const Span& span, unsigned short* iterations, unsigned char* fractions)
+	{
+		const Reference& reference = *params.reference;
+		const __m512d bailout = _mm512_set1_pd(bailout_sq);
+		const __m512d one = _mm512_set1_pd(1.0);
+		const __m512d two = _mm512_set1_pd(2.0);
+		const __m512d lane = _mm512_set_pd(7.0, 6.0, 5.0, 4.0, 3.0, 2.0, 1.0, 0.0);
+		const __m512d offsets = _mm512_mul_pd(lane, _mm512_set1_pd(double(span.stride)));
+		const __m512d last = _mm512_set1_pd(double(reference.length - 1));
+		const __m512d startR = _mm512_set1_pd(reference.zr[0]);
+		const __m512d startI = _mm512_set1_pd(reference.zi[0]);
+		const __m512d ar = _mm512_set1_pd(reference.ar);
+		const __m512d ai = _mm512_set1_pd(reference.ai);
+		const __m512d br = _mm512_set1_pd(reference.br);
+		const __m512d bi = _mm512_set1_pd(reference.bi);
+		const __m512d cr = _mm512_set1_pd(reference.cr);
+		const __m512d ci = _mm512_set1_pd(reference.ci);
+		for (unsigned int i = 0; i < span.count; i += 8)
+		{
+			__m512d index = _mm512_add_pd(_mm512_set1_pd(double(span.first + span.stride * i)), offsets);
+			__m512d dr = _mm512_add_pd(_mm512_set1_pd(span.x0), _mm512_mul_pd(_mm512_set1_pd(span.dx), index));
+			__m512d di = _mm512_add_pd(_mm512_set1_pd(span.y0), _mm512_mul_pd(_mm512_set1_pd(span.dy), index));
+			__m512d dcr = params.julia ? _mm512_setzero_pd() : dr;
+			__m512d dci = params.julia ? _mm512_setzero_pd() : di;
+			__m512d dzr = params.julia ? dr : _mm512_setzero_pd();
+			__m512d dzi = params.julia ? di : _mm512_setzero_pd();
+			if (reference.skip)
+			{
+				__m512d d2r = _mm512_sub_pd(_mm512_mul_pd(dr, dr), _mm512_mul_pd(di, di));
+				__m512d d2i = _mm512_mul_pd(two, _mm512_mul_pd(dr, di));
+				__m512d d3r = _mm512_sub_pd(_mm512_mul_pd(d2r, dr), _mm512_mul_pd(d2i, di));
+				__m512d d3i = _mm512_add_pd(_mm512_mul_pd(d2r, di), _mm512_mul_pd(d2i, dr));
+				dzr = _mm512_add_pd(_mm512_add_pd(_mm512_sub_pd(_mm512_mul_pd(ar, dr), _mm512_mul_pd(ai, di)), _mm512_sub_pd(_mm512_mul_pd(br, d2r), _mm512_mul_pd(bi, d2i))), _mm512_sub_pd(_mm512_mul_pd(cr, d3r), _mm512_mul_pd(ci, d3i)));
+				dzi = _mm512_add_pd(_mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(ar, di), _mm512_mul_pd(ai, dr)), _mm512_add_pd(_mm512_mul_pd(br, d2i), _mm512_mul_pd(bi, d2r))), _mm512_add_pd(_mm512_mul_pd(cr, d3i), _mm512_mul_pd(ci, d3r)));
+			}
+			__m512d m = _mm512_set1_pd(double(reference.skip));
+			__m512d n = _mm512_set1_pd(double(1 + reference.skip));
+			__mmask8 active = span.count - i >= 8 ? 0xFF : __mmask8((1u << (span.count - i)) - 1);
+			__m512d magnitude = _mm512_setzero_pd();
+
+			for (unsigned short k = reference.skip; k < params.max_iterations; k++)
+			{
+				__m256i gather = _mm512_cvttpd_epi32(m);
+				__m512d Zr = _mm512_i32gather_pd(gather, reference.zr, 8);
+				__m512d Zi = _mm512_i32gather_pd(gather, reference.zi, 8);
+				__m512d zr = _mm512_add_pd(Zr, dzr);
+				__m512d zi = _mm512_add_pd(Zi, dzi);
+				__m512d z2 = _mm512_add_pd(_mm512_mul_pd(zr, zr), _mm512_mul_pd(zi, zi));
+				magnitude = _mm512_mask_mov_pd(magnitude, active, z2);
+				active = _mm512_mask_cmp_pd_mask(active, z2, bailout, _CMP_LE_OQ);
+				if (active == 0) break;
+				n = _mm512_mask_add_pd(n, active, n, one);
+
+				__m512d dz2 = _mm512_add_pd(_mm512_mul_pd(dzr, dzr), _mm512_mul_pd(dzi, dzi));
+				__mmask8 rebase = _mm512_cmp_pd_mask(z2, dz2, _CMP_LT_OQ) | _mm512_cmp_pd_mask(m, last, _CMP_EQ_OQ);
+				dzr = _mm512_mask_sub_pd(dzr, rebase, zr, startR);
+				dzi = _mm512_mask_sub_pd(dzi, rebase, zi, startI);
+				Zr = _mm512_mask_mov_pd(Zr, rebase, startR);
+				Zi = _mm512_mask_mov_pd(Zi, rebase, startI);
+				m = _mm512_mask_mov_pd(m, rebase, _mm512_setzero_pd());
+
+				__m512d t = _mm512_add_pd(_mm512_mul_pd(two, _mm512_sub_pd(_mm512_mul_pd(Zr, dzr), _mm512_mul_pd(Zi, dzi))), _mm512_add_pd(_mm512_sub_pd(_mm512_mul_pd(dzr, dzr), _mm512_mul_pd(dzi, dzi)), dcr));
+				dzi = _mm512_add_pd(_mm512_mul_pd(two, _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(Zr, dzi), _mm512_mul_pd(Zi, dzr)), _mm512_mul_pd(dzr, dzi))), dci);
+				dzr = t;
+				m = _mm512_add_pd(m, one);
+			}
+
+			__m256i counts = _mm512_cvtpd_epi32(n);
+			alignas(32) unsigned int wide[8];
+			_mm256_store_si256((__m256i*)wide, counts);
+			unsigned short narrow[8];
+			for (unsigned int l = 0; l < 8; l++) narrow[l] = (unsigned short)wide[l];
+			alignas(64) double magnitudes[8];
+			_mm512_store_pd(magnitudes, magnitude);
+			StoreLanes<8>(narrow, magnitudes, 0, params.max_iterations, iterations, fractions, i, span.count);
+		}
+		return 0;
+	}
+
+	// Every channel is a * (256 - fraction) + b * fraction in 16 bits, the vector kernel gives the same colors
+	static inline unsigned int BlendColors(unsigned int a, unsigned int b, unsigned int fraction)
+	{
+		unsigned int blended = 0;
+		for (unsigned int shift = 0; shift < 32; shift += 8)
+			blended |= ((((a >> shift) & 0xFF) * (256 - fraction) + ((b >> shift) & 0xFF) * fraction) >> 8) << shift;
+		return blended;
+	}
+
+	static void ColorScalar(const ColorParams& params, const unsigned short* iterations, const unsigned char* fractions, unsigned int count, unsigned int* colors)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int entry = (params.offset + iterations[i]) % params.size;
+			colors[i] = params.palette[entry];
+			if (params.smooth) colors[i] = BlendColors(colors[i], params.palette[entry + 1 == params.size ? 0 : entry + 1], fractions[i]);
+		}
+	}
+
+	TARGET_AVX2 static void ColorAVX2(const ColorParams& params, const unsigned short* iterations, const unsigned char* fractions, unsigned int count, unsigned int* colors)
+	{
+		const __m256i offset = _mm256_set1_epi32(int(params.offset));
+		const __m256i size = _mm256_set1_epi32(int(params.size));
+		const __m256i last = _mm256_set1_epi32(int(params.size) - 1);
+		const __m256i one = _mm256_set1_epi32(1);
+		const __m256i full = _mm256_set1_epi16(256);
+		const __m256i zero = _mm256_setzero_si256();
+		unsigned int i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			// offset + n is at most 2 * size, subtracting size twice is the modulo
+			__m256i entry = _mm256_add_epi32(offset, _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(iterations + i))));
+			entry = _mm256_sub_epi32(entry, _mm256_and_si256(_mm256_cmpgt_epi32(entry, last), size));
+			entry = _mm256_sub_epi32(entry, _mm256_and_si256(_mm256_cmpgt_epi32(entry, last), size));
+			__m256i color = _mm256_i32gather_epi32((const int*)params.palette, entry, 4);
+			if (params.smooth)
+			{
+				__m256i next = _mm256_add_epi32(entry, one);
+				next = _mm256_andnot_si256(_mm256_cmpgt_epi32(next, last), next);
+				__m256i following = _mm256_i32gather_epi32((const int*)params.palette, next, 4);
+				// Channels are unpacked to 16 bits, pixels 0, 1 (4, 5) to the low half of each 128 bit lane and 2, 3 (6, 7) to the high half
+				// Their weights are the fraction of the pixel repeated in the 4 channels, unpacked the same way
+				__m256i fraction = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(fractions + i)));
+				fraction = _mm256_or_si256(fraction, _mm256_slli_epi32(fraction, 16));
+				__m256i weightLow = _mm256_unpacklo_epi32(fraction, fraction);
+				__m256i weightHigh = _mm256_unpackhi_epi32(fraction, fraction);
+				__m256i low = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(color, zero), _mm256_sub_epi16(full, weightLow)),
+					_mm256_mullo_epi16(_mm256_unpacklo_epi8(following, zero), weightLow));
+				__m256i high = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(color, zero), _mm256_sub_epi16(full, weightHigh)),
+					_mm256_mullo_epi16(_mm256_unpackhi_epi8(following, zero), weightHigh));
+				color = _mm256_packus_epi16(_mm256_srli_epi16(low, 8), _mm256_srli_epi16(high, 8));
+			}
+			_mm256_storeu_si256((__m256i*)(colors + i), color);
+		}
+		ColorScalar(params, iterations + i, fractions + i, count - i, colors + i);
+	}
+
+	KernelLevel DetectKernelLevel()
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) return KERNEL_SCALAR;
+		__cpuid(info, 1);
+		// The operating system must save the vector registers on context switches
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		if (!osxsave) return KERNEL_SCALAR;
+		unsigned long long xcr0 = _xgetbv(0);
+		__cpuidex(info, 7, 0);
+		bool avx2 = (info[1] & (1 << 5)) != 0 && (xcr0 & 0x06) == 0x06;
+		bool avx512 = (info[1] & (1 << 16)) != 0 && (xcr0 & 0xE6) == 0xE6;
+		if (avx512) return KERNEL_AVX512;
+		if (avx2) return KERNEL_AVX2;
+		return KERNEL_SCALAR;
+#else
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f")) return KERNEL_AVX512;
+		if (__builtin_cpu_supports("avx2")) return KERNEL_AVX2;
+		return KERNEL_SCALAR;
+#endif
+	}
+
+	EscapeKernel SelectKernel(KernelLevel level, bool singlePrecision)
+	{
+		switch (level)
+		{
+		case KERNEL_AVX512:
+			return singlePrecision ? EscapeAVX512Float : EscapeAVX512Double;
+		case KERNEL_AVX2:
+			return singlePrecision ? EscapeAVX2Float : EscapeAVX2Double;
+		default:
+			return singlePrecision ? EscapeScalar<float> : EscapeScalar<double>;
+		}
+	}
+
+	EscapeKernel SelectPerturbationKernel(KernelLevel level)
+	{
+		switch (level)
+		{
+		case KERNEL_AVX512:
+			return PerturbAVX512;
+		case KERNEL_AVX2:
+			return PerturbAVX2;
+		default:
+			return PerturbScalar;
+		}
+	}
+
+	ColorKernel SelectColorKernel(KernelLevel level)
+	{
+		return level >= KERNEL_AVX2 ? ColorAVX2 : ColorScalar;
+	}
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+// Escape time kernels
+// Every kernel iterates one row or column of pixels and writes how many iterations each pixel took
+// and how far past its last iteration it escaped, coloring maps both through the palette in a separate pass
+// The vector kernels iterate 4 / 8 doubles (AVX2 / AVX-512) or 8 / 16 floats per instruction,
+// lanes that escaped are masked out and the row stops as soon as every lane of the vector escaped
+// The best kernel the CPU supports is picked at runtime, the scalar kernel works everywhere
+namespace Fractal
+{
+	// The number diverges once its absolute value goes beyond 3.5, compared squared to avoid the square root
+	const double bailout_sq = 3.5 * 3.5;
+
+	// Pixel k is at (x0 + dx * k, y0 + dy * k), dy is zero for rows and dx is zero for columns
+	// Pixels are numbered from the viewport's origin so that a pixel is at the same place whichever span computes it
+	// Pixel i of the span is k = first + stride * i, strided spans compute every other pixel of a row or column
+	typedef struct Span
+	{
+		double x0;
+		double dx;
+		double y0;
+		double dy;
+		unsigned int first;	// Index of the first pixel of the span
+		unsigned int count;	// Pixels in the span
+		unsigned int stride;
+	} Span, *pSpan;
+
+	// Orbit of the reference pixel of the perturbation kernels, computed in high precision and rounded to double
+	typedef struct Reference
+	{
+		const double* zr;
+		const double* zi;
+		unsigned int length;	// Points of the orbit, it ends once it escapes or reaches max_iterations
+		// Series approximation, every pixel starts at iteration skip with dz = A * d + B * d^2 + C * d^3
+		// where d is the offset of the pixel, which is dc for Mandelbrot and the starting dz for Julia
+		unsigned int skip;
+		double ar, ai;
+		double br, bi;
+		double cr, ci;
+	} Reference, *pReference;
+
+	// Pixels inside the set are counted max_iterations + 1, which has to fit in an unsigned short
+	const unsigned short max_iterations_limit = 65534;
+
+	typedef struct EscapeParams
+	{
+		unsigned short max_iterations;	// At most max_iterations_limit
+		bool julia;			// Julia sets start from the pixel and add a constant, Mandelbrot starts from zero and adds the pixel
+		double cr;			// Julia constant
+		double ci;
+		bool interior;		// Stop early on pixels that are known to be inside the set
+		const Reference* reference;	// Perturbation kernels only, spans are then offsets from the reference pixel
+	} EscapeParams, *pEscapeParams;
+
+	// iterations[i] = 1 + number of times Z = Z^2 + C was applied before |Z| went beyond 3.5, at most max_iterations + 1
+	// Pixels inside the set run to max_iterations unless the interior shortcuts catch them first:
+	// - Mandelbrot only, C in the main cardioid or in the period 2 bulb never escapes, tested before iterating
+	// - Periodicity (Brent), Z is saved at iterations 1, 2, 4, 8... and once it comes back to the saved value the orbit is a cycle
+	// fractions[i] = 1 - log2(log|Z|^2 / log 3.5^2) in 256ths, where Z is the first point beyond 3.5, 0 for pixels that didn't escape
+	// iterations + fraction is the smooth iteration count, continuous from one pixel to the next
+	// Returns how many iterations the shortcuts skipped
+	typedef unsigned int(*EscapeKernel)(const EscapeParams& params, const Span& span, unsigned short* iterations, unsigned char* fractions);
+
+	enum KernelLevel
+	{
+		KERNEL_SCALAR,
+		KERNEL_AVX2,
+		KERNEL_AVX512
+	};
+
+	// Best instruction set supported by the CPU and the operating system
+	KernelLevel DetectKernelLevel();
+	// Single precision kernels are twice as wide, but can only be used while pixels are far enough apart, see [Fractal::singlePrecision]
+	EscapeKernel SelectKernel(KernelLevel level, bool singlePrecision);
+	// Deep zoom kernels, every pixel iterates its offset dz from the reference orbit Z in double
+	// dz' = 2 * Z * dz + dz^2 + dc, the pixel is Z + dz and only dz has to be precise, which doubles are at any zoom
+	// When Z + dz gets closer to zero than dz the offset has lost its precision, the pixel is then rebased:
+	// its Z + dz becomes the offset from the start of the reference orbit, which also happens when the reference ends
+	EscapeKernel SelectPerturbationKernel(KernelLevel level);
+	// Floats stop telling neighbouring pixels apart around this distance times the number of iterations,
+	// every iteration adds its rounding error and pixels near the border of the set amplify it
+	const double single_precision_limit = 1.0 / (1 << 16);
+	// Distance under which Z is considered back to the saved value, a cycle found this way is only approximately one
+	// but orbits that come this close to repeating themselves are attracted by the cycle
+	const double period_tolerance = 1e-12;
+	const float period_tolerance_single = 1e-6f;
+
+	typedef struct ColorParams
+	{
+		const unsigned int* palette;	// 32 bit colors
+		unsigned int size;				// Entries in the palette
+		unsigned int offset;			// Palette animation, pixel n takes entry (offset + n) % size, offset < size
+		bool smooth;					// Blend every channel with the next entry by the fraction
+	} ColorParams, *pColorParams;
+
+	// colors[i] = palette[(offset + iterations[i]) % size], iterations must be at most size + 1
+	// Smooth colors move from that entry towards the next one by fractions[i] / 256
+	// Iterations don't change while the palette is animated, so only this runs again
+	typedef void(*ColorKernel)(const ColorParams& params, const unsigned short* iterations, const unsigned char* fractions, unsigned int count, unsigned int* colors);
+	// The palette lookups are gathers, which aren't faster 16 wide, so AVX-512 uses the AVX2 kernel
+	ColorKernel SelectColorKernel(KernelLevel level);
+};
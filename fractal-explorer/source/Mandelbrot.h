@@ -28,34 +28,15 @@ namespace Fractal
 			// This allows you to reset the fractal
 			vp_rst = vp;
 			normalizer_rst = normalizer;
+			// Also sets the precise origin from the normalizer
+			Reset();
 		}
 
 		void DrawFractal(unsigned char nThreads) override
 		{
-			// Now for the iterations
-			double area = pxViewportArea / nThreads;
-			std::thread *pThreads = new std::thread[nThreads];
-
-			for (unsigned char t = 0; t < nThreads; t++)
-				// Lambda functions FTW
-				pThreads[t] = std::thread([=]() {
-				for (unsigned int pixel = round(area * t); pixel < round((area) * (t + 1)); pixel++)
-				{
-					Complex Z(0, 0);
-					Complex C(normalizeX(pxLUT[pixel].x), normalizeY(pxLUT[pixel].y));
-
-					unsigned short iterations = 0;
-					// When the absolute value goes beyond 3.5 the number will diverge at that point
-					while (iterations++ < max_iterations && Z.abs() <= 3.5) Z = Z.sq() + C;
-					// Drawing to pixel from the color palette, relative to the current position of the cursor
-					// TODO: test if performance increases
-					//fractal[pixel] = palette[iterations]; // 48.16ms
-					fractal[pixel] = *(palette + ((cursorPosition + iterations) % color_i(PALLETE_SIZE))); // 47.54ms
-				}
-			});
-
-			for (unsigned char t = 0; t < nThreads; t++)
-				pThreads[t].join();
+			// Z starts at zero and every pixel is its own C
+			EscapeParams params = { max_iterations, false, 0.0, 0.0, interiorShortcuts, nullptr };
+			Render(nThreads, params);
 
 			if (autoAnimate) AnimateColor(1);
 		}
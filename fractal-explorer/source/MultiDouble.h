@@ -0,0 +1,274 @@
+#pragma once
+
+#include <math.h>
+#include "BigFixed.h"
+
+// Numbers made of 2 or 4 doubles that don't overlap, the value is their exact sum
+// Double-double keeps 106 bits and quad-double 212 bits, for a fraction of the cost of BigFixed
+// Every operation relies on doubles rounding exactly as IEEE says, so they must not be compiled with
+// fused multiply adds or fast math (MSVC /fp:precise, the default, is fine)
+//
+// More information:
+// Hida, Li, Bailey - Library for double-double and quad-double arithmetic
+//
+namespace Fractal
+{
+	// a + b = s + error exactly
+	inline double TwoSum(double a, double b, double& error)
+	{
+		double s = a + b;
+		double v = s - a;
+		error = (a - (s - v)) + (b - v);
+		return s;
+	}
+
+	// Same, only when |a| >= |b|
+	inline double QuickTwoSum(double a, double b, double& error)
+	{
+		double s = a + b;
+		error = b - (s - a);
+		return s;
+	}
+
+	// a * b = p + error exactly, Dekker's product splits both operands in halves of 26 bits
+	inline double TwoProd(double a, double b, double& error)
+	{
+		const double split = 134217729.0;	// 2^27 + 1
+		double t = split * a;
+		double ahi = t - (t - a);
+		double alo = a - ahi;
+		t = split * b;
+		double bhi = t - (t - b);
+		double blo = b - bhi;
+		double p = a * b;
+		error = ((ahi * bhi - p) + ahi * blo + alo * bhi) + alo * blo;
+		return p;
+	}
+
+	class DoubleDouble
+	{
+	public:
+		double hi;
+		double lo;
+
+		DoubleDouble() : hi(0.0), lo(0.0)
+		{}
+		DoubleDouble(double value) : hi(value), lo(0.0)
+		{}
+		DoubleDouble(double hi, double lo) : hi(hi), lo(lo)
+		{}
+		// Every component is the rounded remainder of the previous ones
+		explicit DoubleDouble(const BigFixed& value)
+		{
+			hi = value.ToDouble();
+			lo = (value - BigFixed(hi)).ToDouble();
+		}
+
+		inline double ToDouble() const
+		{
+			return hi;
+		}
+
+		inline DoubleDouble operator-() const
+		{
+			return DoubleDouble(-hi, -lo);
+		}
+
+		inline DoubleDouble operator+(const DoubleDouble& B) const
+		{
+			double e;
+			double f;
+			double s = TwoSum(hi, B.hi, e);
+			double t = TwoSum(lo, B.lo, f);
+			e += t;
+			s = QuickTwoSum(s, e, e);
+			e += f;
+			s = QuickTwoSum(s, e, e);
+			return DoubleDouble(s, e);
+		}
+
+		inline DoubleDouble operator-(const DoubleDouble& B) const
+		{
+			return *this + -B;
+		}
+
+		inline DoubleDouble operator*(const DoubleDouble& B) const
+		{
+			double e;
+			double p = TwoProd(hi, B.hi, e);
+			e += hi * B.lo + lo * B.hi;
+			p = QuickTwoSum(p, e, e);
+			return DoubleDouble(p, e);
+		}
+	};
+
+	// a + b + c, the sum goes to a and the two error terms to b and c
+	inline void ThreeSum(double& a, double& b, double& c)
+	{
+		double t2;
+		double t3;
+		double t1 = TwoSum(a, b, t2);
+		a = TwoSum(c, t1, t3);
+		b = TwoSum(t2, t3, c);
+	}
+
+	// Same, both error terms are summed into b
+	inline void ThreeSum2(double& a, double& b, double& c)
+	{
+		double t2;
+		double t3;
+		double t1 = TwoSum(a, b, t2);
+		a = TwoSum(c, t1, t3);
+		b = t2 + t3;
+	}
+
+	// Turns 5 overlapping components into 4 that don't overlap
+	inline void Renormalize(double& c0, double& c1, double& c2, double& c3, double c4)
+	{
+		double s0;
+		double s1;
+		double s2 = 0.0;
+		double s3 = 0.0;
+		s0 = QuickTwoSum(c3, c4, c4);
+		s0 = QuickTwoSum(c2, s0, c3);
+		s0 = QuickTwoSum(c1, s0, c2);
+		c0 = QuickTwoSum(c0, s0, c1);
+		s0 = c0;
+		s1 = c1;
+		if (s1 != 0.0)
+		{
+			s1 = QuickTwoSum(s1, c2, s2);
+			if (s2 != 0.0)
+			{
+				s2 = QuickTwoSum(s2, c3, s3);
+				if (s3 != 0.0) s3 += c4;
+				else s2 = QuickTwoSum(s2, c4, s3);
+			}
+			else
+			{
+				s1 = QuickTwoSum(s1, c3, s2);
+				if (s2 != 0.0) s2 = QuickTwoSum(s2, c4, s3);
+				else s1 = QuickTwoSum(s1, c4, s2);
+			}
+		}
+		else
+		{
+			s0 = QuickTwoSum(s0, c2, s1);
+			if (s1 != 0.0)
+			{
+				s1 = QuickTwoSum(s1, c3, s2);
+				if (s2 != 0.0) s2 = QuickTwoSum(s2, c4, s3);
+				else s1 = QuickTwoSum(s1, c4, s2);
+			}
+			else
+			{
+				s0 = QuickTwoSum(s0, c3, s1);
+				if (s1 != 0.0) s1 = QuickTwoSum(s1, c4, s2);
+				else s0 = QuickTwoSum(s0, c4, s1);
+			}
+		}
+		c0 = s0;
+		c1 = s1;
+		c2 = s2;
+		c3 = s3;
+	}
+
+	class QuadDouble
+	{
+	public:
+		double x[4];	// Largest first
+
+		QuadDouble()
+		{
+			x[0] = x[1] = x[2] = x[3] = 0.0;
+		}
+		QuadDouble(double value)
+		{
+			x[0] = value;
+			x[1] = x[2] = x[3] = 0.0;
+		}
+		QuadDouble(double x0, double x1, double x2, double x3)
+		{
+			x[0] = x0;
+			x[1] = x1;
+			x[2] = x2;
+			x[3] = x3;
+		}
+		explicit QuadDouble(const BigFixed& value)
+		{
+			BigFixed remainder = value;
+			for (unsigned int i = 0; i < 4; i++)
+			{
+				x[i] = remainder.ToDouble();
+				remainder -= BigFixed(x[i]);
+			}
+		}
+
+		inline double ToDouble() const
+		{
+			return x[0];
+		}
+
+		inline QuadDouble operator-() const
+		{
+			return QuadDouble(-x[0], -x[1], -x[2], -x[3]);
+		}
+
+		// Sloppy addition, the error bound only holds when both operands have the same sign, which is more than the orbit needs
+		inline QuadDouble operator+(const QuadDouble& B) const
+		{
+			double t0;
+			double t1;
+			double t2;
+			double t3;
+			double s0 = TwoSum(x[0], B.x[0], t0);
+			double s1 = TwoSum(x[1], B.x[1], t1);
+			double s2 = TwoSum(x[2], B.x[2], t2);
+			double s3 = TwoSum(x[3], B.x[3], t3);
+			s1 = TwoSum(s1, t0, t0);
+			ThreeSum(s2, t0, t1);
+			ThreeSum2(s3, t0, t2);
+			t0 = t0 + t1 + t3;
+			Renormalize(s0, s1, s2, s3, t0);
+			return QuadDouble(s0, s1, s2, s3);
+		}
+
+		inline QuadDouble operator-(const QuadDouble& B) const
+		{
+			return *this + -B;
+		}
+
+		// Products below 2^-212 relative are left out
+		inline QuadDouble operator*(const QuadDouble& B) const
+		{
+			double q0;
+			double q1;
+			double q2;
+			double q3;
+			double q4;
+			double q5;
+			double t0;
+			double t1;
+			double p0 = TwoProd(x[0], B.x[0], q0);
+			double p1 = TwoProd(x[0], B.x[1], q1);
+			double p2 = TwoProd(x[1], B.x[0], q2);
+			double p3 = TwoProd(x[0], B.x[2], q3);
+			double p4 = TwoProd(x[1], B.x[1], q4);
+			double p5 = TwoProd(x[2], B.x[0], q5);
+
+			ThreeSum(p1, p2, q0);
+			// (p2, q1, q2) + (p3, p4, p5)
+			ThreeSum(p2, q1, q2);
+			ThreeSum(p3, p4, p5);
+			double s0 = TwoSum(p2, p3, t0);
+			double s1 = TwoSum(q1, p4, t1);
+			double s2 = q2 + p5;
+			s1 = TwoSum(s1, t0, t0);
+			s2 += t0 + t1;
+
+			s1 += x[0] * B.x[3] + x[1] * B.x[2] + x[2] * B.x[1] + x[3] * B.x[0] + q0 + q3 + q4 + q5;
+			Renormalize(p0, p1, s0, s1, s2);
+			return QuadDouble(p0, p1, s0, s1);
+		}
+	};
+};
\ No newline at end of file
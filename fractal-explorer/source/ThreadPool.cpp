@@ -0,0 +1,155 @@
+#include "ThreadPool.h"
+#include <assert.h>
+#include <chrono>
+
+Fractal::ThreadPool::ThreadPool(unsigned int nThreads) : task(nullptr), generation(0), running(0), quit(false)
+{
+	Start(nThreads);
+}
+
+Fractal::ThreadPool::~ThreadPool()
+{
+	Stop();
+}
+
+void Fractal::ThreadPool::Start(unsigned int nThreads)
+{
+	assert(nThreads > 0);
+	quit = false;
+	for (unsigned int i = 0; i < nThreads; i++)
+	{
+		workers.emplace_back(new Worker());
+		workers.back()->busy = 0.0;
+		workers.back()->done = 0;
+		workers.back()->stolen = 0;
+	}
+	// Threads are started once every worker exists, since they steal from each other
+	// They start from the current generation, otherwise they would take the last run for a new one and wake up
+	for (unsigned int i = 0; i < nThreads; i++)
+		workers[i]->thread = std::thread(&ThreadPool::Work, this, i, generation);
+}
+
+void Fractal::ThreadPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		quit = true;
+	}
+	start.notify_all();
+	for (auto& worker : workers)
+		worker->thread.join();
+	workers.clear();
+}
+
+void Fractal::ThreadPool::Resize(unsigned int nThreads)
+{
+	if (nThreads == workers.size()) return;
+	Stop();
+	Start(nThreads);
+}
+
+unsigned int Fractal::ThreadPool::Size() const
+{
+	return workers.size();
+}
+
+bool Fractal::ThreadPool::Next(unsigned int index, unsigned int& item)
+{
+	Worker& self = *workers[index];
+	{
+		std::lock_guard<std::mutex> guard(self.lock);
+		if (!self.items.empty())
+		{
+			item = self.items.front();
+			self.items.pop_front();
+			return true;
+		}
+	}
+	// Steal from the back, the items the owner would get to last
+	for (unsigned int i = 1; i < workers.size(); i++)
+	{
+		Worker& victim = *workers[(index + i) % workers.size()];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (!victim.items.empty())
+		{
+			item = victim.items.back();
+			victim.items.pop_back();
+			self.stolen++;
+			return true;
+		}
+	}
+	return false;
+}
+
+void Fractal::ThreadPool::Work(unsigned int index, unsigned int seen)
+{
+	Worker& self = *workers[index];
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			start.wait(guard, [&]() { return quit || generation != seen; });
+			if (quit) return;
+			seen = generation;
+		}
+
+		auto begin = std::chrono::high_resolution_clock::now();
+		unsigned int item;
+		while (Next(index, item))
+		{
+			(*task)(item, index);
+			self.done++;
+		}
+		self.busy += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+		std::lock_guard<std::mutex> guard(lock);
+		if (--running == 0) finished.notify_one();
+	}
+}
+
+void Fractal::ThreadPool::Run(unsigned int items, const Task& task)
+{
+	// The task is set before any item can be taken, workers never hold the pool lock while they take a worker lock
+	std::unique_lock<std::mutex> guard(lock);
+	this->task = &task;
+
+	// Contiguous ranges keep neighbouring tiles on the same thread until stealing starts
+	unsigned int nWorkers = workers.size();
+	for (unsigned int w = 0; w < nWorkers; w++)
+	{
+		std::lock_guard<std::mutex> items_guard(workers[w]->lock);
+		for (unsigned int item = items * w / nWorkers; item < items * (w + 1) / nWorkers; item++)
+			workers[w]->items.push_back(item);
+	}
+
+	running = nWorkers;
+	generation++;
+	start.notify_all();
+	finished.wait(guard, [&]() { return running == 0; });
+	this->task = nullptr;
+}
+
+void Fractal::ThreadPool::ClearStatistics()
+{
+	for (auto& worker : workers)
+	{
+		worker->busy = 0.0;
+		worker->done = 0;
+		worker->stolen = 0;
+	}
+}
+
+double Fractal::ThreadPool::BusyTime(unsigned int worker) const
+{
+	return workers[worker]->busy;
+}
+
+unsigned int Fractal::ThreadPool::ItemsDone(unsigned int worker) const
+{
+	return workers[worker]->done;
+}
+
+unsigned int Fractal::ThreadPool::ItemsStolen(unsigned int worker) const
+{
+	return workers[worker]->stolen;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <deque>
+
+namespace Fractal
+{
+	// Persistent workers, created once and reused frame after frame
+	// A run splits its items (tiles) into one deque per worker, workers take items from the front of their own deque
+	// and steal from the back of the others once it's empty, so the threads that get the set interior don't finish last
+	class ThreadPool
+	{
+	public:
+		typedef std::function<void(unsigned int item, unsigned int worker)> Task;
+	private:
+		typedef struct Worker
+		{
+			std::thread thread;
+			std::mutex lock;
+			std::deque<unsigned int> items;
+			double busy;		// Seconds spent on items since the statistics were cleared
+			unsigned int done;	// Items run since the statistics were cleared, including stolen ones
+			unsigned int stolen;
+		} Worker, *pWorker;
+
+		std::vector<std::unique_ptr<Worker>> workers;
+		std::mutex lock;
+		std::condition_variable start;
+		std::condition_variable finished;
+		const Task* task;
+		unsigned int generation;	// Incremented by every run, wakes the workers up
+		unsigned int running;		// Workers that haven't finished the current run
+		bool quit;
+
+		void Work(unsigned int index, unsigned int seen);
+		bool Next(unsigned int index, unsigned int& item);
+		void Start(unsigned int nThreads);
+		void Stop();
+	public:
+		ThreadPool(unsigned int nThreads);
+		~ThreadPool();
+
+		// Only restarts the workers when the count changes
+		void Resize(unsigned int nThreads);
+		unsigned int Size() const;
+		// Calls task(item, worker) for every item in [0, items) and returns once all of them are done
+		void Run(unsigned int items, const Task& task);
+
+		// Statistics of the runs since the last clear, to check that the work is balanced
+		// A frame clears them before its first run
+		void ClearStatistics();
+		double BusyTime(unsigned int worker) const;
+		unsigned int ItemsDone(unsigned int worker) const;
+		unsigned int ItemsStolen(unsigned int worker) const;
+	};
+};
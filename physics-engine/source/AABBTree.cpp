@@ -0,0 +1,87 @@
+#include "AABBTree.hpp"
+
+#include <algorithm>
+
+namespace PHYSICS_NAMESPACE
+{
+
+u32 AABBTree::build_node(const aabb_t* boxes, u32 first, u32 last)
+{
+    u32 index = m_nodes.size();
+    m_nodes.emplace_back();
+
+    aabb_t box = boxes[m_items[first]];
+    for (u32 i = first + 1; i < last; ++i) box = merge(box, boxes[m_items[i]]);
+    m_nodes[index].box = box;
+
+    if (last - first == 1)
+    {
+        m_nodes[index].left = m_items[first];
+        m_nodes[index].right = leaf;
+        return index;
+    }
+
+    // Split along the longest axis at the median of the box centers
+    vec2 extent = box.max - box.min;
+    u32 axis = (extent.x > extent.y) ? 0 : 1;
+    u32 middle = first + (last - first) / 2;
+
+    std::nth_element(m_items.begin() + first, m_items.begin() + middle, m_items.begin() + last, [boxes, axis](u32 a, u32 b)
+    {
+        vec2 ca = boxes[a].min + boxes[a].max;
+        vec2 cb = boxes[b].min + boxes[b].max;
+        return axis ? (ca.y < cb.y) : (ca.x < cb.x);
+    });
+
+    // Children are appended after this node, so fetch the indices before writing
+    u32 left = build_node(boxes, first, middle);
+    u32 right = build_node(boxes, middle, last);
+    m_nodes[index].left = left;
+    m_nodes[index].right = right;
+    return index;
+}
+
+void AABBTree::build(const aabb_t* boxes, u32 count)
+{
+    m_nodes.clear();
+    if (!count) return;
+
+    m_nodes.reserve(2 * count - 1);
+    m_items.resize(count);
+    for (u32 i = 0; i < count; ++i) m_items[i] = i;
+
+    build_node(boxes, 0, count);
+}
+
+void AABBTree::clear()
+{
+    m_nodes.clear();
+}
+
+bool AABBTree::empty() const
+{
+    return m_nodes.empty();
+}
+
+const aabb_t& AABBTree::bounds() const
+{
+    assert(!m_nodes.empty());
+    return m_nodes.front().box;
+}
+
+const AABBTree::node_t* AABBTree::nodes() const
+{
+    return m_nodes.data();
+}
+
+u32 AABBTree::nodes_c() const
+{
+    return m_nodes.size();
+}
+
+void AABBTree::assign(const node_t* nodes, u32 nodes_c)
+{
+    m_nodes.assign(nodes, nodes + nodes_c);
+}
+
+}
@@ -0,0 +1,122 @@
+#ifndef AABB_TREE_HPP
+#define AABB_TREE_HPP
+
+#include "Configuration.hpp"
+#include "PhysicsTypes.hpp"
+#include "Vector2.hpp"
+#include "Math.hpp"
+
+#include <vector>
+
+namespace PHYSICS_NAMESPACE
+{
+
+/// Bounding box utility functions
+
+static inline bool overlaps(const aabb_t& a, const aabb_t& b)
+{
+    return (a.min.x <= b.max.x) && (a.max.x >= b.min.x)
+        && (a.min.y <= b.max.y) && (a.max.y >= b.min.y);
+}
+
+static inline aabb_t merge(const aabb_t& a, const aabb_t& b)
+{
+    return
+    {
+        {math::min(a.min.x, b.min.x), math::min(a.min.y, b.min.y)},
+        {math::max(a.max.x, b.max.x), math::max(a.max.y, b.max.y)}
+    };
+}
+
+// Bounding box of [box] after being rotated and then translated
+static inline aabb_t transform(const aabb_t& box, vec2 translation, precision_t radians)
+{
+    precision_t sin, cos;
+    math::fast::sin_cos(radians, sin, cos);
+    vec2 corners[4] =
+    {
+        box.min.rotate(sin, cos),
+        vec2 {box.max.x, box.min.y}.rotate(sin, cos),
+        box.max.rotate(sin, cos),
+        vec2 {box.min.x, box.max.y}.rotate(sin, cos)
+    };
+    aabb_t result = {corners[0], corners[0]};
+    for (auto corner : corners) result = merge(result, {corner, corner});
+    result.min += translation;
+    result.max += translation;
+    return result;
+}
+
+// Bounding volume hierarchy built top-down from a fixed set of boxes
+// Used both by the broadphase (rebuilt every step) and by compound bodies (built once)
+class AABBTree final
+{
+
+public:
+
+    static constexpr u32 leaf = ~0U;
+    // Deepest tree [query] can walk, built trees stay far below it and loaded ones are checked against it
+    static constexpr u32 max_depth = 63;
+
+    struct node_t
+    {
+        aabb_t box;
+        u32 left;  // Index of the left child, or the item when this is a leaf
+        u32 right; // Index of the right child, or [leaf]
+    };
+
+private:
+
+    std::vector<node_t> m_nodes;
+    std::vector<u32> m_items;
+
+    u32 build_node(const aabb_t* boxes, u32 first, u32 last);
+
+public:
+
+    // Items reported by the queries are indices into the boxes array
+    void build(const aabb_t* boxes, u32 count);
+    void clear();
+
+    bool empty() const;
+    const aabb_t& bounds() const;
+
+    // Direct access to the nodes, so that a tree can be saved and restored without building it again
+    const node_t* nodes() const;
+    u32 nodes_c() const;
+    void assign(const node_t* nodes, u32 nodes_c);
+
+    // Calls callback(item) for every box overlapping [box]
+    template <typename F>
+    void query(const aabb_t& box, F callback) const;
+
+};
+
+template <typename F>
+inline void AABBTree::query(const aabb_t& box, F callback) const
+{
+    if (m_nodes.empty()) return;
+
+    // Median splits keep the tree balanced, so its depth is bounded by log2 of the item count
+    // Every level pops one node and pushes two, the stack never holds more than the depth plus one
+    u32 stack[max_depth + 1];
+    u32 top = 0;
+    stack[top++] = 0;
+
+    while (top)
+    {
+        const node_t& node = m_nodes[stack[--top]];
+        if (!overlaps(node.box, box)) continue;
+        if (node.right == leaf)
+        {
+            callback(node.left);
+            continue;
+        }
+        stack[top++] = node.left;
+        stack[top++] = node.right;
+    }
+}
+
+}
+
+#endif // AABB_TREE_HPP
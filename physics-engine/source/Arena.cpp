@@ -0,0 +1,86 @@
+#include "Arena.hpp"
+
+#include <cstdint>
+
+namespace PHYSICS_NAMESPACE
+{
+
+/// Frame arena class implementation
+
+FrameArena::FrameArena(std::size_t capacity)
+    : m_offset {0}, m_used {0}, m_high_water {0}, m_growths {0}
+{
+    m_blocks.push_back({std::unique_ptr<u8[]>(new u8[capacity]), capacity});
+}
+
+void FrameArena::grow(std::size_t size)
+{
+    // At least double the capacity, so that a step that keeps growing only does it a few times
+    std::size_t capacity = stats().capacity;
+    std::size_t block = math::max(capacity, size);
+    m_blocks.push_back({std::unique_ptr<u8[]>(new u8[block]), block});
+    m_offset = 0;
+    ++m_growths;
+}
+
+void* FrameArena::allocate(std::size_t size, std::size_t alignment)
+{
+    assert(alignment && !(alignment & (alignment - 1)));
+    block_t* block = &m_blocks.back();
+    std::uintptr_t base = reinterpret_cast<std::uintptr_t>(block->memory.get());
+    std::size_t start = ((base + m_offset + alignment - 1) & ~std::uintptr_t(alignment - 1)) - base;
+    if (start + size > block->size)
+    {
+        // Bytes left at the end of the block count as used, they won't be handed out before the next reset
+        m_used += block->size - m_offset;
+        grow(size + alignment);
+        block = &m_blocks.back();
+        base = reinterpret_cast<std::uintptr_t>(block->memory.get());
+        m_offset = 0;
+        start = ((base + alignment - 1) & ~std::uintptr_t(alignment - 1)) - base;
+    }
+    m_used += start + size - m_offset;
+    m_offset = start + size;
+    m_high_water = math::max(m_high_water, m_used);
+    return block->memory.get() + start;
+}
+
+void FrameArena::reset()
+{
+    // Replace the blocks of a step that didn't fit with a single one that holds all of it
+    if (m_blocks.size() > 1)
+    {
+        std::size_t capacity = stats().capacity;
+        m_blocks.clear();
+        m_blocks.push_back({std::unique_ptr<u8[]>(new u8[capacity]), capacity});
+    }
+    m_offset = 0;
+    m_used = 0;
+}
+
+void FrameArena::reserve(std::size_t capacity)
+{
+    if (capacity <= stats().capacity) return;
+    // Only an empty arena can be replaced, a busy one gets the memory at its next reset
+    if (m_used == 0)
+    {
+        m_blocks.clear();
+        m_blocks.push_back({std::unique_ptr<u8[]>(new u8[capacity]), capacity});
+        return;
+    }
+    // Like when growing, the bytes left at the end of the current block count as used until the next reset
+    m_used += m_blocks.back().size - m_offset;
+    std::size_t block = capacity - stats().capacity;
+    m_blocks.push_back({std::unique_ptr<u8[]>(new u8[block]), block});
+    m_offset = 0;
+    m_high_water = math::max(m_high_water, m_used);
+}
+
+arena_stats_t FrameArena::stats() const
+{
+    std::size_t capacity = 0;
+    for (const auto& block : m_blocks) capacity += block.size;
+    return {capacity, m_high_water, m_growths};
+}
+
+}
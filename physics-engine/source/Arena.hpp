@@ -0,0 +1,249 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include "Configuration.hpp"
+#include "Math.hpp"
+
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <type_traits>
+
+namespace PHYSICS_NAMESPACE
+{
+
+/// Frame arena
+/// Linear allocator for the scratch memory of a step: allocating bumps an offset and [reset] frees everything at once
+/// A step that doesn't fit takes extra blocks from the heap, they are merged into a single block at the next reset,
+/// so once the arena has seen the largest step it never touches the heap again
+
+struct arena_stats_t
+{
+    std::size_t capacity;   // Bytes available before the arena has to grow
+    std::size_t high_water; // Most bytes used between two resets, a good value to reserve up front
+    u32 growths;            // Number of times a step didn't fit and memory was taken from the heap
+};
+
+class FrameArena final
+{
+
+    struct block_t
+    {
+        std::unique_ptr<u8[]> memory;
+        std::size_t size;
+    };
+
+    std::vector<block_t> m_blocks;
+    std::size_t m_offset; // First free byte of the last block
+    std::size_t m_used;   // Bytes used since the last reset, including padding
+    std::size_t m_high_water;
+    u32 m_growths;
+
+    void grow(std::size_t size);
+
+public:
+
+    explicit FrameArena(std::size_t capacity = 64 * 1024);
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(std::size_t size, std::size_t alignment);
+
+    template <typename T>
+    T* allocate(u32 count);
+
+    // Everything allocated since the last reset becomes invalid
+    void reset();
+    // Makes sure that [capacity] bytes fit without growing
+    void reserve(std::size_t capacity);
+
+    arena_stats_t stats() const;
+
+};
+
+template <typename T>
+inline T* FrameArena::allocate(u32 count)
+{
+    return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+}
+
+// Growable array whose elements live in a frame arena, only for trivially copyable types
+// Growing copies the elements into an allocation twice as big, the old one is reclaimed by the next reset of the arena
+// The first allocation after a reset holds an eighth more elements than the array had at most before it, so an
+// array whose size doesn't change much from step to step allocates once per step instead of growing from scratch
+template <typename T>
+class FrameArray final
+{
+
+    static_assert(std::is_trivially_copyable<T>::value, "Frame arrays never run constructors nor destructors");
+
+    FrameArena* m_arena;
+    T* m_data;
+    u32 m_size;
+    u32 m_capacity;
+    u32 m_high_water; // Largest size since the last reset
+    u32 m_previous;   // Capacity to start from, the largest size between the two previous resets and some room
+
+    void grow(u32 capacity);
+
+public:
+
+    FrameArray();
+
+    // Empties the array, new elements are allocated from [arena]
+    // Must be called after the arena that held the previous elements was reset
+    void reset(FrameArena& arena);
+
+    void push_back(const T& value);
+    // New elements are left uninitialized
+    void resize(u32 size);
+    void assign(u32 size, const T& value);
+    void clear();
+
+    T* data();
+    const T* data() const;
+    u32 size() const;
+    bool empty() const;
+
+    T& operator[](u32 index);
+    const T& operator[](u32 index) const;
+    T& back();
+
+    T* begin();
+    T* end();
+    const T* begin() const;
+    const T* end() const;
+
+};
+
+template <typename T>
+inline FrameArray<T>::FrameArray()
+    : m_arena {nullptr}, m_data {nullptr}, m_size {0}, m_capacity {0}, m_high_water {0}, m_previous {0}
+{
+}
+
+template <typename T>
+inline void FrameArray<T>::grow(u32 capacity)
+{
+    assert(m_arena);
+    T* data = m_arena->allocate<T>(capacity);
+    if (m_size) std::memcpy(data, m_data, m_size * sizeof(T));
+    m_data = data;
+    m_capacity = capacity;
+}
+
+template <typename T>
+inline void FrameArray<T>::reset(FrameArena& arena)
+{
+    m_arena = &arena;
+    m_data = nullptr;
+    m_previous = math::max(m_high_water, m_size);
+    m_previous += m_previous / 8;
+    m_high_water = 0;
+    m_size = 0;
+    m_capacity = 0;
+}
+
+template <typename T>
+inline void FrameArray<T>::push_back(const T& value)
+{
+    if (m_size == m_capacity) grow(math::max(m_capacity * 2, m_previous, 16U));
+    m_data[m_size++] = value;
+}
+
+template <typename T>
+inline void FrameArray<T>::resize(u32 size)
+{
+    if (size > m_capacity) grow(math::max(m_capacity * 2, m_previous, size));
+    // Shrinking is the only way the size goes down, together with [clear]
+    m_high_water = math::max(m_high_water, m_size);
+    m_size = size;
+}
+
+template <typename T>
+inline void FrameArray<T>::assign(u32 size, const T& value)
+{
+    resize(size);
+    for (u32 i = 0; i < size; ++i) m_data[i] = value;
+}
+
+template <typename T>
+inline void FrameArray<T>::clear()
+{
+    m_high_water = math::max(m_high_water, m_size);
+    m_size = 0;
+}
+
+template <typename T>
+inline T* FrameArray<T>::data()
+{
+    return m_data;
+}
+
+template <typename T>
+inline const T* FrameArray<T>::data() const
+{
+    return m_data;
+}
+
+template <typename T>
+inline u32 FrameArray<T>::size() const
+{
+    return m_size;
+}
+
+template <typename T>
+inline bool FrameArray<T>::empty() const
+{
+    return m_size == 0;
+}
+
+template <typename T>
+inline T& FrameArray<T>::operator[](u32 index)
+{
+    assert(index < m_size);
+    return m_data[index];
+}
+
+template <typename T>
+inline const T& FrameArray<T>::operator[](u32 index) const
+{
+    assert(index < m_size);
+    return m_data[index];
+}
+
+template <typename T>
+inline T& FrameArray<T>::back()
+{
+    assert(m_size);
+    return m_data[m_size - 1];
+}
+
+template <typename T>
+inline T* FrameArray<T>::begin()
+{
+    return m_data;
+}
+
+template <typename T>
+inline T* FrameArray<T>::end()
+{
+    return m_data + m_size;
+}
+
+template <typename T>
+inline const T* FrameArray<T>::begin() const
+{
+    return m_data;
+}
+
+template <typename T>
+inline const T* FrameArray<T>::end() const
+{
+    return m_data + m_size;
+}
+
+}
+
+#endif // ARENA_HPP
@@ -19,7 +19,12 @@ using f32 = float;
 using f64 = double;
 
 // Default precision to use
+// Define PHYSICS_DOUBLE_PRECISION to build the engine with 64 bit floats (large worlds)
+#ifdef PHYSICS_DOUBLE_PRECISION
+using precision_t = f64;
+#else
 using precision_t = f32;
+#endif
 
 // Include commonly used headers
 #include <cassert>
@@ -0,0 +1,337 @@
+#include "DebugDraw.hpp"
+
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+namespace PHYSICS_NAMESPACE
+{
+
+/// Debug draw class implementation
+
+DebugDraw::DebugDraw()
+    : m_last {0}
+{
+    for (u32 i = 0; i < circle_segments; ++i)
+    {
+        precision_t sin, cos;
+        math::fast::sin_cos(math::pi() * precision_t(2 * i) / precision_t(circle_segments), sin, cos);
+        m_circle[i] = {cos, sin};
+    }
+}
+
+std::vector<debug_vertex_t>& DebugDraw::batch(u32 primitive, f32 size)
+{
+    if ((m_last < m_batches.size()) && (m_batches[m_last].primitive == primitive) && (m_batches[m_last].size == size))
+        return m_batches[m_last].vertices;
+
+    // There are only a handful of batches, a linear search is enough
+    for (m_last = 0; m_last < m_batches.size(); ++m_last)
+    {
+        if ((m_batches[m_last].primitive == primitive) && (m_batches[m_last].size == size))
+            return m_batches[m_last].vertices;
+    }
+    m_batches.push_back({primitive, size, {}});
+    return m_batches.back().vertices;
+}
+
+void DebugDraw::clear()
+{
+    for (auto& b : m_batches) b.vertices.clear();
+    m_vertices.clear();
+    m_commands.clear();
+}
+
+void DebugDraw::point(vec2 p, u32 color, f32 size)
+{
+    batch(debug_points, size).push_back({f32(p.x), f32(p.y), color});
+}
+
+void DebugDraw::line(vec2 a, vec2 b, u32 color, f32 width)
+{
+    auto& vertices = batch(debug_lines, width);
+    vertices.push_back({f32(a.x), f32(a.y), color});
+    vertices.push_back({f32(b.x), f32(b.y), color});
+}
+
+void DebugDraw::arrow(vec2 from, vec2 to, u32 color, f32 width)
+{
+    vec2 v = to - from;
+    vec2 cw45 = v.rotate(0.25F * math::pi()) * 0.3F;
+    vec2 ccw45 = v.rotate(-0.25F * math::pi()) * 0.3F;
+    line(from, to, color, width);
+    line(to, to - cw45, color, width);
+    line(to, to - ccw45, color, width);
+}
+
+void DebugDraw::triangle(vec2 a, vec2 b, vec2 c, u32 color)
+{
+    auto& vertices = batch(debug_triangles, 0.0F);
+    vertices.push_back({f32(a.x), f32(a.y), color});
+    vertices.push_back({f32(b.x), f32(b.y), color});
+    vertices.push_back({f32(c.x), f32(c.y), color});
+}
+
+void DebugDraw::circle(vec2 center, precision_t radius, u32 color, f32 width)
+{
+    auto& vertices = batch(debug_lines, width);
+    vec2 previous = center + m_circle[circle_segments - 1] * radius;
+    for (u32 i = 0; i < circle_segments; ++i)
+    {
+        vec2 next = center + m_circle[i] * radius;
+        vertices.push_back({f32(previous.x), f32(previous.y), color});
+        vertices.push_back({f32(next.x), f32(next.y), color});
+        previous = next;
+    }
+}
+
+void DebugDraw::polygon(const vec2* positions, u32 vertices_c, const transform_t& transform, u32 color, f32 width)
+{
+    precision_t sin, cos;
+    math::fast::sin_cos(transform.orientation, sin, cos);
+
+    auto& vertices = batch(debug_lines, width);
+    vec2 previous = positions[vertices_c - 1].rotate(sin, cos) + transform.position;
+    for (u32 i = 0; i < vertices_c; ++i)
+    {
+        vec2 next = positions[i].rotate(sin, cos) + transform.position;
+        vertices.push_back({f32(previous.x), f32(previous.y), color});
+        vertices.push_back({f32(next.x), f32(next.y), color});
+        previous = next;
+    }
+}
+
+void DebugDraw::object(const object_t& o)
+{
+    constexpr u32 circle_color = debug_color(128, 128, 255);
+    constexpr u32 polygon_color = debug_color(0, 255, 0);
+    constexpr u32 center_color = debug_color(255, 0, 0);
+
+    if (o.type == object_type_t::circle)
+    {
+        auto& c = static_cast<const circle_t&>(o);
+        vec2 radius = vec2 {c.radius, 0.0F}.rotate(o.transform.orientation);
+        circle(o.transform.position, c.radius, circle_color, 3.0F);
+        line(o.transform.position, o.transform.position + radius, circle_color, 3.0F);
+        point(o.transform.position, circle_color, 5.0F);
+    }
+    else if (o.type == object_type_t::polygon)
+    {
+        auto& p = static_cast<const polygon_t&>(o);
+        polygon(p.positions, p.vertices_c, o.transform, polygon_color, 2.0F);
+        point(o.transform.position, center_color, 5.0F);
+    }
+    else
+    {
+        auto& m = static_cast<const compound_t&>(o);
+        precision_t sin, cos;
+        math::fast::sin_cos(o.transform.orientation, sin, cos);
+        for (u32 i = 0; i < m.children_c; ++i)
+        {
+            const child_t& child = m.children[i];
+            transform_t transform = {child.offset.rotate(sin, cos) + o.transform.position,
+                                     child.orientation + o.transform.orientation,
+                                     o.transform.scale};
+            if (child.type == object_type_t::circle) circle(transform.position, child.radius, circle_color, 3.0F);
+            else polygon(child.positions, child.vertices_c, transform, polygon_color, 2.0F);
+        }
+        point(o.transform.position, center_color, 5.0F);
+    }
+}
+
+void DebugDraw::finish()
+{
+    m_vertices.clear();
+    m_commands.clear();
+    for (auto& b : m_batches)
+    {
+        if (b.vertices.empty()) continue;
+        m_commands.push_back({b.primitive, u32(m_vertices.size()), u32(b.vertices.size()), b.size});
+        m_vertices.insert(m_vertices.end(), b.vertices.begin(), b.vertices.end());
+    }
+}
+
+const debug_vertex_t* DebugDraw::vertices() const
+{
+    return m_vertices.data();
+}
+
+u32 DebugDraw::vertices_c() const
+{
+    return m_vertices.size();
+}
+
+const debug_command_t* DebugDraw::commands() const
+{
+    return m_commands.data();
+}
+
+u32 DebugDraw::commands_c() const
+{
+    return m_commands.size();
+}
+
+/// Debug image class implementation
+
+DebugImage::DebugImage(u32 width, u32 height)
+    : m_width {width}, m_height {height}, m_pixels(width * height, debug_color(0, 0, 0)),
+      m_min {0.0F, 0.0F}, m_scale {1.0F, 1.0F}
+{
+    assert(width && height);
+}
+
+void DebugImage::view(vec2 min, vec2 max)
+{
+    m_min = min;
+    m_scale = {precision_t(m_width) / (max.x - min.x), precision_t(m_height) / (max.y - min.y)};
+}
+
+void DebugImage::clear(u32 color)
+{
+    std::fill(m_pixels.begin(), m_pixels.end(), color);
+}
+
+vec2 DebugImage::to_pixels(const debug_vertex_t& v) const
+{
+    // World space has y pointing up, images are stored top row first
+    return {(v.x - m_min.x) * m_scale.x, precision_t(m_height) - (v.y - m_min.y) * m_scale.y};
+}
+
+void DebugImage::plot(i32 x, i32 y, u32 color, i32 size)
+{
+    // Thick points and lines are drawn with a square brush centered on the pixel
+    i32 half = size / 2;
+    i32 x0 = math::max(x - half, 0);
+    i32 y0 = math::max(y - half, 0);
+    i32 x1 = math::min(x - half + size, i32(m_width));
+    i32 y1 = math::min(y - half + size, i32(m_height));
+    for (i32 j = y0; j < y1; ++j)
+        for (i32 i = x0; i < x1; ++i)
+            m_pixels[j * m_width + i] = color;
+}
+
+void DebugImage::raster_line(vec2 a, vec2 b, u32 color, i32 size)
+{
+    // Clip to the image grown by the brush first (Liang-Barsky), so that only the visible part of the line is walked
+    const precision_t lower[2] = {-precision_t(size), -precision_t(size)};
+    const precision_t upper[2] = {precision_t(m_width + size), precision_t(m_height + size)};
+    vec2 d = b - a;
+    const precision_t start[2] = {a.x, a.y};
+    const precision_t delta[2] = {d.x, d.y};
+    precision_t t0 = 0.0F;
+    precision_t t1 = 1.0F;
+    for (u32 axis = 0; axis < 2; ++axis)
+    {
+        if (delta[axis] == 0.0F)
+        {
+            if (!((start[axis] >= lower[axis]) && (start[axis] <= upper[axis]))) return;
+            continue;
+        }
+        precision_t enter = (lower[axis] - start[axis]) / delta[axis];
+        precision_t leave = (upper[axis] - start[axis]) / delta[axis];
+        if (enter > leave) std::swap(enter, leave);
+        t0 = math::max(t0, enter);
+        t1 = math::min(t1, leave);
+        if (!(t0 <= t1)) return;
+    }
+    b = a + d * t1;
+    a = a + d * t0;
+
+    // Digital differential analyzer, one sample per pixel along the longest axis
+    // A clipped line is never longer than the grown image, unless a coordinate was infinite or NaN
+    d = b - a;
+    precision_t length = math::max(math::abs(d.x), math::abs(d.y));
+    if (!(length <= precision_t(m_width + m_height + 4 * size))) return;
+    i32 steps = i32(length) + 1;
+    vec2 increment = d / precision_t(steps);
+    for (i32 i = 0; i <= steps; ++i)
+    {
+        plot(i32(std::floor(a.x)), i32(std::floor(a.y)), color, size);
+        a += increment;
+    }
+}
+
+void DebugImage::raster_triangle(vec2 a, vec2 b, vec2 c, u32 color)
+{
+    auto edge = [](vec2 p, vec2 q, vec2 r) { return (q.x - p.x) * (r.y - p.y) - (q.y - p.y) * (r.x - p.x); };
+    precision_t area = edge(a, b, c);
+    if (area == 0.0F) return;
+    if (area < 0.0F) std::swap(b, c);
+
+    // Bounding box clipped to the image, then an inside test at every pixel center
+    i32 x0 = math::max(i32(std::floor(math::min(a.x, math::min(b.x, c.x)))), 0);
+    i32 y0 = math::max(i32(std::floor(math::min(a.y, math::min(b.y, c.y)))), 0);
+    i32 x1 = math::min(i32(std::ceil(math::max(a.x, math::max(b.x, c.x)))), i32(m_width));
+    i32 y1 = math::min(i32(std::ceil(math::max(a.y, math::max(b.y, c.y)))), i32(m_height));
+    for (i32 y = y0; y < y1; ++y)
+    {
+        for (i32 x = x0; x < x1; ++x)
+        {
+            vec2 p = {precision_t(x) + 0.5F, precision_t(y) + 0.5F};
+            if ((edge(a, b, p) >= 0.0F) && (edge(b, c, p) >= 0.0F) && (edge(c, a, p) >= 0.0F))
+                m_pixels[y * m_width + x] = color;
+        }
+    }
+}
+
+void DebugImage::render(const DebugDraw& buffer)
+{
+    const debug_vertex_t* vertices = buffer.vertices();
+    for (u32 i = 0; i < buffer.commands_c(); ++i)
+    {
+        const debug_command_t& command = buffer.commands()[i];
+        const debug_vertex_t* v = vertices + command.first;
+        i32 size = math::max(i32(command.size + 0.5F), 1);
+        switch (command.primitive)
+        {
+        case debug_points:
+            for (u32 j = 0; j < command.count; ++j)
+            {
+                vec2 p = to_pixels(v[j]);
+                plot(i32(std::floor(p.x)), i32(std::floor(p.y)), v[j].color, size);
+            }
+            break;
+        case debug_lines:
+            for (u32 j = 0; j + 1 < command.count; j += 2)
+                raster_line(to_pixels(v[j]), to_pixels(v[j + 1]), v[j].color, size);
+            break;
+        case debug_triangles:
+            for (u32 j = 0; j + 2 < command.count; j += 3)
+                raster_triangle(to_pixels(v[j]), to_pixels(v[j + 1]), to_pixels(v[j + 2]), v[j].color);
+            break;
+        }
+    }
+}
+
+u32 DebugImage::pixel(u32 x, u32 y) const
+{
+    assert((x < m_width) && (y < m_height));
+    return m_pixels[y * m_width + x];
+}
+
+const u32* DebugImage::pixels() const
+{
+    return m_pixels.data();
+}
+
+bool DebugImage::save(const char* path) const
+{
+    std::FILE* file = std::fopen(path, "wb");
+    if (!file) return false;
+    std::fprintf(file, "P6\n%u %u\n255\n", m_width, m_height);
+    std::vector<u8> row(m_width * 3);
+    for (u32 y = 0; y < m_height; ++y)
+    {
+        for (u32 x = 0; x < m_width; ++x)
+        {
+            u32 color = m_pixels[y * m_width + x];
+            row[x * 3 + 0] = u8(color);
+            row[x * 3 + 1] = u8(color >> 8);
+            row[x * 3 + 2] = u8(color >> 16);
+        }
+        std::fwrite(row.data(), 1, row.size(), file);
+    }
+    return std::fclose(file) == 0;
+}
+
+}
@@ -0,0 +1,130 @@
+#ifndef DEBUG_DRAW_HPP
+#define DEBUG_DRAW_HPP
+
+#include "Configuration.hpp"
+#include "PhysicsTypes.hpp"
+#include "Vector2.hpp"
+#include "Math.hpp"
+
+#include <vector>
+
+namespace PHYSICS_NAMESPACE
+{
+
+/// Debug drawing
+/// Shapes are accumulated into batches (one per primitive and size) and packed into a single vertex array
+/// A backend submits the whole frame with one draw call per batch
+
+// Colors are stored as bytes in RGBA order, ready to be consumed as four normalized unsigned bytes
+constexpr u32 debug_color(u8 r, u8 g, u8 b, u8 a = 255)
+{
+    return u32(r) | (u32(g) << 8) | (u32(b) << 16) | (u32(a) << 24);
+}
+
+enum debug_primitive_t
+{
+    debug_points,
+    debug_lines,    // Every two vertices make a line
+    debug_triangles // Every three vertices make a triangle
+};
+
+struct debug_vertex_t
+{
+    f32 x, y;
+    u32 color;
+};
+
+struct debug_command_t
+{
+    u32 primitive;  // See [debug_primitive_t]
+    u32 first;      // First vertex of the batch in the vertex array
+    u32 count;      // Number of vertices
+    f32 size;       // Point size or line width in pixels
+};
+
+class DebugDraw final
+{
+
+    static constexpr u32 circle_segments = 24;
+
+    struct batch_t
+    {
+        u32 primitive;
+        f32 size;
+        std::vector<debug_vertex_t> vertices;
+    };
+
+    std::vector<batch_t> m_batches;
+    u32 m_last; // Most recently used batch, consecutive shapes usually share it
+
+    std::vector<debug_vertex_t> m_vertices;
+    std::vector<debug_command_t> m_commands;
+
+    vec2 m_circle[circle_segments]; // Unit circle, so that circles don't compute any sin/cos
+
+    std::vector<debug_vertex_t>& batch(u32 primitive, f32 size);
+
+public:
+
+    DebugDraw();
+
+    // Empties the buffer, the memory is kept for the next frame
+    void clear();
+
+    void point(vec2 p, u32 color, f32 size = 1.0F);
+    void line(vec2 a, vec2 b, u32 color, f32 width = 1.0F);
+    void arrow(vec2 from, vec2 to, u32 color, f32 width = 1.0F);
+    void triangle(vec2 a, vec2 b, vec2 c, u32 color);
+    void circle(vec2 center, precision_t radius, u32 color, f32 width = 1.0F);
+    // Outline of a convex polygon given in model space
+    void polygon(const vec2* positions, u32 vertices_c, const transform_t& transform, u32 color, f32 width = 1.0F);
+
+    // Draws an object of the engine with its outline, orientation and center
+    void object(const object_t& o);
+
+    // Packs the batches into one vertex array, must be called before handing the buffer to a backend
+    void finish();
+
+    const debug_vertex_t* vertices() const;
+    u32 vertices_c() const;
+    const debug_command_t* commands() const;
+    u32 commands_c() const;
+
+};
+
+// Software backend, rasterizes a debug draw buffer into an image without any graphics API
+// Meant for tests and for inspecting simulations on machines without a display
+class DebugImage final
+{
+
+    u32 m_width;
+    u32 m_height;
+    std::vector<u32> m_pixels; // Same color layout as [debug_vertex_t], first row is the top of the image
+    vec2 m_min;   // World space rectangle mapped to the image
+    vec2 m_scale; // Pixels per world unit
+
+    void plot(i32 x, i32 y, u32 color, i32 size);
+    void raster_line(vec2 a, vec2 b, u32 color, i32 size);
+    void raster_triangle(vec2 a, vec2 b, vec2 c, u32 color);
+    vec2 to_pixels(const debug_vertex_t& v) const;
+
+public:
+
+    DebugImage(u32 width, u32 height);
+
+    // Chooses the part of the world that is visible, y points up like in the engine
+    void view(vec2 min, vec2 max);
+    void clear(u32 color = debug_color(0, 0, 0));
+    void render(const DebugDraw& buffer);
+
+    u32 pixel(u32 x, u32 y) const;
+    const u32* pixels() const;
+
+    // Writes the image as a binary PPM file
+    bool save(const char* path) const;
+
+};
+
+}
+
+#endif // DEBUG_DRAW_HPP
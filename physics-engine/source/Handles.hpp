@@ -0,0 +1,240 @@
+#ifndef HANDLES_HPP
+#define HANDLES_HPP
+
+#include "Configuration.hpp"
+
+#include <vector>
+
+namespace PHYSICS_NAMESPACE
+{
+
+/// Handle arrays
+/// Packed arrays whose elements are referred to by handles instead of addresses, so that the world can keep
+/// the elements contiguous for the step while the game holds on to them across additions and removals
+/// A handle holds a slot and a generation: once its element is removed the handle is stale and finds nothing,
+/// even after the slot was reused by another element
+
+// Typed so that the handles of fields and joints can't be mixed up, a zero id never refers to anything
+template <typename T>
+struct handle_t
+{
+    u32 id;
+};
+
+template <typename T>
+class HandleArray final
+{
+
+    static constexpr u32 slot_bits = 20;
+    static constexpr u32 slot_mask = (1U << slot_bits) - 1;
+    static constexpr u32 no_slot = ~0U;
+
+    struct slot_t
+    {
+        u32 index;      // Element of the slot, or the next free slot
+        u32 generation; // Bumped by every removal, never zero
+    };
+
+    std::vector<T> m_elements;
+    std::vector<u32> m_owners; // Slot of every element
+    std::vector<slot_t> m_slots;
+    u32 m_free; // First free slot
+
+    const slot_t* slot(handle_t<T> handle) const;
+    static u32 next(u32 generation);
+    void erase_element(u32 element);
+
+public:
+
+    HandleArray();
+
+    handle_t<T> insert(const T& value);
+    // Moves the last element into the place of the removed one, does nothing when the handle is stale
+    void erase(handle_t<T> handle);
+    // Erases every element for which predicate(element) is true
+    template <typename F>
+    void erase_if(F predicate);
+    // Removes every element, and makes every handle stale
+    void clear();
+    // Replaces every element, the handles handed out so far become stale
+    void assign(const T* elements, u32 count);
+
+    // Null when the element was removed
+    T* find(handle_t<T> handle);
+    const T* find(handle_t<T> handle) const;
+
+    // Elements are packed in no particular order, their addresses change when any element is added or removed
+    T* data();
+    const T* data() const;
+    u32 size() const;
+    bool empty() const;
+
+    T* begin();
+    T* end();
+    const T* begin() const;
+    const T* end() const;
+
+};
+
+template <typename T>
+inline HandleArray<T>::HandleArray()
+    : m_free {no_slot}
+{
+}
+
+template <typename T>
+inline const typename HandleArray<T>::slot_t* HandleArray<T>::slot(handle_t<T> handle) const
+{
+    u32 index = handle.id & slot_mask;
+    if (!handle.id || (index >= m_slots.size())) return nullptr;
+    const slot_t& s = m_slots[index];
+    return (s.generation == (handle.id >> slot_bits)) ? &s : nullptr;
+}
+
+template <typename T>
+inline u32 HandleArray<T>::next(u32 generation)
+{
+    // Generations wrap around without ever being zero, a stale handle is only mistaken after 4095 reuses of its slot
+    generation = (generation + 1) & (~0U >> slot_bits);
+    return generation ? generation : 1;
+}
+
+template <typename T>
+inline handle_t<T> HandleArray<T>::insert(const T& value)
+{
+    u32 index = m_free;
+    if (index == no_slot)
+    {
+        assert(m_slots.size() <= slot_mask);
+        index = m_slots.size();
+        m_slots.push_back({0, 1});
+    }
+    else
+    {
+        m_free = m_slots[index].index;
+    }
+    m_slots[index].index = m_elements.size();
+    m_elements.push_back(value);
+    m_owners.push_back(index);
+    return {(m_slots[index].generation << slot_bits) | index};
+}
+
+template <typename T>
+inline void HandleArray<T>::erase_element(u32 element)
+{
+    u32 index = m_owners[element];
+    m_elements[element] = m_elements.back();
+    m_owners[element] = m_owners.back();
+    m_slots[m_owners[element]].index = element;
+    m_elements.pop_back();
+    m_owners.pop_back();
+
+    m_slots[index] = {m_free, next(m_slots[index].generation)};
+    m_free = index;
+}
+
+template <typename T>
+inline void HandleArray<T>::erase(handle_t<T> handle)
+{
+    const slot_t* s = slot(handle);
+    if (s) erase_element(s->index);
+}
+
+template <typename T>
+template <typename F>
+inline void HandleArray<T>::erase_if(F predicate)
+{
+    // The last element moves into the hole, so the same position is tested again
+    for (u32 i = 0; i < m_elements.size();)
+    {
+        if (predicate(m_elements[i])) erase_element(i);
+        else ++i;
+    }
+}
+
+template <typename T>
+inline void HandleArray<T>::clear()
+{
+    assign(nullptr, 0);
+}
+
+template <typename T>
+inline void HandleArray<T>::assign(const T* elements, u32 count)
+{
+    // Every slot goes back to the free list, lowest first so that the new elements take them in order
+    m_elements.clear();
+    m_owners.clear();
+    m_free = no_slot;
+    for (u32 i = m_slots.size(); i-- > 0;)
+    {
+        m_slots[i] = {m_free, next(m_slots[i].generation)};
+        m_free = i;
+    }
+    for (u32 i = 0; i < count; ++i) insert(elements[i]);
+}
+
+template <typename T>
+inline T* HandleArray<T>::find(handle_t<T> handle)
+{
+    const slot_t* s = slot(handle);
+    return s ? &m_elements[s->index] : nullptr;
+}
+
+template <typename T>
+inline const T* HandleArray<T>::find(handle_t<T> handle) const
+{
+    const slot_t* s = slot(handle);
+    return s ? &m_elements[s->index] : nullptr;
+}
+
+template <typename T>
+inline T* HandleArray<T>::data()
+{
+    return m_elements.data();
+}
+
+template <typename T>
+inline const T* HandleArray<T>::data() const
+{
+    return m_elements.data();
+}
+
+template <typename T>
+inline u32 HandleArray<T>::size() const
+{
+    return m_elements.size();
+}
+
+template <typename T>
+inline bool HandleArray<T>::empty() const
+{
+    return m_elements.empty();
+}
+
+template <typename T>
+inline T* HandleArray<T>::begin()
+{
+    return m_elements.data();
+}
+
+template <typename T>
+inline T* HandleArray<T>::end()
+{
+    return m_elements.data() + m_elements.size();
+}
+
+template <typename T>
+inline const T* HandleArray<T>::begin() const
+{
+    return m_elements.data();
+}
+
+template <typename T>
+inline const T* HandleArray<T>::end() const
+{
+    return m_elements.data() + m_elements.size();
+}
+
+}
+
+#endif // HANDLES_HPP
@@ -10,8 +10,13 @@
 #include "Math.hpp"
 #include "Timer.hpp"
 #include "Physics.hpp"
+#include "Particles.hpp"
+#include "Scene.hpp"
+#include "Trace.hpp"
+#include "DebugDraw.hpp"
 
 #include <vector>
+#include <thread>
 
 using namespace PHYSICS_NAMESPACE;
 
@@ -23,96 +28,35 @@ struct Mouse
     f32 x, y;
 };
 
-void draw_vector(vec2 a, vec2 b)
+// OpenGL backend for the debug draw buffer, one glDrawArrays per batch
+void submit(const DebugDraw& buffer)
 {
-    vec2 v = b - a;
-    vec2 cw45 = v.rotate(0.25F * math::pi()).normalize() * v.length() * 0.3F;
-    vec2 ccw45 = v.rotate(-0.25F * math::pi()).normalize() * v.length() * 0.3F;
-    // White
-    glColor3f(1.0F, 1.0F, 1.0F);
-    glBegin(GL_LINES);
-    glVertex2f(a.x, a.y);
-    glVertex2f(a.x + v.x, a.y + v.y);
-    glVertex2f(a.x + v.x, a.y + v.y);
-    glVertex2f(a.x + v.x - cw45.x, a.y + v.y - cw45.y);
-    glVertex2f(a.x + v.x, a.y + v.y);
-    glVertex2f(a.x + v.x - ccw45.x, a.y + v.y - ccw45.y);
-    glEnd();
-}
-
-void draw_circle(const object_t& o)
-{
-    constexpr int n = 25;
-    constexpr f32 pi2 = math::pi() * 2.0F;
-    constexpr f32 step = pi2 / f32(n);
-
-    auto circle = static_cast<const circle_t&>(o);
-    // Light blue
-    glColor3f(0.5F, 0.5F, 1.0F);
-    glLineWidth(3.0F);
-    glBegin(GL_LINE_LOOP);
-    for (f32 theta = 0.0F; theta < pi2; theta += step)
-    {
-        f32 sin = math::sin(theta);
-        f32 cos = math::cos(theta);
-        vec2 vertex = circle.transform.position + vec2 {cos, sin} * circle.radius;
-        glVertex2f(vertex.x, vertex.y);
-    }
-    glEnd();
-    glBegin(GL_LINES);
-    glVertex2f(o.transform.position.x, o.transform.position.y);
-    vec2 r = o.transform.position + vec2 {circle.radius, 0.0F}.rotate(o.transform.orientation);
-    glVertex2f(r.x, r.y);
-    glEnd();
-    glPointSize(5.0F);
-    glBegin(GL_POINTS);
-    glVertex2f(o.transform.position.x, o.transform.position.y);
-    glEnd();
-}
-
-void draw_polygon(const object_t& o)
-{
-    auto polygon = static_cast<const polygon_t&>(o);
-    glLineWidth(2.0F);
-    glColor3f(1.0F, 1.0F, 1.0F);
-    glPushMatrix();
-    glTranslatef(polygon.transform.position.x, polygon.transform.position.y, 0.0F);
-    glRotatef(polygon.transform.orientation * 180.0F / math::pi(), 0.0F, 0.0F, 1.0F);
-    for (std::size_t i = 0, j = polygon.vertices_c - 1; i < polygon.vertices_c; j = i++)
-    {
-        vec2 a = polygon.positions[j];
-        vec2 b = polygon.positions[i];
-        vec2 n = polygon.normals[j];
-        vec2 m = (a + b) * 0.5F;
-        //draw_vector(m, m + n * 17.5F);
-    }
-    glBegin(GL_LINE_LOOP);
-    glColor3f(0.0F, 1.0F, 0.0F);
-    for (std::size_t i = 0; i < polygon.vertices_c; i++)
+    static const GLenum modes[] = {GL_POINTS, GL_LINES, GL_TRIANGLES};
+    if (!buffer.vertices_c()) return;
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, sizeof(debug_vertex_t), &buffer.vertices()->x);
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(debug_vertex_t), &buffer.vertices()->color);
+    for (u32 i = 0; i < buffer.commands_c(); ++i)
     {
-        vec2 p = polygon.positions[i];
-        glVertex2f(p.x, p.y);
+        const debug_command_t& command = buffer.commands()[i];
+        glPointSize(command.size);
+        glLineWidth(command.size);
+        glDrawArrays(modes[command.primitive], command.first, command.count);
     }
-    glEnd();
-    glColor3f(1.0F, 0.0F, 0.0F);
-    glPointSize(5.0F);
-    glBegin(GL_POINTS);
-    glVertex2f(0.0F, 0.0F);
-    glEnd();
-    glPopMatrix();
-}
-
-void draw_object(const object_t& o)
-{
-    // This is what a vtable looks like
-    static void(*jt[])(const object_t&) = {draw_circle, draw_polygon};
-    jt[u32(o.type)](o);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
 }
 
 constexpr f32 width = 800.0F;
 constexpr f32 height = 600.0F;
 
 Physics2D p(1000, 0.01F);
+Scene level;
+TraceRecorder recorder;
+DebugDraw debug;
+ParticleSystem2D particles(20000, 2.0F, std::thread::hardware_concurrency());
 
 polygon_t* playa = nullptr;
 polygon_t* enemy = nullptr;
@@ -150,6 +94,50 @@ void render(f64 dt, bool* kb, const Mouse& m)
     }
     allow = !m.buttons [Mouse::LEFT];
 
+    // Right button sprays particles that last twenty seconds
+    if (m.buttons [Mouse::RIGHT])
+    {
+        for (u32 i = 0; (i < 20) && (particles.particles() < particles.capacity()); ++i)
+        {
+            vec2 velocity = {math::random(-50.0F, 50.0F), math::random(-50.0F, 50.0F)};
+            particles.add(vec2 {m.x, height - m.y} + velocity * 0.05F, velocity, 20.0F);
+        }
+    }
+
+    // R toggles recording of an input trace, to be profiled offline with tools/Replay.cpp
+    static bool was_recording = false;
+    if (kb ['r'] && !was_recording)
+    {
+        if (recorder.is_open())
+        {
+            p.record(nullptr);
+            recorder.close();
+        }
+        else if (recorder.open("physics.trace", p))
+        {
+            p.record(&recorder);
+        }
+    }
+    was_recording = kb ['r'];
+
+    // V drops a vortex under the cursor, or removes the one that was dropped
+    static handle_t<force_field_t> vortex = {};
+    static bool was_vortex = false;
+    if (kb ['v'] && !was_vortex)
+    {
+        if (vortex.id)
+        {
+            p.remove(vortex);
+            vortex = {};
+        }
+        else
+        {
+            vec2 center = {m.x, height - m.y};
+            vortex = p.add(force_field_t {field_vortex, aabb_t {center - vec2 {200.0F, 200.0F}, center + vec2 {200.0F, 200.0F}}, center, {}, 2000.0F, 200.0F});
+        }
+    }
+    was_vortex = kb ['v'];
+
     if (kb ['w']) playa->motion.velocity.y += speed * f32(dt);
     if (kb ['s']) playa->motion.velocity.y -= speed * f32(dt);
     if (kb ['d']) playa->motion.velocity.x += speed * f32(dt);
@@ -158,10 +146,16 @@ void render(f64 dt, bool* kb, const Mouse& m)
     while (accumulator > 0.0)
     {
         p.simulate();       
+        particles.simulate(p);
         accumulator -= p.interval();
     }
 
-    p.for_each_object(draw_object);
+    debug.clear();
+    p.debug_draw(debug);
+    constexpr u32 particle_color = debug_color(77, 153, 255);
+    for (u32 i = 0; i < particles.particles(); ++i) debug.point(vec2 {particles.x()[i], particles.y()[i]}, particle_color, 2.0F);
+    debug.finish();
+    submit(debug);
 }
 
 int main(int argc, char** argv)
@@ -214,7 +208,35 @@ int main(int argc, char** argv)
         f32 sin = math::sin(i);
         asteroid_like.emplace_back(vec2 {cos, sin} * bias);
     }
-    ast = gfx::Mesh(std::move(asteroid_like));
+    // The random walk on the radius can make the outline concave, so use its (simplified) hull instead
+    ast = gfx::Mesh::convex_hull(std::move(asteroid_like), 12, 5.0F);
+
+    // Concave outlines are split into convex parts that move as a single body
+    std::vector<vec2> hook =
+    {
+        vec2 {  0.0F,   0.0F},
+        vec2 {120.0F,   0.0F},
+        vec2 {120.0F,  60.0F},
+        vec2 { 90.0F,  60.0F},
+        vec2 { 90.0F,  30.0F},
+        vec2 { 30.0F,  30.0F},
+        vec2 { 30.0F, 120.0F},
+        vec2 {  0.0F, 120.0F}
+    };
+    std::vector<gfx::Mesh> hook_parts = gfx::Mesh::convex_decomposition(std::move(hook));
+    std::vector<child_t> hook_children;
+    for (auto& part : hook_parts)
+    {
+        hook_children.push_back(child_t {polygon, part.origin(), 0.0F, 1.0F, 0.0F,
+                                         &part.positions().front(),
+                                         &part.normals().front(),
+                                         part.vertices()});
+    }
+    p.add(transform_t {vec2 {width * 0.5F, height * 0.5F}, 0.0F, 1.0F},
+          material_t {0.1F, 0.5F, 0.3F},
+          motion_t {},
+          &hook_children.front(),
+          hook_children.size());
 
     playa = p.add(transform_t {vec2{100.0F, 100.0F}, 0.0F, 1.0F},
                   material_t {1.0F, 0.5F, 0.3F},
@@ -271,7 +293,35 @@ int main(int argc, char** argv)
           &boxp.positions().front(),
           &boxp.normals().front(),
           boxp.vertices());
-    
+
+    // A chain of links hanging from the ceiling, each one pinned to the previous
+    std::vector<vec2> link =
+    {
+        vec2 { 10.0F,  3.0F},
+        vec2 {-10.0F,  3.0F},
+        vec2 {-10.0F, -3.0F},
+        vec2 { 10.0F, -3.0F}
+    };
+    gfx::Mesh linkp(std::move(link));
+    object_t* previous = nullptr;
+    for (u32 i = 0; i < 12; ++i)
+    {
+        vec2 pin = {width * 0.75F + f32(i) * 20.0F, height - 50.0F};
+        polygon_t* piece = p.add(transform_t {pin + vec2 {10.0F, 0.0F}, 0.0F, 1.0F},
+                                 material_t {0.1F, 0.5F, 0.3F},
+                                 motion_t {},
+                                 1.0F,
+                                 &linkp.positions().front(),
+                                 &linkp.normals().front(),
+                                 linkp.vertices());
+        p.add(make_joint(joint_revolute, piece, previous, pin, pin));
+        previous = piece;
+    }
+
+    // Optional level geometry exported with Scene::save
+    if ((argc > 1) && !level.open(argv[1])) return 1;
+    if (level.is_open()) level.instantiate(p);
+
     p.gravity() = {0.0F, -100.0F};
     timer.reset();
 
@@ -3,6 +3,11 @@
 #include <cmath>
 #include <random>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATH_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace MATH_NAMESPACE
 {
 
@@ -11,7 +16,7 @@ static std::mt19937 mt(rd());
 
 f32 sqrt(f32 number)
 {
-    return std::sqrtf(number);
+    return std::sqrt(number);
 }
 
 f64 sqrt(f64 number)
@@ -21,7 +26,7 @@ f64 sqrt(f64 number)
 
 f32 pow(f32 base, f32 exponent)
 {
-    return std::powf(base, exponent);
+    return std::pow(base, exponent);
 }
 
 f64 pow(f64 base, f64 exponent)
@@ -31,7 +36,7 @@ f64 pow(f64 base, f64 exponent)
 
 f32 ln(f32 number)
 {
-    return std::logf(number);
+    return std::log(number);
 }
 
 f64 ln(f64 number)
@@ -41,7 +46,7 @@ f64 ln(f64 number)
 
 f32 log(f32 number)
 {
-    return std::log10f(number);
+    return std::log10(number);
 }
 
 f64 log(f64 number)
@@ -51,7 +56,7 @@ f64 log(f64 number)
 
 f32 sin(f32 theta)
 {
-    return std::sinf(theta);
+    return std::sin(theta);
 }
 
 f64 sin(f64 theta)
@@ -61,7 +66,7 @@ f64 sin(f64 theta)
 
 f32 asin(f32 radians)
 {
-    return std::asinf(radians);
+    return std::asin(radians);
 }
 
 f64 asin(f64 radians)
@@ -71,7 +76,7 @@ f64 asin(f64 radians)
 
 f32 cos(f32 theta)
 {
-    return std::cosf(theta);
+    return std::cos(theta);
 }
 
 f64 cos(f64 theta)
@@ -81,7 +86,7 @@ f64 cos(f64 theta)
 
 f32 acos(f32 radians)
 {
-    return std::acosf(radians);
+    return std::acos(radians);
 }
 
 f64 acos(f64 radians)
@@ -91,7 +96,7 @@ f64 acos(f64 radians)
 
 f32 tan(f32 theta)
 {
-    return std::tanf(theta);
+    return std::tan(theta);
 }
 
 f64 tan(f64 theta)
@@ -101,7 +106,7 @@ f64 tan(f64 theta)
 
 f32 atan(f32 radians)
 {
-    return std::atanf(radians);
+    return std::atan(radians);
 }
 
 f64 atan(f64 radians)
@@ -111,7 +116,7 @@ f64 atan(f64 radians)
 
 f32 atan2(f32 y, f32 x)
 {
-    return std::atan2f(y, x);
+    return std::atan2(y, x);
 }
 
 f64 atan2(f64 y, f64 x)
@@ -143,4 +148,158 @@ f64 random(f64 min, f64 max)
     return distribution(mt);
 }
 
+namespace fast
+{
+
+void sin_cos(const f32* theta, f32* sin, f32* cos, u32 count)
+{
+    u32 i = 0;
+#ifdef MATH_SSE2
+    // Same reduction and polynomials as the scalar version, four angles at a time
+    const __m128 two_over_pi = _mm_set1_ps(0.63661977236758134307553505349006F);
+    const __m128 dp1 = _mm_set1_ps(1.5703125F);
+    const __m128 dp2 = _mm_set1_ps(4.8375129699707031E-4F);
+    const __m128 dp3 = _mm_set1_ps(7.5497899548918822E-8F);
+    const __m128 s1 = _mm_set1_ps(-1.6666654611E-1F);
+    const __m128 s2 = _mm_set1_ps(8.3321608736E-3F);
+    const __m128 s3 = _mm_set1_ps(-1.9515295891E-4F);
+    const __m128 c1 = _mm_set1_ps(4.166664568298827E-2F);
+    const __m128 c2 = _mm_set1_ps(-1.388731625493765E-3F);
+    const __m128 c3 = _mm_set1_ps(2.443315711809948E-5F);
+    const __m128 half = _mm_set1_ps(0.5F);
+    const __m128 one = _mm_set1_ps(1.0F);
+    const __m128i bit0 = _mm_set1_epi32(1);
+    const __m128i bit1 = _mm_set1_epi32(2);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(theta + i);
+        __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, two_over_pi));
+        __m128 q = _mm_cvtepi32_ps(quadrant);
+
+        __m128 r = _mm_sub_ps(x, _mm_mul_ps(q, dp1));
+        r = _mm_sub_ps(r, _mm_mul_ps(q, dp2));
+        r = _mm_sub_ps(r, _mm_mul_ps(q, dp3));
+        __m128 r2 = _mm_mul_ps(r, r);
+
+        __m128 ps = _mm_add_ps(s2, _mm_mul_ps(r2, s3));
+        ps = _mm_add_ps(s1, _mm_mul_ps(r2, ps));
+        ps = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), ps));
+
+        __m128 pc = _mm_add_ps(c2, _mm_mul_ps(r2, c3));
+        pc = _mm_add_ps(c1, _mm_mul_ps(r2, pc));
+        pc = _mm_add_ps(_mm_sub_ps(one, _mm_mul_ps(half, r2)), _mm_mul_ps(_mm_mul_ps(r2, r2), pc));
+
+        // Odd quadrants swap sine and cosine, the signs follow the second bit of the quadrant
+        __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, bit0), bit0));
+        __m128 vs = _mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps));
+        __m128 vc = _mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc));
+        __m128i sin_sign = _mm_slli_epi32(_mm_and_si128(quadrant, bit1), 30);
+        __m128i cos_sign = _mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, bit0), bit1), 30);
+
+        _mm_storeu_ps(sin + i, _mm_xor_ps(vs, _mm_castsi128_ps(sin_sign)));
+        _mm_storeu_ps(cos + i, _mm_xor_ps(vc, _mm_castsi128_ps(cos_sign)));
+    }
+#endif
+    for (; i < count; ++i) sin_cos(theta[i], sin[i], cos[i]);
+}
+
+void sin_cos(const f64* theta, f64* sin, f64* cos, u32 count)
+{
+    u32 i = 0;
+#ifdef MATH_SSE2
+    const __m128d two_over_pi = _mm_set1_pd(0.63661977236758134307553505349006);
+    const __m128d dp1 = _mm_set1_pd(1.5703125);
+    const __m128d dp2 = _mm_set1_pd(4.8375129699707031E-4);
+    const __m128d dp3 = _mm_set1_pd(7.5497899548918822E-8);
+    // Double precision polynomials, see [sin_cos_polynomial]
+    const __m128d s1 = _mm_set1_pd(-1.66666666666666324348E-1);
+    const __m128d s2 = _mm_set1_pd(8.33333333332248946124E-3);
+    const __m128d s3 = _mm_set1_pd(-1.98412698298579493134E-4);
+    const __m128d s4 = _mm_set1_pd(2.75573137070700676789E-6);
+    const __m128d s5 = _mm_set1_pd(-2.50507602534068634195E-8);
+    const __m128d s6 = _mm_set1_pd(1.58969099521155010221E-10);
+    const __m128d c1 = _mm_set1_pd(4.16666666666666019037E-2);
+    const __m128d c2 = _mm_set1_pd(-1.38888888888741095749E-3);
+    const __m128d c3 = _mm_set1_pd(2.48015872894767294178E-5);
+    const __m128d c4 = _mm_set1_pd(-2.75573143513906633035E-7);
+    const __m128d c5 = _mm_set1_pd(2.08757232129817482790E-9);
+    const __m128d c6 = _mm_set1_pd(-1.13596475577881948265E-11);
+    const __m128d half = _mm_set1_pd(0.5);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128i bit0 = _mm_set1_epi32(1);
+    const __m128i bit1 = _mm_set1_epi32(2);
+
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128d x = _mm_loadu_pd(theta + i);
+        __m128i quadrant = _mm_cvtpd_epi32(_mm_mul_pd(x, two_over_pi));
+        __m128d q = _mm_cvtepi32_pd(quadrant);
+        // Spread each 32 bit quadrant over both halves of its 64 bit lane so masks cover the whole double
+        quadrant = _mm_shuffle_epi32(quadrant, _MM_SHUFFLE(1, 1, 0, 0));
+
+        __m128d r = _mm_sub_pd(x, _mm_mul_pd(q, dp1));
+        r = _mm_sub_pd(r, _mm_mul_pd(q, dp2));
+        r = _mm_sub_pd(r, _mm_mul_pd(q, dp3));
+        __m128d r2 = _mm_mul_pd(r, r);
+
+        __m128d ps = _mm_add_pd(s5, _mm_mul_pd(r2, s6));
+        ps = _mm_add_pd(s4, _mm_mul_pd(r2, ps));
+        ps = _mm_add_pd(s3, _mm_mul_pd(r2, ps));
+        ps = _mm_add_pd(s2, _mm_mul_pd(r2, ps));
+        ps = _mm_add_pd(s1, _mm_mul_pd(r2, ps));
+        ps = _mm_add_pd(r, _mm_mul_pd(_mm_mul_pd(r, r2), ps));
+
+        __m128d pc = _mm_add_pd(c5, _mm_mul_pd(r2, c6));
+        pc = _mm_add_pd(c4, _mm_mul_pd(r2, pc));
+        pc = _mm_add_pd(c3, _mm_mul_pd(r2, pc));
+        pc = _mm_add_pd(c2, _mm_mul_pd(r2, pc));
+        pc = _mm_add_pd(c1, _mm_mul_pd(r2, pc));
+        pc = _mm_add_pd(_mm_sub_pd(one, _mm_mul_pd(half, r2)), _mm_mul_pd(_mm_mul_pd(r2, r2), pc));
+
+        __m128d swap = _mm_castsi128_pd(_mm_cmpeq_epi32(_mm_and_si128(quadrant, bit0), bit0));
+        __m128d vs = _mm_or_pd(_mm_and_pd(swap, pc), _mm_andnot_pd(swap, ps));
+        __m128d vc = _mm_or_pd(_mm_and_pd(swap, ps), _mm_andnot_pd(swap, pc));
+        __m128i sin_sign = _mm_slli_epi64(_mm_and_si128(quadrant, bit1), 62);
+        __m128i cos_sign = _mm_slli_epi64(_mm_and_si128(_mm_add_epi32(quadrant, bit0), bit1), 62);
+
+        _mm_storeu_pd(sin + i, _mm_xor_pd(vs, _mm_castsi128_pd(sin_sign)));
+        _mm_storeu_pd(cos + i, _mm_xor_pd(vc, _mm_castsi128_pd(cos_sign)));
+    }
+#endif
+    for (; i < count; ++i) sin_cos(theta[i], sin[i], cos[i]);
+}
+
+void rsqrt(const f32* number, f32* result, u32 count)
+{
+    u32 i = 0;
+#ifdef MATH_SSE2
+    // Hardware estimate (12 bits) followed by one Newton-Raphson step
+    const __m128 half = _mm_set1_ps(0.5F);
+    const __m128 three_halves = _mm_set1_ps(1.5F);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(number + i);
+        __m128 y = _mm_rsqrt_ps(x);
+        y = _mm_mul_ps(y, _mm_sub_ps(three_halves, _mm_mul_ps(_mm_mul_ps(half, x), _mm_mul_ps(y, y))));
+        _mm_storeu_ps(result + i, y);
+    }
+#endif
+    for (; i < count; ++i) result[i] = rsqrt(number[i]);
+}
+
+void rsqrt(const f64* number, f64* result, u32 count)
+{
+    u32 i = 0;
+#ifdef MATH_SSE2
+    // There is no double precision estimate instruction, an exact division is cheaper than refining the bit trick
+    const __m128d one = _mm_set1_pd(1.0);
+    for (; i + 2 <= count; i += 2)
+        _mm_storeu_pd(result + i, _mm_div_pd(one, _mm_sqrt_pd(_mm_loadu_pd(number + i))));
+#endif
+    for (; i < count; ++i) result[i] = rsqrt(number[i]);
+}
+
+}
+
 }
\ No newline at end of file
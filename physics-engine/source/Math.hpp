@@ -4,6 +4,7 @@
 #include "Configuration.hpp"
 
 #include <limits>
+#include <cstring>
 
 #undef min
 #undef max
@@ -14,6 +15,19 @@
 namespace MATH_NAMESPACE
 {
 
+/// Type utilities
+
+// Keeps scalar arguments out of template argument deduction
+// So that mixing precisions, as in (v2_t<f64> * 0.5F), converts the scalar instead of failing to compile
+template <typename T>
+struct scalar
+{
+    using type = T;
+};
+
+template <typename T>
+using scalar_t = typename scalar<T>::type;
+
 /// Mathematical constants
 
 template <typename T = precision_t>
@@ -140,6 +154,120 @@ constexpr static inline T abs(T number)
     return number * sign<T>(number);
 }
 
+/// Fast approximations
+/// Meant for hot loops that can trade a few ulps for speed, the standard functions remain the default
+
+namespace fast
+{
+
+// Minimax polynomials of sine and cosine on [-pi/4, pi/4]
+// Single precision coefficients come from cephes, the double precision ones from fdlibm
+static inline void sin_cos_polynomial(f32 r, f32& s, f32& c)
+{
+    f32 r2 = r * r;
+    s = r + r * r2 * (-1.6666654611E-1F + r2 * (8.3321608736E-3F + r2 * -1.9515295891E-4F));
+    c = 1.0F - 0.5F * r2 + r2 * r2 * (4.166664568298827E-2F + r2 * (-1.388731625493765E-3F + r2 * 2.443315711809948E-5F));
+}
+
+static inline void sin_cos_polynomial(f64 r, f64& s, f64& c)
+{
+    f64 r2 = r * r;
+    s = r + r * r2 * (-1.66666666666666324348E-1 + r2 * (8.33333333332248946124E-3 + r2 * (-1.98412698298579493134E-4
+          + r2 * (2.75573137070700676789E-6 + r2 * (-2.50507602534068634195E-8 + r2 * 1.58969099521155010221E-10)))));
+    c = 1.0 - 0.5 * r2 + r2 * r2 * (4.16666666666666019037E-2 + r2 * (-1.38888888888741095749E-3 + r2 * (2.48015872894767294178E-5
+          + r2 * (-2.75573143513906633035E-7 + r2 * (2.08757232129817482790E-9 + r2 * -1.13596475577881948265E-11)))));
+}
+
+// Polynomial sine and cosine with quadrant reduction (Cody-Waite split of pi/2)
+// Absolute error for |theta| < 1E3 is below 2.5E-7 in single precision and 1E-15 in double precision
+template <typename T = precision_t>
+static inline void sin_cos(T theta, T& sin, T& cos)
+{
+    constexpr T two_over_pi = T(0.63661977236758134307553505349006);
+    constexpr T dp1 = T(1.5703125);
+    constexpr T dp2 = T(4.8375129699707031E-4);
+    constexpr T dp3 = T(7.5497899548918822E-8);
+
+    i32 quadrant = i32(theta * two_over_pi + ((theta < T(0)) ? T(-0.5) : T(0.5)));
+    T q = T(quadrant);
+    T r = ((theta - q * dp1) - q * dp2) - q * dp3;
+    T s, c;
+    sin_cos_polynomial(r, s, c);
+
+    if (quadrant & 1)
+    {
+        T t = s;
+        s = c;
+        c = -t;
+    }
+    if (quadrant & 2)
+    {
+        s = -s;
+        c = -c;
+    }
+    sin = s;
+    cos = c;
+}
+
+template <typename T = precision_t>
+static inline T sin(T theta)
+{
+    T sin, cos;
+    sin_cos(theta, sin, cos);
+    return sin;
+}
+
+template <typename T = precision_t>
+static inline T cos(T theta)
+{
+    T sin, cos;
+    sin_cos(theta, sin, cos);
+    return cos;
+}
+
+// Bit trick initial guess refined by Newton-Raphson, relative error is below 5E-6
+static inline f32 rsqrt(f32 number)
+{
+    u32 bits;
+    std::memcpy(&bits, &number, sizeof(bits));
+    bits = 0x5F375A86U - (bits >> 1);
+    f32 y;
+    std::memcpy(&y, &bits, sizeof(y));
+    y *= 1.5F - 0.5F * number * y * y;
+    y *= 1.5F - 0.5F * number * y * y;
+    return y;
+}
+
+// Same as above with one more refinement step, relative error is below 1E-10
+static inline f64 rsqrt(f64 number)
+{
+    u64 bits;
+    std::memcpy(&bits, &number, sizeof(bits));
+    bits = 0x5FE6EB50C7B537A9ULL - (bits >> 1);
+    f64 y;
+    std::memcpy(&y, &bits, sizeof(y));
+    y *= 1.5 - 0.5 * number * y * y;
+    y *= 1.5 - 0.5 * number * y * y;
+    y *= 1.5 - 0.5 * number * y * y;
+    return y;
+}
+
+template <typename T = precision_t>
+static inline T sqrt(T number)
+{
+    return number * rsqrt(number);
+}
+
+// Batch versions operating on arrays, vectorized with SSE2 when available
+// Input and output arrays may alias
+void sin_cos(const f32* theta, f32* sin, f32* cos, u32 count);
+void sin_cos(const f64* theta, f64* sin, f64* cos, u32 count);
+
+void rsqrt(const f32* number, f32* result, u32 count);
+void rsqrt(const f64* number, f64* result, u32 count);
+
+}
+
 }
 
 #endif // MATH_HPP
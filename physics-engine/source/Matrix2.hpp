@@ -74,13 +74,13 @@ static inline m2_t<T> operator-=(m2_t<T>& left, const m2_t<T>& right)
 }
 
 template <typename T = precision_t>
-static inline m2_t<T> operator*(const m2_t<T>& left, T right)
+static inline m2_t<T> operator*(const m2_t<T>& left, scalar_t<T> right)
 {
     return {left[0] * right, left[1] * right};
 }
 
 template <typename T = precision_t>
-static inline m2_t<T> operator*(T left, const m2_t<T>& right)
+static inline m2_t<T> operator*(scalar_t<T> left, const m2_t<T>& right)
 {
     return {left * right[0], left * right[1]};
 }
@@ -108,19 +108,19 @@ static inline m2_t<T> operator*(const m2_t<T>& left, const m2_t<T>& right)
             left[1][0] * right[0][0] + left[1][1] * right[1][0],
             left[1][0] * right[0][1] + left[1][1] * right[1][1]
         }
-    }
+    };
 }
 
 /// Indexing operators
 
-template <typename T = precision_t>
+template <typename T>
 inline v2_t<T>& m2_t<T>::operator[](u32 index)
 {
     assert(index < 2);
     return (static_cast<v2_t<T>*>(this) + index);
 }
 
-template <typename T = precision_t>
+template <typename T>
 inline const v2_t<T>& m2_t<T>::operator[](u32 index) const
 {
     assert(index < 2);
@@ -129,7 +129,7 @@ inline const v2_t<T>& m2_t<T>::operator[](u32 index) const
 
 /// Member methods
 
-template <typename T = precision_t>
+template <typename T>
 inline T m2_t<T>::determinant() const
 {
     return (r0.x * r1.y) - (r0.y * r1.x);
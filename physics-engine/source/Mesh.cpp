@@ -1,30 +1,57 @@
 #include "Mesh.hpp"
 
+#include <algorithm>
+
 namespace GRAPHICS_NAMESPACE
 {
 
-void Mesh::make_counter_clockwise()
+/// Geometry utility functions
+
+// Twice the signed area of the triangle (o, a, b), positive when the turn o -> a -> b is counter-clockwise
+static inline precision_t cross(vec2 o, vec2 a, vec2 b)
 {
+    return mat2 {a - o, b - o}.determinant();
+}
 
-    // Polygon is in clockwise winding if the area is positive
-    f32 mass = 0.0F;
+// Polygon is in clockwise winding if the result is positive
+static precision_t winding(const std::vector<vec2>& positions)
+{
+    precision_t mass = 0.0F;
+    for (std::size_t i = 0, j = positions.size() - 1; i < positions.size(); j = i++)
+        mass += (positions[i].x - positions[j].x) * (positions[i].y + positions[j].y);
+    return mass;
+}
 
-    for (std::size_t i = 0, j = m_positions.size() - 1; i < m_positions.size(); j = i++)
-        mass += (m_positions[i].x - m_positions[j].x) * (m_positions[i].y + m_positions[j].y);
+static bool inside_triangle(vec2 p, vec2 a, vec2 b, vec2 c)
+{
+    return cross(a, b, p) >= 0.0F && cross(b, c, p) >= 0.0F && cross(c, a, p) >= 0.0F;
+}
 
-    if (mass > 0.0F)
+static bool convex_indices(const std::vector<vec2>& positions, const std::vector<u32>& indices)
+{
+    for (std::size_t i = 0, n = indices.size(); i < n; ++i)
     {
-        for (std::size_t i = 0, j = m_positions.size() - 1; i < j; ++i, --j)
-            std::swap(m_positions[i], m_positions[j]);
+        vec2 a = positions[indices[(i + n - 1) % n]];
+        vec2 b = positions[indices[i]];
+        vec2 c = positions[indices[(i + 1) % n]];
+        if (cross(a, b, c) < 0.0F) return false;
     }
+    return true;
+}
+
+void Mesh::make_counter_clockwise()
+{
+    if (winding(m_positions) > 0.0F)
+        std::reverse(m_positions.begin(), m_positions.end());
 }
 
 void Mesh::center_in_COM()
 {
     vec2 com = {0.0F, 0.0F};
     for (auto v : m_positions) com += v;
-    com /= f32(m_positions.size());
+    com /= precision_t(m_positions.size());
     for (auto& v : m_positions) v -= com;
+    m_origin = com;
 }
 
 void Mesh::compute_normals()
@@ -40,13 +67,232 @@ void Mesh::compute_normals()
 }
 
 Mesh::Mesh(std::vector<vec2>&& positions)
-    : m_positions {std::forward<std::vector<vec2>>(positions)}
+    : m_positions {std::forward<std::vector<vec2>>(positions)}, m_origin {0.0F, 0.0F}
 {
     make_counter_clockwise();
     center_in_COM();
     compute_normals();
 }
 
+/// Hull construction and decomposition
+
+std::vector<vec2> Mesh::hull(std::vector<vec2> points)
+{
+    // Andrew's monotone chain
+    if (points.size() < 3) return points;
+
+    std::sort(points.begin(), points.end(), [](vec2 a, vec2 b)
+    {
+        return (a.x < b.x) || (a.x == b.x && a.y < b.y);
+    });
+
+    std::vector<vec2> hull(points.size() * 2);
+    std::size_t k = 0;
+
+    // Lower chain
+    for (std::size_t i = 0; i < points.size(); ++i)
+    {
+        while (k >= 2 && cross(hull[k - 2], hull[k - 1], points[i]) <= 0.0F) --k;
+        hull[k++] = points[i];
+    }
+    // Upper chain
+    for (std::size_t i = points.size() - 1, lower = k + 1; i > 0; --i)
+    {
+        while (k >= lower && cross(hull[k - 2], hull[k - 1], points[i - 1]) <= 0.0F) --k;
+        hull[k++] = points[i - 1];
+    }
+
+    // The last point is the same as the first one
+    hull.resize(k - 1);
+    return hull;
+}
+
+precision_t Mesh::simplify(std::vector<vec2>& hull, u32 max_vertices, precision_t max_error)
+{
+    max_vertices = math::max(max_vertices, 3U);
+
+    // Vertices removed from the hull are kept by the edge that replaced them
+    // So the error of a removal accounts for all the vertices that edge already dropped
+    std::vector<std::vector<vec2>> removed(hull.size());
+    precision_t error = 0.0F;
+
+    while (hull.size() > max_vertices)
+    {
+        precision_t min_error = math::infinity();
+        std::size_t min_index = 0;
+
+        for (std::size_t i = 0, n = hull.size(); i < n; ++i)
+        {
+            std::size_t prev = (i + n - 1) % n;
+            vec2 a = hull[prev];
+            vec2 b = hull[(i + 1) % n];
+            precision_t i_length = 1.0F / (b - a).length();
+
+            precision_t e = math::abs(cross(a, b, hull[i])) * i_length;
+            for (auto v : removed[prev]) e = math::max(e, math::abs(cross(a, b, v)) * i_length);
+            for (auto v : removed[i])    e = math::max(e, math::abs(cross(a, b, v)) * i_length);
+
+            if (e < min_error)
+            {
+                min_error = e;
+                min_index = i;
+            }
+        }
+
+        if (min_error > max_error) break;
+        error = math::max(error, min_error);
+
+        // The edge before the removed vertex now spans up to the next vertex
+        std::size_t prev = (min_index + hull.size() - 1) % hull.size();
+        removed[prev].push_back(hull[min_index]);
+        removed[prev].insert(removed[prev].end(), removed[min_index].begin(), removed[min_index].end());
+        removed.erase(removed.begin() + min_index);
+        hull.erase(hull.begin() + min_index);
+    }
+    return error;
+}
+
+std::vector<std::vector<vec2>> Mesh::decompose(std::vector<vec2> outline, u32 max_vertices)
+{
+    std::vector<std::vector<vec2>> parts;
+    if (outline.size() < 3) return parts;
+
+    if (winding(outline) > 0.0F)
+        std::reverse(outline.begin(), outline.end());
+
+    // Collinear vertices never form ears, drop them beforehand
+    for (std::size_t i = 0; i < outline.size() && outline.size() > 3;)
+    {
+        std::size_t n = outline.size();
+        if (cross(outline[(i + n - 1) % n], outline[i], outline[(i + 1) % n]) == 0.0F)
+            outline.erase(outline.begin() + i);
+        else ++i;
+    }
+
+    // Triangulate by ear clipping
+    std::vector<std::vector<u32>> polygons;
+    std::vector<u32> remaining(outline.size());
+    for (u32 i = 0; i < remaining.size(); ++i) remaining[i] = i;
+
+    while (remaining.size() > 3)
+    {
+        bool clipped = false;
+        for (std::size_t i = 0, n = remaining.size(); i < n && !clipped; ++i)
+        {
+            u32 a = remaining[(i + n - 1) % n];
+            u32 b = remaining[i];
+            u32 c = remaining[(i + 1) % n];
+
+            // Reflex vertices can't be ears
+            if (cross(outline[a], outline[b], outline[c]) <= 0.0F) continue;
+
+            bool ear = true;
+            for (u32 v : remaining)
+            {
+                if (v == a || v == b || v == c) continue;
+                if (inside_triangle(outline[v], outline[a], outline[b], outline[c]))
+                {
+                    ear = false;
+                    break;
+                }
+            }
+            if (!ear) continue;
+
+            polygons.push_back({a, b, c});
+            remaining.erase(remaining.begin() + i);
+            clipped = true;
+        }
+        // Corner case: outline is self intersecting, keep what was triangulated so far
+        if (!clipped) break;
+    }
+    if (remaining.size() == 3) polygons.push_back(remaining);
+
+    // Hertel-Mehlhorn: remove diagonals as long as the merged polygons remain convex
+    for (bool merged = true; merged;)
+    {
+        merged = false;
+        for (std::size_t i = 0; i < polygons.size() && !merged; ++i)
+        {
+            for (std::size_t j = i + 1; j < polygons.size() && !merged; ++j)
+            {
+                auto& p = polygons[i];
+                auto& q = polygons[j];
+                if (max_vertices && p.size() + q.size() - 2 > max_vertices) continue;
+
+                for (std::size_t k = 0; k < p.size() && !merged; ++k)
+                {
+                    u32 a = p[k];
+                    u32 b = p[(k + 1) % p.size()];
+                    for (std::size_t l = 0; l < q.size(); ++l)
+                    {
+                        // Shared diagonals have opposite directions in both polygons
+                        if (q[l] != b || q[(l + 1) % q.size()] != a) continue;
+
+                        // Walk p from b back to a, then the rest of q from a to b
+                        std::vector<u32> polygon;
+                        polygon.reserve(p.size() + q.size() - 2);
+                        for (std::size_t m = 1; m <= p.size(); ++m) polygon.push_back(p[(k + m) % p.size()]);
+                        for (std::size_t m = 2; m < q.size(); ++m) polygon.push_back(q[(l + m) % q.size()]);
+
+                        if (convex_indices(outline, polygon))
+                        {
+                            p = std::move(polygon);
+                            polygons.erase(polygons.begin() + j);
+                            merged = true;
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    parts.reserve(polygons.size());
+    for (auto& polygon : polygons)
+    {
+        std::vector<vec2> part;
+        part.reserve(polygon.size());
+        for (std::size_t i = 0, n = polygon.size(); i < n; ++i)
+        {
+            // Diagonal removal can leave collinear vertices behind
+            vec2 a = outline[polygon[(i + n - 1) % n]];
+            vec2 b = outline[polygon[i]];
+            vec2 c = outline[polygon[(i + 1) % n]];
+            if (cross(a, b, c) != 0.0F) part.push_back(b);
+        }
+        parts.emplace_back(std::move(part));
+    }
+    return parts;
+}
+
+Mesh Mesh::convex_hull(std::vector<vec2> points, u32 max_vertices, precision_t max_error)
+{
+    auto positions = hull(std::move(points));
+    if (max_vertices) simplify(positions, max_vertices, max_error);
+    return Mesh(std::move(positions));
+}
+
+std::vector<Mesh> Mesh::convex_decomposition(std::vector<vec2> outline, u32 max_vertices)
+{
+    std::vector<Mesh> meshes;
+    for (auto& part : decompose(std::move(outline), max_vertices))
+        meshes.emplace_back(std::move(part));
+    return meshes;
+}
+
+bool Mesh::is_convex(const std::vector<vec2>& positions)
+{
+    bool cw = false;
+    bool ccw = false;
+    for (std::size_t i = 0, n = positions.size(); i < n; ++i)
+    {
+        precision_t turn = cross(positions[(i + n - 1) % n], positions[i], positions[(i + 1) % n]);
+        cw  |= (turn < 0.0F);
+        ccw |= (turn > 0.0F);
+    }
+    return !(cw && ccw);
+}
+
 const std::vector<vec2>& Mesh::positions() const
 {
     return m_positions;
@@ -67,11 +313,21 @@ std::vector<vec2>& Mesh::normals()
     return m_normals;
 }
 
+const vec2& Mesh::origin() const
+{
+    return m_origin;
+}
+
 u32 Mesh::vertices() const
 {
     return m_positions.size();
 }
 
+bool Mesh::convex() const
+{
+    return is_convex(m_positions);
+}
+
 
 
 }
@@ -17,6 +17,7 @@ class Mesh
 
     std::vector<vec2> m_positions;
     std::vector<vec2> m_normals;
+    vec2 m_origin; // Where the center of the mesh was in the space of the input vertices
 
     void make_counter_clockwise();
     void center_in_COM();
@@ -26,13 +27,37 @@ public:
 
     Mesh(std::vector<vec2>&& positions);
 
+    /// Hull construction and decomposition
+    /// The collision routines expect convex hulls, these build them from arbitrary input
+
+    // Builds the counter-clockwise convex hull of a point cloud (collinear points are dropped)
+    static std::vector<vec2> hull(std::vector<vec2> points);
+
+    // Removes the vertices of a convex hull that contribute the least to its shape
+    // Stops when the hull has at most max_vertices or when the next removal would exceed max_error
+    // Returns the largest distance between a removed vertex and the simplified hull
+    static precision_t simplify(std::vector<vec2>& hull, u32 max_vertices, precision_t max_error = math::infinity());
+
+    // Splits a simple (non self-intersecting) outline into convex parts with at most max_vertices each
+    // A max_vertices of zero means that parts can be as large as the shape allows
+    static std::vector<std::vector<vec2>> decompose(std::vector<vec2> outline, u32 max_vertices = 0);
+
+    // Convenience wrappers that build meshes ready to be used by the physics engine
+    static Mesh convex_hull(std::vector<vec2> points, u32 max_vertices = 0, precision_t max_error = math::infinity());
+    static std::vector<Mesh> convex_decomposition(std::vector<vec2> outline, u32 max_vertices = 0);
+
+    static bool is_convex(const std::vector<vec2>& positions);
+
     const std::vector<vec2>& positions() const;
     std::vector<vec2>& positions();
 
     const std::vector<vec2>& normals() const;
     std::vector<vec2>& normals();
 
+    const vec2& origin() const;
+
     u32 vertices() const;
+    bool convex() const;
 
 };
 
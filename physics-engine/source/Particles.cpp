@@ -0,0 +1,561 @@
+#include "Particles.hpp"
+
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace PHYSICS_NAMESPACE
+{
+
+/// Worker threads
+
+// Persistent threads that split a range of particles with the calling thread
+// Jobs are passed as a function pointer and a context so that dispatching doesn't allocate
+struct ParticleSystem2D::workers_t
+{
+    using job_f = void(*)(void*, u32, u32);
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable start;
+    std::condition_variable done;
+
+    job_f job = nullptr;
+    void* context = nullptr;
+    u32 count = 0;
+    u32 generation = 0;
+    u32 pending = 0;
+    bool quit = false;
+
+    // Below this amount of work waking the threads up costs more than it saves
+    static constexpr u32 min_parallel_count = 1024;
+
+    explicit workers_t(u32 helpers)
+    {
+        for (u32 i = 0; i < helpers; ++i)
+            threads.emplace_back([this, i]() { work(i + 1); });
+    }
+
+    ~workers_t()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        start.notify_all();
+        for (auto& thread : threads) thread.join();
+    }
+
+    u32 chunk(u32 index) const
+    {
+        return u32(u64(count) * index / (threads.size() + 1));
+    }
+
+    void work(u32 index)
+    {
+        u32 seen = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                start.wait(lock, [this, seen]() { return quit || (generation != seen); });
+                if (quit) return;
+                seen = generation;
+            }
+            job(context, chunk(index), chunk(index + 1));
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pending == 0) done.notify_one();
+            }
+        }
+    }
+
+    void run(job_f f, void* c, u32 n)
+    {
+        if (threads.empty() || (n < min_parallel_count))
+        {
+            f(c, 0, n);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = f;
+            context = c;
+            count = n;
+            pending = threads.size();
+            ++generation;
+        }
+        start.notify_all();
+        f(c, chunk(0), chunk(1));
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return pending == 0; });
+    }
+};
+
+template <typename F>
+void ParticleSystem2D::parallel_for(u32 count, F fn)
+{
+    m_workers->run([](void* context, u32 begin, u32 end)
+    {
+        (*static_cast<F*>(context))(begin, end);
+    }, &fn, count);
+}
+
+/// Smoothing kernels (2D)
+
+static inline precision_t poly6(precision_t r2, precision_t h)
+{
+    constexpr precision_t k = precision_t(4.0) / math::pi();
+    precision_t h2 = h * h;
+    precision_t x = h2 - r2;
+    return (r2 < h2) ? k * x * x * x / (h2 * h2 * h2 * h2) : precision_t(0);
+}
+
+// Magnitude of the gradient of the spiky kernel, the direction is the one between the particles
+static inline precision_t spiky_gradient(precision_t r, precision_t h)
+{
+    constexpr precision_t k = precision_t(-30.0) / math::pi();
+    precision_t x = h - r;
+    return (r < h) ? k * x * x / (h * h * h * h * h) : precision_t(0);
+}
+
+/// Spatial hash
+
+u32 ParticleSystem2D::cell_key(i32 x, i32 y) const
+{
+    // Cells of the same row land in consecutive buckets, so a neighbourhood touches three cache lines
+    return (u32(y) * 92821U + u32(x)) & m_cell_mask;
+}
+
+void ParticleSystem2D::build_hash()
+{
+    u32 count = m_x.size();
+
+    // Twice as many buckets as particles keeps collisions rare
+    u32 buckets = 1;
+    while (buckets < count * 2) buckets <<= 1;
+    m_cell_mask = buckets - 1;
+    m_cell_start.assign(buckets + 1, 0);
+    m_keys.resize(count);
+    m_sorted.resize(count);
+
+    precision_t i_cell = precision_t(1) / m_cell_size;
+    parallel_for(count, [this, i_cell](u32 begin, u32 end)
+    {
+        for (u32 i = begin; i < end; ++i)
+        {
+            i32 x = i32(std::floor(m_px[i] * i_cell));
+            i32 y = i32(std::floor(m_py[i] * i_cell));
+            m_keys[i] = cell_key(x, y);
+        }
+    });
+
+    // Counting sort
+    for (u32 i = 0; i < count; ++i) ++m_cell_start[m_keys[i] + 1];
+    for (u32 i = 0; i < buckets; ++i) m_cell_start[i + 1] += m_cell_start[i];
+    for (u32 i = 0; i < count; ++i) m_sorted[m_cell_start[m_keys[i]]++] = i;
+    // The scatter advanced every start to the start of the next bucket, shift them back
+    for (u32 i = buckets; i > 0; --i) m_cell_start[i] = m_cell_start[i - 1];
+    m_cell_start[0] = 0;
+
+    // Move the particles into bucket order, neighbours are then close in memory as well
+    m_scratch.resize(count);
+    for (auto array : {&m_x, &m_y, &m_px, &m_py, &m_vx, &m_vy, &m_life})
+    {
+        for (u32 i = 0; i < count; ++i) m_scratch[i] = (*array)[m_sorted[i]];
+        array->swap(m_scratch);
+    }
+}
+
+template <typename F>
+void ParticleSystem2D::for_each_neighbour(u32 index, F fn) const
+{
+    precision_t i_cell = precision_t(1) / m_cell_size;
+    precision_t range_sq = m_cell_size * m_cell_size;
+    i32 cx = i32(std::floor(m_px[index] * i_cell));
+    i32 cy = i32(std::floor(m_py[index] * i_cell));
+
+    u32 visited[9];
+    u32 visited_c = 0;
+
+    for (i32 y = cy - 1; y <= cy + 1; ++y)
+    {
+        for (i32 x = cx - 1; x <= cx + 1; ++x)
+        {
+            // Two neighbouring cells may hash to the same bucket, only walk it once
+            u32 key = cell_key(x, y);
+            bool seen = false;
+            for (u32 i = 0; i < visited_c; ++i) seen |= (visited[i] == key);
+            if (seen) continue;
+            visited[visited_c++] = key;
+
+            for (u32 j = m_cell_start[key]; j < m_cell_start[key + 1]; ++j)
+            {
+                if (j == index) continue;
+                precision_t dx = m_px[index] - m_px[j];
+                precision_t dy = m_py[index] - m_py[j];
+                precision_t r2 = dx * dx + dy * dy;
+                if (r2 < range_sq) fn(j, dx, dy, r2);
+            }
+        }
+    }
+}
+
+/// Constraint passes
+
+void ParticleSystem2D::solve_contacts()
+{
+    const precision_t diameter = m_radius * precision_t(2);
+    const precision_t limit_sq = math::sq(m_radius * precision_t(0.5));
+
+    // Jacobi iteration, each particle only writes its own correction
+    parallel_for(m_x.size(), [this, diameter, limit_sq](u32 begin, u32 end)
+    {
+        for (u32 i = begin; i < end; ++i)
+        {
+            precision_t dx = 0;
+            precision_t dy = 0;
+            u32 contacts = 0;
+            for_each_neighbour(i, [&](u32, precision_t x, precision_t y, precision_t r2)
+            {
+                if (r2 >= diameter * diameter || r2 == precision_t(0)) return;
+                precision_t r = math::sqrt(r2);
+                precision_t push = precision_t(0.5) * (diameter - r) / r;
+                dx += x * push;
+                dy += y * push;
+                ++contacts;
+            });
+            precision_t length_sq = dx * dx + dy * dy;
+            precision_t scale = (length_sq > limit_sq) ? math::sqrt(limit_sq / length_sq) : precision_t(1);
+            m_dx[i] = dx * scale;
+            m_dy[i] = dy * scale;
+        }
+    });
+    parallel_for(m_x.size(), [this](u32 begin, u32 end)
+    {
+        for (u32 i = begin; i < end; ++i)
+        {
+            m_px[i] += m_dx[i];
+            m_py[i] += m_dy[i];
+        }
+    });
+}
+
+void ParticleSystem2D::solve_density()
+{
+    // Position based fluids (Macklin and Muller 2013)
+    const precision_t h = m_kernel_radius;
+    const precision_t mass = m_mass;
+    const precision_t relaxation = m_relaxation;
+    // Artificial pressure term, prevents particles from clumping at the surface
+    const precision_t tensile_k = precision_t(0.1);
+    const precision_t i_tensile_w = precision_t(1) / poly6(math::sq(precision_t(0.2) * h), h);
+    const precision_t limit_sq = math::sq(m_radius * precision_t(0.5));
+
+    parallel_for(m_x.size(), [&](u32 begin, u32 end)
+    {
+        for (u32 i = begin; i < end; ++i)
+        {
+            precision_t density = mass * poly6(0, h);
+            precision_t gx = 0;
+            precision_t gy = 0;
+            precision_t gradient_sq = 0;
+            for_each_neighbour(i, [&](u32, precision_t x, precision_t y, precision_t r2)
+            {
+                density += mass * poly6(r2, h);
+                if (r2 == precision_t(0)) return;
+                precision_t r = math::sqrt(r2);
+                precision_t g = mass * spiky_gradient(r, h) / r;
+                gx += g * x;
+                gy += g * y;
+                gradient_sq += g * g * r2;
+            });
+            gradient_sq += gx * gx + gy * gy;
+            // Only push particles apart, free surfaces would otherwise pull them together
+            precision_t constraint = math::max(density - precision_t(1), precision_t(0));
+            m_lambda[i] = -constraint / (gradient_sq + relaxation);
+        }
+    });
+    parallel_for(m_x.size(), [&](u32 begin, u32 end)
+    {
+        for (u32 i = begin; i < end; ++i)
+        {
+            precision_t dx = 0;
+            precision_t dy = 0;
+            precision_t lambda = m_lambda[i];
+            for_each_neighbour(i, [&](u32 j, precision_t x, precision_t y, precision_t r2)
+            {
+                if (r2 == precision_t(0)) return;
+                precision_t r = math::sqrt(r2);
+                precision_t correction = -tensile_k * math::sq(math::sq(poly6(r2, h) * i_tensile_w));
+                precision_t g = mass * spiky_gradient(r, h) / r * (lambda + m_lambda[j] + correction);
+                dx += g * x;
+                dy += g * y;
+            });
+            // Particles that get squeezed hard would otherwise be shot out at high speed
+            precision_t length_sq = dx * dx + dy * dy;
+            precision_t scale = (length_sq > limit_sq) ? math::sqrt(limit_sq / length_sq) : precision_t(1);
+            m_dx[i] = dx * scale;
+            m_dy[i] = dy * scale;
+        }
+    });
+    parallel_for(m_x.size(), [this](u32 begin, u32 end)
+    {
+        for (u32 i = begin; i < end; ++i)
+        {
+            m_px[i] += m_dx[i];
+            m_py[i] += m_dy[i];
+        }
+    });
+}
+
+/// World interaction
+
+namespace
+{
+
+struct probe_t
+{
+    circle_t particle;
+    vec2 normal; // Sum of the normals of the objects that pushed the particle
+};
+
+void probe_manifold(manifold_t& m, void* user)
+{
+    // Particles don't push objects back, move the particle out of the object entirely
+    auto probe = static_cast<probe_t*>(user);
+    vec2 push = (m.a == &probe->particle) ? -m.normal * m.penetration : m.normal * m.penetration;
+    probe->particle.transform.position += push;
+    probe->normal += push;
+}
+
+void probe_object(object_t& o, void* user)
+{
+    auto probe = static_cast<probe_t*>(user);
+    collide(&probe->particle, &o, probe_manifold, probe);
+}
+
+}
+
+void ParticleSystem2D::collide_world(Physics2D& world)
+{
+    const precision_t friction = m_friction;
+    parallel_for(m_x.size(), [this, &world, friction](u32 begin, u32 end)
+    {
+        probe_t probe = {};
+        probe.particle.type = circle;
+        probe.particle.radius = m_radius;
+        vec2 extent = {m_radius, m_radius};
+
+        for (u32 i = begin; i < end; ++i)
+        {
+            vec2 position = {m_px[i], m_py[i]};
+            probe.particle.transform.position = position;
+            probe.normal = {0.0F, 0.0F};
+            world.query({position - extent, position + extent}, probe_object, &probe);
+            position = probe.particle.transform.position;
+
+            // Friction removes part of the motion along the surfaces that were touched
+            if (probe.normal.lengthSq() > precision_t(0))
+            {
+                vec2 n = probe.normal.normalize();
+                vec2 motion = position - vec2 {m_x[i], m_y[i]};
+                position -= friction * (motion - n * math::dot(motion, n));
+            }
+            m_px[i] = position.x;
+            m_py[i] = position.y;
+        }
+    });
+}
+
+/// Particle system class implementation
+
+ParticleSystem2D::ParticleSystem2D(std::size_t max_particles, precision_t radius, u32 threads)
+    : m_cell_mask {0}, m_max_particles {max_particles}, m_radius {radius}, m_damping {0.0F}, m_friction {0.1F}, m_fluid {false},
+      m_iterations {1}, m_kernel_radius {radius * 4.0F}, m_mass {1.0F}, m_relaxation {0.0F}, m_cell_size {radius * 2.0F},
+      m_workers {new workers_t(math::max(threads, 1U) - 1)}
+{
+    for (auto array : {&m_x, &m_y, &m_px, &m_py, &m_vx, &m_vy, &m_life, &m_lambda, &m_dx, &m_dy})
+        array->reserve(max_particles);
+    m_keys.reserve(max_particles);
+    m_sorted.reserve(max_particles);
+    m_scratch.reserve(max_particles);
+
+    u32 buckets = 1;
+    while (buckets < max_particles * 2) buckets <<= 1;
+    m_cell_start.reserve(buckets + 1);
+}
+
+ParticleSystem2D::~ParticleSystem2D() = default;
+
+void ParticleSystem2D::add(vec2 position, vec2 velocity, precision_t lifetime)
+{
+    assert(m_x.size() < m_max_particles);
+    m_x.push_back(position.x);
+    m_y.push_back(position.y);
+    m_px.push_back(position.x);
+    m_py.push_back(position.y);
+    m_vx.push_back(velocity.x);
+    m_vy.push_back(velocity.y);
+    m_life.push_back(lifetime);
+    m_lambda.push_back(0.0F);
+    m_dx.push_back(0.0F);
+    m_dy.push_back(0.0F);
+}
+
+void ParticleSystem2D::simulate(Physics2D& world)
+{
+    const precision_t dt = world.interval();
+    const precision_t i_dt = precision_t(1) / dt;
+    const vec2 gravity = world.gravity();
+    const precision_t damping = math::max(precision_t(1) - m_damping * dt, precision_t(0));
+
+    // Remove expired particles, the last particle takes the place of the removed one
+    for (u32 i = 0; i < m_x.size();)
+    {
+        m_life[i] -= dt;
+        if (m_life[i] > precision_t(0))
+        {
+            ++i;
+            continue;
+        }
+        for (auto array : {&m_x, &m_y, &m_px, &m_py, &m_vx, &m_vy, &m_life, &m_lambda, &m_dx, &m_dy})
+        {
+            (*array)[i] = array->back();
+            array->pop_back();
+        }
+    }
+
+    // Pre-stabilization (Macklin et al. 2014), the overlap left by the last step is resolved before
+    // predicting and moves the current positions as well, so that it doesn't turn into velocity
+    // Without it piles of particles push each other apart faster and faster
+    if (!m_fluid)
+    {
+        build_hash();
+        solve_contacts();
+        collide_world(world);
+        m_x.assign(m_px.begin(), m_px.end());
+        m_y.assign(m_py.begin(), m_py.end());
+    }
+
+    // Predict positions
+    parallel_for(m_x.size(), [&](u32 begin, u32 end)
+    {
+        for (u32 i = begin; i < end; ++i)
+        {
+            m_vx[i] += gravity.x * dt;
+            m_vy[i] += gravity.y * dt;
+            m_px[i] = m_x[i] + m_vx[i] * dt;
+            m_py[i] = m_y[i] + m_vy[i] * dt;
+        }
+    });
+
+    // Neighbourhoods are only rebuilt once per step, the corrections are small compared to a cell
+    build_hash();
+    for (u32 iteration = 0; iteration < m_iterations; ++iteration)
+    {
+        if (m_fluid) solve_density();
+        else solve_contacts();
+        collide_world(world);
+    }
+
+    // Velocities are derived from the corrected positions
+    parallel_for(m_x.size(), [&](u32 begin, u32 end)
+    {
+        for (u32 i = begin; i < end; ++i)
+        {
+            m_vx[i] = (m_px[i] - m_x[i]) * i_dt * damping;
+            m_vy[i] = (m_py[i] - m_y[i]) * i_dt * damping;
+            m_x[i] = m_px[i];
+            m_y[i] = m_py[i];
+        }
+    });
+}
+
+void ParticleSystem2D::fluid(bool enabled, u32 iterations)
+{
+    m_fluid = enabled;
+    m_iterations = math::max(iterations, 1U);
+    m_cell_size = enabled ? m_kernel_radius : m_radius * 2.0F;
+
+    // Particles at rest are packed on a grid with a spacing of one diameter
+    // Pick the mass that makes the density at rest equal to one
+    precision_t spacing = m_radius * 2.0F;
+    i32 extent = i32(m_kernel_radius / spacing) + 1;
+    precision_t density = 0.0F;
+    precision_t gradient_sq = 0.0F;
+    for (i32 y = -extent; y <= extent; ++y)
+    {
+        for (i32 x = -extent; x <= extent; ++x)
+        {
+            precision_t r = spacing * math::sqrt(precision_t(x * x + y * y));
+            density += poly6(r * r, m_kernel_radius);
+            if (x || y) gradient_sq += math::sq(spiky_gradient(r, m_kernel_radius));
+        }
+    }
+    m_mass = precision_t(1) / density;
+
+    // The relaxation softens the density constraint, it has to follow the scale of the gradients
+    // Stiffer settings make piles of fluid explode when they hit the ground
+    m_relaxation = precision_t(10) * math::sq(m_mass) * gradient_sq;
+}
+
+precision_t& ParticleSystem2D::damping()
+{
+    return m_damping;
+}
+
+precision_t& ParticleSystem2D::friction()
+{
+    return m_friction;
+}
+
+void ParticleSystem2D::rebase(vec2 origin)
+{
+    for (u32 i = 0; i < m_x.size(); ++i)
+    {
+        m_x[i] -= origin.x;
+        m_y[i] -= origin.y;
+        m_px[i] = m_x[i];
+        m_py[i] = m_y[i];
+    }
+}
+
+u32 ParticleSystem2D::particles() const
+{
+    return m_x.size();
+}
+
+u32 ParticleSystem2D::capacity() const
+{
+    return m_max_particles;
+}
+
+precision_t ParticleSystem2D::radius() const
+{
+    return m_radius;
+}
+
+const precision_t* ParticleSystem2D::x() const
+{
+    return m_x.data();
+}
+
+const precision_t* ParticleSystem2D::y() const
+{
+    return m_y.data();
+}
+
+const precision_t* ParticleSystem2D::vx() const
+{
+    return m_vx.data();
+}
+
+const precision_t* ParticleSystem2D::vy() const
+{
+    return m_vy.data();
+}
+
+}
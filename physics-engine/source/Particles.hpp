@@ -0,0 +1,104 @@
+#ifndef PARTICLES_HPP
+#define PARTICLES_HPP
+
+#include "Configuration.hpp"
+#include "Physics.hpp"
+#include "Vector2.hpp"
+#include "Math.hpp"
+
+#include <vector>
+#include <memory>
+
+namespace PHYSICS_NAMESPACE
+{
+
+// Lightweight simulation for large amounts of small circles of the same size
+// Particles don't rotate and have no mass properties, they are moved with position based dynamics:
+// - They collide with each other through a spatial hash, or behave as a fluid (position based fluids)
+// - They collide with every object of a [Physics2D], but don't push those objects back
+class ParticleSystem2D final
+{
+
+    struct workers_t;
+
+    // Structure of arrays, so that every pass streams through only what it needs
+    std::vector<precision_t> m_x;  // Position
+    std::vector<precision_t> m_y;
+    std::vector<precision_t> m_px; // Predicted position
+    std::vector<precision_t> m_py;
+    std::vector<precision_t> m_vx; // Velocity
+    std::vector<precision_t> m_vy;
+    std::vector<precision_t> m_life;   // Remaining time to live
+    std::vector<precision_t> m_lambda; // Fluid density constraint multiplier
+    std::vector<precision_t> m_dx; // Position correction accumulated by the constraint passes
+    std::vector<precision_t> m_dy;
+
+    // Spatial hash, the particles are reordered by bucket every time it is built
+    std::vector<u32> m_keys;
+    std::vector<u32> m_cell_start; // First particle of every bucket
+    std::vector<u32> m_sorted;     // Previous index of the particle at every position
+    std::vector<precision_t> m_scratch;
+    u32 m_cell_mask;
+
+    const std::size_t m_max_particles;
+    const precision_t m_radius;
+
+    precision_t m_damping;
+    precision_t m_friction;
+    bool m_fluid;
+    u32 m_iterations;
+    precision_t m_kernel_radius;
+    precision_t m_mass; // Chosen so that the rest density is one
+    precision_t m_relaxation;
+    precision_t m_cell_size;
+
+    std::unique_ptr<workers_t> m_workers;
+
+    template <typename F>
+    void parallel_for(u32 count, F fn);
+    template <typename F>
+    void for_each_neighbour(u32 index, F fn) const;
+
+    u32 cell_key(i32 x, i32 y) const;
+    void build_hash();
+    void solve_contacts();
+    void solve_density();
+    void collide_world(Physics2D& world);
+
+public:
+
+    ParticleSystem2D() = delete;
+    ParticleSystem2D(std::size_t max_particles, precision_t radius, u32 threads = 1);
+    ~ParticleSystem2D();
+
+    // Particles are sorted by position and expired ones are removed, so indices change from one step to the next
+    void add(vec2 position, vec2 velocity, precision_t lifetime = math::infinity());
+
+    // Advances the particles by the timestep of the world, using its gravity
+    // Should be called after [Physics2D::simulate] so the broadphase is up to date
+    void simulate(Physics2D& world);
+
+    // Enables position based fluid behaviour, [iterations] is the number of density constraint passes
+    void fluid(bool enabled, u32 iterations = 3);
+    // Fraction of the velocity lost every second
+    precision_t& damping();
+    // Fraction of the sliding motion lost when touching an object of the world
+    precision_t& friction();
+
+    // Shifts every particle, see [Physics2D::rebase]
+    void rebase(vec2 origin);
+
+    u32 particles() const;
+    u32 capacity() const;
+    precision_t radius() const;
+
+    const precision_t* x() const;
+    const precision_t* y() const;
+    const precision_t* vx() const;
+    const precision_t* vy() const;
+
+};
+
+}
+
+#endif // PARTICLES_HPP
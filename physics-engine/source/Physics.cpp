@@ -1,22 +1,19 @@
 #include "Physics.hpp"
+#include "Trace.hpp"
+#include "DebugDraw.hpp"
 
 #include <iostream>
 #include <algorithm>
+#include <functional>
 
 namespace PHYSICS_NAMESPACE
 {
 
-// Object type enumeration is used to index the dispatch function in the collision vtable
-enum object_type_t
-{
-    circle,
-    polygon,
-    object_type_count
-};
-
 /// Collision detections functions
 
-static bool collides_circle_circle(manifold_t& m)
+// Colliders report pairs that are apart by at most [margin], with a negative penetration (speculative contacts)
+
+static bool collides_circle_circle(manifold_t& m, precision_t margin)
 {
     assert((m.a->type) == circle);
     assert((m.b->type) == circle);
@@ -25,13 +22,13 @@ static bool collides_circle_circle(manifold_t& m)
     auto b = static_cast<circle_t*>(m.b);
 
     vec2 ab = (b->transform.position) - (a->transform.position);
-    f32 ab_radius = (a->radius) + (b->radius);
-    f32 ab_radius_sq = ab_radius * ab_radius;
+    precision_t ab_radius = (a->radius) + (b->radius);
+    precision_t ab_radius_sq = math::sq(ab_radius + margin);
 
     if (ab.lengthSq() > ab_radius_sq)
         return false;
 
-    f32 distance = ab.length();
+    precision_t distance = ab.length();
 
     if (distance > 0.0F)
     {
@@ -43,10 +40,12 @@ static bool collides_circle_circle(manifold_t& m)
         m.penetration = a->radius;
         m.normal = {0.0F, 1.0F};
     }
+    m.contacts_c = 1;
+    m.contacts[0] = (a->transform.position) + (m.normal * (a->radius));
     return true;
 }
 
-static bool collides_circle_polygon(manifold_t& m)
+static bool collides_circle_polygon(manifold_t& m, precision_t margin)
 {
     assert((m.a->type) == circle);
     assert((m.b->type) == polygon);
@@ -54,12 +53,12 @@ static bool collides_circle_polygon(manifold_t& m)
     auto b = static_cast<polygon_t*>(m.b);
     m.contacts_c = 0;
     vec2 center = ((a->transform.position) - (b->transform.position)).rotate(-b->transform.orientation);
-    f32 separation = -math::infinity();
+    precision_t separation = -math::infinity();
     u32 face_normal = 0;
     for (u32 i = 0; i < (b->vertices_c); ++i)
     {
-        f32 s = math::dot(b->normals[i], center - (b->positions[i]));
-        if (s > (a->radius)) return false;
+        precision_t s = math::dot(b->normals[i], center - (b->positions[i]));
+        if (s > (a->radius) + margin) return false;
         if (s > separation)
         {
             separation = s;
@@ -74,18 +73,20 @@ static bool collides_circle_polygon(manifold_t& m)
         m.contacts_c = 1;
         m.normal = -(b->normals[face_normal]).rotate(b->transform.orientation);
         m.contacts[0] = m.normal * (a->radius) + (a->transform.position);
-        m.penetration = (a->radius);
+        m.penetration = (a->radius) - separation;
         return true;
     }
     vec2 v1c = center - v1;
     vec2 v2c = center - v2;
-    f32 dot1 = math::dot(v1c, v2 - v1);
-    f32 dot2 = math::dot(v2c, v1 - v2);
+    precision_t dot1 = math::dot(v1c, v2 - v1);
+    precision_t dot2 = math::dot(v2c, v1 - v2);
     m.penetration = (a->radius) - separation;
     // Closest to v1
     if (dot1 < 0.0F)
     {
-        if (v1c.lengthSq() > math::sq(a->radius)) return false;
+        if (v1c.lengthSq() > math::sq((a->radius) + margin)) return false;
+        // Apart from the corner, the distance to the face would understate the gap
+        if (v1c.lengthSq() > math::sq(a->radius)) m.penetration = (a->radius) - v1c.length();
         m.contacts_c = 1;
         m.normal = (v1 - center).rotate(b->transform.orientation).normalize();
         m.contacts[0] = v1.rotate(b->transform.orientation) + (b->transform.position);        
@@ -93,7 +94,8 @@ static bool collides_circle_polygon(manifold_t& m)
     // Closest to v2
     else if (dot2 < 0.0F)
     {
-        if (v2c.lengthSq() > math::sq(a->radius)) return false;
+        if (v2c.lengthSq() > math::sq((a->radius) + margin)) return false;
+        if (v2c.lengthSq() > math::sq(a->radius)) m.penetration = (a->radius) - v2c.length();
         m.contacts_c = 1;
         m.normal = (v2 - center).rotate(b->transform.orientation).normalize();
         m.contacts[0] = v2.rotate(b->transform.orientation) + (b->transform.position);
@@ -102,7 +104,7 @@ static bool collides_circle_polygon(manifold_t& m)
     else
     {
         vec2 n = b->normals[face_normal];
-        if (math::dot(center - v1, n) > (a->radius)) return false;
+        if (math::dot(center - v1, n) > (a->radius) + margin) return false;
         m.contacts_c = 1;
         m.normal = -n.rotate(b->transform.orientation);
         m.contacts[0] = m.normal * (a->radius) + (a->transform.position);
@@ -110,23 +112,23 @@ static bool collides_circle_polygon(manifold_t& m)
     return true;
 }
 
-static bool collides_polygon_circle(manifold_t& m)
+static bool collides_polygon_circle(manifold_t& m, precision_t margin)
 {
     m.normal *= -1.0F;
     std::swap(m.a, m.b);
-    return collides_circle_polygon(m);
+    return collides_circle_polygon(m, margin);
 }
 
-static bool collides_polygon_polygon(manifold_t& m)
+static bool collides_polygon_polygon(manifold_t& m, precision_t margin)
 {
     auto support_point_fn = [](vec2* positions, u32 count, vec2 normal)
     {
         vec2 sp;
-        f32 max_distance = -math::infinity();
+        precision_t max_distance = -math::infinity();
         for (u32 i = 0; i < count; i++)
         {
             vec2 vertex = positions[i];
-            f32 distance = math::dot(vertex, normal);
+            precision_t distance = math::dot(vertex, normal);
             if (distance > max_distance)
             {
                 max_distance = distance;
@@ -137,20 +139,22 @@ static bool collides_polygon_polygon(manifold_t& m)
     };
     auto max_penetration_face_fn = [support_point_fn](u32& index, polygon_t* a, polygon_t* b)
     {
-        f32 max_penetration = -math::infinity();
+        precision_t max_penetration = -math::infinity();
         u32 max_index;
+        // The rotations are the same for every face, compute them once
+        precision_t sin_ab, cos_ab, sin_b, cos_b;
+        math::fast::sin_cos((a->transform.orientation) - (b->transform.orientation), sin_ab, cos_ab);
+        math::fast::sin_cos(-(b->transform.orientation), sin_b, cos_b);
+        vec2 offset = ((a->transform.position) - (b->transform.position)).rotate(sin_b, cos_b);
         for (u32 i = 0; i < (a->vertices_c); ++i)
         {
-            // Orient face normal with A and B modelspaces
-            vec2 b_normal = a->normals[i];
-            vec2 a_normal = b_normal.rotate(a->transform.orientation);
-            b_normal = a_normal.rotate(-(b->transform.orientation));
+            // Orient face normal with B modelspace
+            vec2 b_normal = a->normals[i].rotate(sin_ab, cos_ab);
             // Support point (farthest point from the normal direction)
             vec2 support = support_point_fn(b->positions, b->vertices_c, -b_normal);
-            vec2 vertex = a->positions[i].rotate(a->transform.orientation) + a->transform.position;
-            vertex = (vertex - (b->transform.position)).rotate(-(b->transform.orientation));
+            vec2 vertex = a->positions[i].rotate(sin_ab, cos_ab) + offset;
             // Compute penetration in B model space
-            f32 penetration = math::dot(b_normal, support - vertex);
+            precision_t penetration = math::dot(b_normal, support - vertex);
             // Save the deeper penetration
             if (penetration > max_penetration)
             {
@@ -168,10 +172,10 @@ static bool collides_polygon_polygon(manifold_t& m)
         vec2 ref_normal = ref_polygon->normals[ref_index].rotate(ref_polygon->transform.orientation).rotate(-(inc_polygon->transform.orientation));
         u32 incident_face;
         // It's actually the cosine of the theta : u.v = cos(t)*|u|*|v|
-        f32 min_theta = math::infinity();
+        precision_t min_theta = math::infinity();
         for (u32 i = 0; i < (inc_polygon->vertices_c); ++i)
         {
-            f32 theta = math::dot(ref_normal, inc_polygon->normals[i]);
+            precision_t theta = math::dot(ref_normal, inc_polygon->normals[i]);
             if (theta < min_theta)
             {
                 min_theta = theta;
@@ -182,27 +186,27 @@ static bool collides_polygon_polygon(manifold_t& m)
         v[0] = inc_polygon->positions[incident_face++].rotate(inc_polygon->transform.orientation) + inc_polygon->transform.position;
         v[1] = inc_polygon->positions[incident_face % (inc_polygon->vertices_c)].rotate(inc_polygon->transform.orientation) + (inc_polygon->transform.position);
     };
-    auto clip_fn = [](vec2 normal, f32 distance, vec2* face)
+    auto clip_fn = [](vec2 normal, precision_t distance, vec2* face)
     {
         u32 clipped = 0;
         vec2 out[2] = {face[0], face[1]};
-        f32 d1 = math::dot(normal, face[0]) - distance;
-        f32 d2 = math::dot(normal, face[1]) - distance;
+        precision_t d1 = math::dot(normal, face[0]) - distance;
+        precision_t d2 = math::dot(normal, face[1]) - distance;
         if (d1 <= 0.0F) out[clipped++] = face[0];
         if (d2 <= 0.0F) out[clipped++] = face[1];
         if (d1 * d2 < 0.0F)
         {
-            f32 alpha = d1 / (d1 - d2);
+            precision_t alpha = d1 / (d1 - d2);
             out[clipped++] = face[0] + alpha * (face[1] - face[0]);
         }
         face[0] = out[0];
         face[1] = out[1];
         return clipped;
     };
-    auto bias_greater_than = [](f32 a, f32 b)
+    auto bias_greater_than = [](precision_t a, precision_t b)
     {
-        constexpr f32 kr = 0.95f;
-        constexpr f32 ka = 0.01f;
+        constexpr precision_t kr = 0.95f;
+        constexpr precision_t ka = 0.01f;
         return a >= (b * kr + a * ka);
     };
 
@@ -214,12 +218,12 @@ static bool collides_polygon_polygon(manifold_t& m)
     m.contacts_c = 0;
 
     u32 face_a;
-    f32 penetration_a = max_penetration_face_fn(face_a, a, b);
-    if (penetration_a > 0.0F) return false;
+    precision_t penetration_a = max_penetration_face_fn(face_a, a, b);
+    if (penetration_a > margin) return false;
 
     u32 face_b;
-    f32 penetration_b = max_penetration_face_fn(face_b, b, a);
-    if (penetration_b > 0.0F) return false;
+    precision_t penetration_b = max_penetration_face_fn(face_b, b, a);
+    if (penetration_b > margin) return false;
     
     u32 reference_index;
     bool flip; // Always point from a to b
@@ -228,7 +232,7 @@ static bool collides_polygon_polygon(manifold_t& m)
     polygon_t* inc; // Incident
 
     // Determine which shape contains reference face
-    if bias_greater_than(penetration_a, penetration_b))
+    if (bias_greater_than(penetration_a, penetration_b))
     {
         ref = a;
         inc = b;
@@ -256,9 +260,9 @@ static bool collides_polygon_polygon(manifold_t& m)
     vec2 side_plane_normal = (v2 - v1).normalize();
     vec2 ref_face_normal = side_plane_normal.rotateCW90();
 
-    f32 ref_c = math::dot(ref_face_normal, v1);
-    f32 neg_side = -math::dot(side_plane_normal, v1);
-    f32 pos_side = math::dot(side_plane_normal, v2);
+    precision_t ref_c = math::dot(ref_face_normal, v1);
+    precision_t neg_side = -math::dot(side_plane_normal, v1);
+    precision_t pos_side = math::dot(side_plane_normal, v2);
 
     if (clip_fn(-side_plane_normal, neg_side, incident_face) < 2) return false;
     if (clip_fn(side_plane_normal, pos_side, incident_face) < 2) return false;
@@ -266,29 +270,38 @@ static bool collides_polygon_polygon(manifold_t& m)
     m.normal = flip ? -ref_face_normal : ref_face_normal;
 
     u32 cp = 0;
-    f32 separation = math::dot(ref_face_normal, incident_face[0]) - ref_c;
-    if (separation <= 0.0F)
-    {
-        m.contacts[cp++] = incident_face[0];
-        m.penetration = -separation;
-    }
-    else m.penetration = 0.0F;
-
-    separation = math::dot(ref_face_normal, incident_face[1]) - ref_c;
-    if (separation <= 0.0F)
+    precision_t separations[2] = {math::dot(ref_face_normal, incident_face[0]) - ref_c,
+                                  math::dot(ref_face_normal, incident_face[1]) - ref_c};
+    // Points that are still apart only make a contact while nothing touches yet
+    precision_t closest = math::min(separations[0], separations[1]);
+    precision_t limit = (closest <= 0.0F) ? 0.0F : margin;
+    m.penetration = 0.0F;
+    for (u32 i = 0; i < 2; ++i)
     {
-        m.contacts[cp++] = incident_face[1];
-        m.penetration -= separation;
+        if (separations[i] > limit) continue;
+        m.contacts[cp++] = incident_face[i];
+        if (separations[i] <= 0.0F) m.penetration -= separations[i];
     }
+    if (closest > 0.0F) m.penetration = -closest;
     m.contacts_c = cp;
     return true;
 }
 
-/// Polygon utility functions
+/// Mass utility functions
 
-static body_t compute_polygon_mass(vec2* positions, u32 count, f32 density)
+static body_t compute_circle_mass(precision_t radius, precision_t density)
 {
-    constexpr f32 k = (1.0F / 12.0F);
+    body_t body;
+    body.mass = math::pi() * math::sq(radius) * density;
+    body.i_mass = 1.0F / body.mass;
+    body.moment_inertia = 0.5F * math::pi() * math::pow(radius, precision_t(4)) * density;
+    body.i_moment_inertia = 1.0F / body.moment_inertia;
+    return body;
+}
+
+static body_t compute_polygon_mass(vec2* positions, u32 count, precision_t density)
+{
+    constexpr precision_t k = (1.0F / 12.0F);
     body_t body = {};
 
     for (std::size_t i = 0, j = count - 1; i < count; j = i++)
@@ -296,7 +309,7 @@ static body_t compute_polygon_mass(vec2* positions, u32 count, f32 density)
         vec2 a = positions[j];
         vec2 b = positions[i];
         vec2 integral = (a * a) + (a * b) + (b * b);
-        f32 length = mat2 {positions[j], positions[i]}.determinant();
+        precision_t length = mat2 {positions[j], positions[i]}.determinant();
         body.mass += (b.x - a.x) * (b.y + a.y);
         body.moment_inertia += k * length * (integral.x + integral.y);
     }
@@ -308,22 +321,149 @@ static body_t compute_polygon_mass(vec2* positions, u32 count, f32 density)
     return body;
 }
 
-using collider_f = bool(*)(manifold_t&);
-constexpr static collider_f collision_vtable[object_type_count][object_type_count] =
+// Compounds are split into their convex children before dispatching
+using collider_f = bool(*)(manifold_t&, precision_t margin);
+constexpr static collider_f collision_vtable[compound][compound] =
 {
     {collides_circle_circle,  collides_circle_polygon },
     {collides_polygon_circle, collides_polygon_polygon},
 };
 
-static void impulse_resolution(manifold_t& m)
+/// Broadphase and compound utility functions
+
+static aabb_t compute_aabb(const object_t& o)
+{
+    vec2 position = o.transform.position;
+    switch (o.type)
+    {
+    case circle:
+    {
+        auto& c = static_cast<const circle_t&>(o);
+        vec2 extent = {c.radius, c.radius};
+        return {position - extent, position + extent};
+    }
+    case polygon:
+    {
+        auto& p = static_cast<const polygon_t&>(o);
+        precision_t sin, cos;
+        math::fast::sin_cos(p.transform.orientation, sin, cos);
+        vec2 vertex = p.positions[0].rotate(sin, cos);
+        aabb_t box = {vertex, vertex};
+        for (u32 i = 1; i < p.vertices_c; ++i)
+        {
+            vertex = p.positions[i].rotate(sin, cos);
+            box = merge(box, {vertex, vertex});
+        }
+        box.min += position;
+        box.max += position;
+        return box;
+    }
+    default:
+    {
+        auto& m = static_cast<const compound_t&>(o);
+        return transform(m.tree->bounds(), position, m.transform.orientation);
+    }
+    }
+}
+
+// Child shapes are stored in model space, the narrowphase needs them as standalone objects
+union proxy_t
+{
+    object_t o;
+    circle_t c;
+    polygon_t p;
+};
+
+static proxy_t make_proxy(const compound_t& m, const child_t& child)
+{
+    proxy_t proxy;
+    proxy.o.type = child.type;
+    proxy.o.transform.position = child.offset.rotate(m.transform.orientation) + m.transform.position;
+    proxy.o.transform.orientation = child.orientation + m.transform.orientation;
+    proxy.o.transform.scale = m.transform.scale;
+    if (child.type == circle)
+        proxy.c.radius = child.radius;
+    else
+    {
+        proxy.p.positions = child.positions;
+        proxy.p.normals = child.normals;
+        proxy.p.vertices_c = child.vertices_c;
+    }
+    return proxy;
+}
+
+// Calls fn(part) for every convex part of the object that may overlap [box]
+template <typename F>
+static void for_each_part(object_t* o, const aabb_t& box, F fn)
+{
+    if (o->type != compound)
+    {
+        fn(o);
+        return;
+    }
+    auto m = static_cast<compound_t*>(o);
+    aabb_t local = transform(box, {0.0F, 0.0F}, 0.0F);
+    local.min -= m->transform.position;
+    local.max -= m->transform.position;
+    local = transform(local, {0.0F, 0.0F}, -(m->transform.orientation));
+    m->tree->query(local, [m, &fn](u32 index)
+    {
+        proxy_t proxy = make_proxy(*m, m->children[index]);
+        fn(&proxy.o);
+    });
+}
+
+// Calls resolve(manifold) for every pair of convex parts in contact, or closer than [margin]
+// The manifolds always refer to the bodies, never to the parts of a compound
+template <typename F>
+static void collide(object_t* a, object_t* b, F resolve, precision_t margin = 0.0F)
+{
+    manifold_t m;
+
+    if ((a->type != compound) && (b->type != compound))
+    {
+        m.a = a;
+        m.b = b;
+        if (collision_vtable[a->type][b->type](m, margin)) resolve(m);
+        return;
+    }
+
+    auto bounds = [margin](const object_t& o)
+    {
+        aabb_t box = compute_aabb(o);
+        box.min -= vec2 {margin, margin};
+        box.max += vec2 {margin, margin};
+        return box;
+    };
+    for_each_part(a, bounds(*b), [&](object_t* part_a)
+    {
+        for_each_part(b, bounds(*part_a), [&](object_t* part_b)
+        {
+            m.a = part_a;
+            m.b = part_b;
+            if (!collision_vtable[part_a->type][part_b->type](m, margin)) return;
+            // Colliders may swap the order of the parts
+            m.a = (m.a == part_a) ? a : b;
+            m.b = (m.b == part_b) ? b : a;
+            resolve(m);
+        });
+    });
+}
+
+// Returns the magnitude of the normal impulse applied to the objects
+// Later iterations only remove the approaching speed that is left, bouncing is applied once
+// Objects that are still apart may close the gap during the step, [timestep] turns it into an allowed speed
+static precision_t impulse_resolution(manifold_t& m, bool bounce, precision_t timestep)
 {
     auto a = m.a;
     auto b = m.b;
+    precision_t total = 0.0F;
+    precision_t gap = math::max(-(m.penetration), precision_t(0)) / timestep;
 
     // Function used to estimate the friction between two bodies
-    auto friction_fn = [](f32 f1, f32 f2)
+    auto friction_fn = [](precision_t f1, precision_t f2)
     {
-        constexpr f32 i_sqrt2 = 0.70710678118F;
+        constexpr precision_t i_sqrt2 = 0.70710678118F;
         return (f1 + f2) * i_sqrt2;
     };
 
@@ -342,22 +482,24 @@ static void impulse_resolution(manifold_t& m)
         vec2 rv = (b->motion.velocity) + ((b->motion.omega) * rb).rotateCCW90()
                 - (a->motion.velocity) - ((a->motion.omega) * ra).rotateCCW90();
 
-        f32 speed = math::dot(rv, m.normal);
+        precision_t speed = math::dot(rv, m.normal);
 
-        // Objects are moving away from eachother
-        if (speed > 0.0F) return;
+        // Objects are moving away from eachother, or too slowly to meet during this step
+        if (speed + gap > 0.0F) return total;
 
-        f32 racn = mat2 {ra, m.normal}.determinant();
-        f32 rbcn = mat2 {rb, m.normal}.determinant();
+        precision_t racn = mat2 {ra, m.normal}.determinant();
+        precision_t rbcn = mat2 {rb, m.normal}.determinant();
 
-        f32 i_mass_sum = (a->body.i_mass) + math::sq(racn) * (a->body.i_moment_inertia)
+        precision_t i_mass_sum = (a->body.i_mass) + math::sq(racn) * (a->body.i_moment_inertia)
                        + (b->body.i_mass) + math::sq(rbcn) * (b->body.i_moment_inertia);
 
         // TODO: when only gravity is acting on the two bodies, make restituion zero
-        f32 e = math::min(a->material.restitution, b->material.restitution);
-        f32 j = -(1.0F + e) * speed / i_mass_sum; j /= f32(m.contacts_c);
+        precision_t e = bounce ? math::min(a->material.restitution, b->material.restitution) : 0.0F;
+        precision_t j = (gap > 0.0F) ? -(speed + gap) / i_mass_sum : -(1.0F + e) * speed / i_mass_sum;
+        j /= precision_t(m.contacts_c);
 
         vec2 impulse = j * m.normal;
+        total += j;
 
         impulse_fn(a, -impulse, ra);
         impulse_fn(b, impulse, rb);
@@ -372,14 +514,14 @@ static void impulse_resolution(manifold_t& m)
            - (a->motion.velocity) - ((a->motion.omega) * ra).rotateCCW90();
 
         vec2 tangent = (rv - m.normal * math::dot(rv, m.normal)).normalize();
-        f32 jt = -math::dot(rv, tangent) / i_mass_sum; jt /= f32(m.contacts_c);
+        precision_t jt = -math::dot(rv, tangent) / i_mass_sum; jt /= precision_t(m.contacts_c);
 
-        f32 sf = friction_fn(a->material.static_coef, b->material.static_coef);
+        precision_t sf = friction_fn(a->material.static_coef, b->material.static_coef);
         if (math::abs(jt) < j * sf)
             impulse = jt * tangent;
         else
         {
-            f32 df = friction_fn(a->material.dynamic_coef, b->material.dynamic_coef);
+            precision_t df = friction_fn(a->material.dynamic_coef, b->material.dynamic_coef);
             impulse = -j * tangent * df;
         }
 
@@ -387,35 +529,69 @@ static void impulse_resolution(manifold_t& m)
         impulse_fn(b, impulse, rb);
 
     }
+    return total;
 }
 
 static void positional_correction(manifold_t& m)
 {
-    constexpr f32 percent = 1.0F;
-    constexpr f32 slop = 0.25F;
-    vec2 correction = percent * m.normal * math::max(m.penetration - slop, 0.0F);
-    f32 t = m.a->body.i_mass / (m.a->body.i_mass + m.b->body.i_mass);
+    constexpr precision_t percent = 1.0F;
+    constexpr precision_t slop = 0.25F;
+    vec2 correction = percent * m.normal * math::max(m.penetration - slop, precision_t(0));
+    precision_t t = m.a->body.i_mass / (m.a->body.i_mass + m.b->body.i_mass);
     m.a->transform.position -= t * correction;
     m.b->transform.position += (1.0F - t) * correction;
 }
-static void positional_correction_s(manifold_t& m)
+
+joint_t make_joint(u32 type, object_t* a, object_t* b, vec2 anchor_a, vec2 anchor_b, vec2 axis)
+{
+    assert(a && (a != b));
+    auto to_model = [](const object_t* o, vec2 p) { return (p - o->transform.position).rotate(-o->transform.orientation); };
+    joint_t joint = {};
+    joint.type = type;
+    joint.a = a;
+    joint.b = b;
+    joint.anchor_a = to_model(a, anchor_a);
+    joint.anchor_b = b ? to_model(b, anchor_b) : anchor_b;
+    joint.axis = axis.normalize().rotate(-a->transform.orientation);
+    joint.length = (anchor_b - anchor_a).length();
+    joint.reference = (b ? b->transform.orientation : 0.0F) - a->transform.orientation;
+    return joint;
+}
+
+void collide(object_t* a, object_t* b, manifold_callback_t callback, void* user)
+{
+    collide(a, b, [callback, user](manifold_t& m)
+    {
+        callback(m, user);
+    });
+}
+
+// Objects live in two different arrays, std::less gives a total order over their addresses
+template <typename pair_t>
+static pair_t ordered_pair(const object_t* a, const object_t* b)
+{
+    return std::less<const object_t*>()(a, b) ? pair_t {a, b} : pair_t {b, a};
+}
+
+template <typename pair_t>
+static bool pair_less(const pair_t& x, const pair_t& y)
 {
-    constexpr f32 percent = 1.0F;
-    constexpr f32 slop = 0.25F;
-    vec2 correction = percent * m.normal * math::max(m.penetration - slop, 0.0F);
-    m.a->transform.position -= correction;
+    std::less<const object_t*> order;
+    return (x.first != y.first) ? order(x.first, y.first) : order(x.second, y.second);
 }
 
 /// Engine class implementation
 
-Physics2D::Physics2D(std::size_t max_objects, f32 timestep)
-    : m_max_objects {max_objects}, m_timestep {timestep}, m_half_timestep {timestep * 0.5F}, m_gravity {0.0F, 0.0F}
+Physics2D::Physics2D(std::size_t max_objects, precision_t timestep)
+    : m_timestep {timestep}, m_half_timestep {timestep * 0.5F}, m_max_objects {max_objects}, m_gravity {0.0F, 0.0F}, m_origin {0.0, 0.0}, m_frame {0}, m_static_dirty {false}, m_ground {}, m_iterations {8}, m_speculative {false}, m_recorder {nullptr}
 {
+    m_ground.body = {math::infinity(), 0.0F, math::infinity(), 0.0F};
     m_dynamic.reserve(max_objects);
     m_static.reserve(max_objects);
+    m_frozen.reserve(max_objects);
 }
 
-circle_t* Physics2D::add(const transform_t& transform, const material_t& material, const motion_t& motion, f32 density, f32 radius)
+circle_t* Physics2D::add(const transform_t& transform, const material_t& material, const motion_t& motion, precision_t density, precision_t radius)
 {
     assert(m_dynamic.size() < m_max_objects);
     shape_t shape;
@@ -424,10 +600,7 @@ circle_t* Physics2D::add(const transform_t& transform, const material_t& materia
     shape.c.material = material;
     shape.c.motion = motion;
     shape.c.radius = radius;
-    shape.c.body.mass = math::pi() * math::sq(radius) * density;
-    shape.c.body.i_mass = 1.0F / shape.c.body.mass;
-    shape.c.body.moment_inertia = 0.5F * math::pi() * math::pow(radius, 4.0F) * density;
-    shape.c.body.i_moment_inertia = 1.0F / shape.c.body.moment_inertia;
+    shape.c.body = compute_circle_mass(radius, density);
     if (shape.c.body.i_mass != 0.0F)
     {
         m_dynamic.emplace_back(shape);
@@ -435,12 +608,11 @@ circle_t* Physics2D::add(const transform_t& transform, const material_t& materia
     }
     else
     {
-        m_static.emplace_back(shape);
-        return static_cast<circle_t*>(&m_static.back().c);
+        return static_cast<circle_t*>(&add_static(shape)->c);
     }
 }
 
-polygon_t* Physics2D::add(const transform_t& transform, const material_t& material, const motion_t& motion, f32 density, vec2* positions, vec2* normals, u32 vertices_c)
+polygon_t* Physics2D::add(const transform_t& transform, const material_t& material, const motion_t& motion, precision_t density, vec2* positions, vec2* normals, u32 vertices_c)
 {
     assert(m_dynamic.size() < m_max_objects);
     shape_t shape;
@@ -459,54 +631,568 @@ polygon_t* Physics2D::add(const transform_t& transform, const material_t& materi
     }
     else
     {
-        m_static.emplace_back(shape);
-        return static_cast<polygon_t*>(&m_static.back().p);
+        return static_cast<polygon_t*>(&add_static(shape)->p);
+    }
+}
+
+compound_t* Physics2D::add(const transform_t& transform, const material_t& material, const motion_t& motion, const child_t* children, u32 children_c)
+{
+    assert(m_dynamic.size() < m_max_objects);
+    assert(children_c > 0);
+
+    m_compounds.emplace_back();
+    auto& data = m_compounds.back();
+    data.children.assign(children, children + children_c);
+
+    // Mass properties of each child around its own origin
+    std::vector<body_t> bodies(children_c);
+    bool is_static = false;
+    for (u32 i = 0; i < children_c; ++i)
+    {
+        const child_t& child = children[i];
+        assert(child.type != compound);
+        bodies[i] = (child.type == circle) ? compute_circle_mass(child.radius, child.density)
+                                           : compute_polygon_mass(child.positions, child.vertices_c, child.density);
+        is_static |= (bodies[i].i_mass == 0.0F);
+    }
+
+    shape_t shape;
+    shape.m.type = object_type_t::compound;
+    shape.m.transform = transform;
+    shape.m.material = material;
+    shape.m.motion = motion;
+
+    if (is_static)
+    {
+        shape.m.body = {math::infinity(), 0.0F, math::infinity(), 0.0F};
+    }
+    else
+    {
+        // Move the body origin to the combined center of mass
+        body_t body = {};
+        vec2 com = {0.0F, 0.0F};
+        for (u32 i = 0; i < children_c; ++i)
+        {
+            body.mass += bodies[i].mass;
+            com += children[i].offset * bodies[i].mass;
+        }
+        com /= body.mass;
+
+        // Parallel axis theorem
+        for (u32 i = 0; i < children_c; ++i)
+        {
+            data.children[i].offset -= com;
+            body.moment_inertia += bodies[i].moment_inertia + bodies[i].mass * data.children[i].offset.lengthSq();
+        }
+        body.i_mass = 1.0F / body.mass;
+        body.i_moment_inertia = 1.0F / body.moment_inertia;
+
+        shape.m.body = body;
+        shape.m.transform.position += com.rotate(transform.orientation);
     }
+
+    // Children bounding volumes in model space
+    std::vector<aabb_t> boxes(children_c);
+    for (u32 i = 0; i < children_c; ++i)
+    {
+        proxy_t proxy = make_proxy(shape.m, data.children[i]);
+        proxy.o.transform.position = data.children[i].offset;
+        proxy.o.transform.orientation = data.children[i].orientation;
+        boxes[i] = compute_aabb(proxy.o);
+    }
+    data.tree.build(boxes.data(), children_c);
+
+    shape.m.children = data.children.data();
+    shape.m.children_c = children_c;
+    shape.m.tree = &data.tree;
+
+    if (!is_static)
+    {
+        m_dynamic.emplace_back(shape);
+        return static_cast<compound_t*>(&m_dynamic.back().m);
+    }
+    else
+    {
+        return static_cast<compound_t*>(&add_static(shape)->m);
+    }
+}
+
+handle_t<force_field_t> Physics2D::add(const force_field_t& field)
+{
+    return m_fields.insert(field);
+}
+
+void Physics2D::remove(handle_t<force_field_t> field)
+{
+    m_fields.erase(field);
+}
+
+force_field_t* Physics2D::field(handle_t<force_field_t> field)
+{
+    return m_fields.find(field);
+}
+
+handle_t<joint_t> Physics2D::add(const joint_t& joint)
+{
+    assert(joint.a && (joint.a != joint.b));
+    return m_joints.insert(joint);
+}
+
+void Physics2D::remove(handle_t<joint_t> joint)
+{
+    m_joints.erase(joint);
+}
+
+joint_t* Physics2D::joint(handle_t<joint_t> joint)
+{
+    return m_joints.find(joint);
+}
+
+Physics2D::shape_t* Physics2D::add_static(const shape_t& shape)
+{
+    m_static_dirty = true;
+    if (m_static_free.empty())
+    {
+        // The vector must not reallocate, the objects are referenced by address
+        assert(m_static.size() < m_max_objects);
+        m_static.push_back(shape);
+        return &m_static.back();
+    }
+    u32 index = m_static_free.back();
+    m_static_free.pop_back();
+    m_static[index] = shape;
+    return &m_static[index];
+}
+
+void Physics2D::remove_static(u32 index)
+{
+    assert((index < m_static.size()) && (m_static[index].o.type != removed));
+    m_static[index].o.type = removed;
+    m_static_free.push_back(index);
+    m_static_dirty = true;
+}
+
+void Physics2D::forget_removed()
+{
+    auto is_removed = [](const object_t* o) { return o && (o->type == removed); };
+    auto touches = [&is_removed](const contact_event_t& contact) { return is_removed(contact.a) || is_removed(contact.b); };
+
+    // The events of the last step are dropped too, so that the game never reads a tombstone
+    u32 kept = 0;
+    for (const auto& contact : m_previous_contacts)
+        if (!touches(contact)) m_previous_contacts[kept++] = contact;
+    m_previous_contacts.resize(kept);
+    kept = 0;
+    for (const auto& event : m_events)
+        if (!touches(event)) m_events[kept++] = event;
+    m_events.resize(kept);
+
+    // Handles of the joints become stale, like after [remove]
+    m_joints.erase_if([&is_removed](const joint_t& joint) { return is_removed(joint.a) || is_removed(joint.b); });
+}
+
+void Physics2D::begin_frame()
+{
+    // The arena of the step before last only holds results that have been replaced since
+    m_frame ^= 1;
+    FrameArena& arena = m_arenas[m_frame];
+    arena.reset();
+
+    m_active.reset(arena);
+    m_dynamic_boxes.reset(arena);
+    m_manifolds.reset(arena);
+    m_contacts.reset(arena);
+    m_events.reset(arena);
+    m_accelerations.reset(arena);
+    m_field_targets.reset(arena);
+    m_field_x.reset(arena);
+    m_field_y.reset(arena);
+    m_field_w.reset(arena);
+    m_connected.reset(arena);
+    m_rows.reset(arena);
+    m_impulses.reset(arena);
+}
+
+void Physics2D::update_static_tree()
+{
+    // Static objects don't move, their tree only needs to be rebuilt when one is added
+    if (!m_static_dirty) return;
+    m_static_boxes.clear();
+    m_static_items.clear();
+    for (u32 i = 0; i < m_static.size(); ++i)
+    {
+        if (m_static[i].o.type == removed) continue;
+        m_static_boxes.push_back(compute_aabb(m_static[i].o));
+        m_static_items.push_back(i);
+    }
+    m_static_tree.build(m_static_boxes.data(), m_static_boxes.size());
+    m_static_dirty = false;
 }
 
 void Physics2D::simulate()
 {
-    manifold_t manifold;
+    if (m_recorder) m_recorder->begin_step(*this);
+    begin_frame();
+    update_static_tree();
+
+    // Objects added since the last step start awake
+    m_frozen.resize(m_dynamic.size(), 0);
+    m_active.clear();
+    for (u32 i = 0; i < m_dynamic.size(); ++i)
+        if (!m_frozen[i]) m_active.push_back(i);
+
+    m_dynamic_boxes.resize(m_active.size());
+    for (u32 i = 0; i < m_active.size(); ++i) m_dynamic_boxes[i] = compute_aabb(m_dynamic[m_active[i]].o);
+    if (m_speculative)
+    {
+        // Boxes cover the whole motion of the step, so pairs that will meet are found before they touch
+        for (u32 i = 0; i < m_active.size(); ++i)
+        {
+            vec2 motion = m_dynamic[m_active[i]].o.motion.velocity * m_timestep;
+            m_dynamic_boxes[i].min += {math::min(motion.x, precision_t(0)), math::min(motion.y, precision_t(0))};
+            m_dynamic_boxes[i].max += {math::max(motion.x, precision_t(0)), math::max(motion.y, precision_t(0))};
+        }
+    }
+    m_dynamic_tree.build(m_dynamic_boxes.data(), m_dynamic_boxes.size());
+    apply_fields();
+
+    update_connected();
 
-    for (auto i = m_dynamic.begin(); i != m_dynamic.end(); ++i)
+    // Find every contact before resolving any of them, so that the result doesn't depend on the order of the objects
+    m_manifolds.clear();
+    auto store = [this](manifold_t& manifold) { m_manifolds.push_back(manifold); };
+    // Distance the pair closes in one step, rotation is left out
+    auto margin = [this](const object_t* a, const object_t* b)
     {
-        for (auto j = (i + 1); j != m_dynamic.end(); ++j)
+        return m_speculative ? (b->motion.velocity - a->motion.velocity).length() * m_timestep : precision_t(0);
+    };
+    for (u32 index = 0; index < m_active.size(); ++index)
+    {
+        object_t* o = &m_dynamic[m_active[index]].o;
+
+        // TODO: layering
+
+        m_dynamic_tree.query(m_dynamic_boxes[index], [this, o, index, &store, &margin](u32 j)
+        {
+            // Each pair is only visited once
+            if (j <= index) return;
+            object_t* other = &m_dynamic[m_active[j]].o;
+            if (!connected(o, other)) collide(o, other, store, margin(o, other));
+        });
+        m_static_tree.query(m_dynamic_boxes[index], [this, o, &store, &margin](u32 j)
         {
-            manifold.a = &i->o;
-            manifold.b = &j->o;
+            object_t* other = &m_static[m_static_items[j]].o;
+            if (!connected(o, other)) collide(o, other, store, margin(o, other));
+        });
+    }
+
+    // Joints and contacts share the iterations, so that a chain resting on the ground settles as a whole
+    prepare_joints();
+    m_impulses.assign(m_manifolds.size(), 0.0F);
+    for (u32 iteration = 0; iteration < m_iterations; ++iteration)
+    {
+        solve_rows();
+        for (u32 i = 0; i < m_manifolds.size(); ++i) m_impulses[i] += impulse_resolution(m_manifolds[i], iteration == 0, m_timestep);
+    }
+
+    for (u32 i = 0; i < m_manifolds.size(); ++i)
+    {
+        // Colliders may swap the bodies, so let the mass ratio keep the static one in place
+        manifold_t& manifold = m_manifolds[i];
+        positional_correction(manifold);
+        // Speculative contacts are not touching yet
+        if (manifold.penetration < 0.0F) continue;
+        m_contacts.push_back({manifold.a, manifold.b, manifold.normal, manifold.contacts[0], m_impulses[i], contact_persist});
+    }
+    update_contact_events();
 
-            // TODO: broadphasing
-            // TODO: layering
+    for (u32 i : m_active)
+    {
+        object_t& o = m_dynamic[i].o;
+        // Linear motion integration
+        o.motion.velocity += ((o.motion.force) * (o.body.i_mass) + m_gravity + m_accelerations[i]) * m_half_timestep;
+        o.motion.velocity *= 1.0F / (1.0F + (o.motion.linear_damping) * m_timestep);
+        o.transform.position += (o.motion.velocity) * m_timestep;
+        o.motion.force = {};
+        // Angular motion integration
+        o.motion.omega += (o.motion.torque) * (o.body.i_moment_inertia) * m_half_timestep;
+        o.motion.omega *= 1.0F / (1.0F + (o.motion.angular_damping) * m_timestep);
+        o.transform.orientation += (o.motion.omega) * m_timestep;
+        o.motion.torque = {};
+    }
 
-            if (collision_vtable[manifold.a->type][manifold.b->type](manifold))
+    if (m_recorder) m_recorder->end_step(*this);
+}
+
+void Physics2D::apply_fields()
+{
+    m_accelerations.assign(m_dynamic.size(), {0.0F, 0.0F});
+    for (const auto& field : m_fields)
+    {
+        m_field_targets.clear();
+        m_dynamic_tree.query(field.region, [this](u32 index) { m_field_targets.push_back(m_active[index]); });
+        u32 count = m_field_targets.size();
+        if (count == 0) continue;
+
+        m_field_x.resize(count);
+        m_field_y.resize(count);
+        m_field_w.resize(count);
+        precision_t* x = m_field_x.data();
+        precision_t* y = m_field_y.data();
+        precision_t* w = m_field_w.data();
+        const u32* targets = m_field_targets.data();
+
+        // Gather, evaluate the field without branches, then scatter the accelerations back
+        if (field.type == field_directional)
+        {
+            for (u32 i = 0; i < count; ++i)
             {
-                impulse_resolution(manifold);
-                positional_correction(manifold);
+                x[i] = field.direction.x * field.strength;
+                y[i] = field.direction.y * field.strength;
             }
         }
-        for (auto j = m_static.begin(); j != m_static.end(); ++j)
+        else if (field.type == field_drag)
         {
-            manifold.a = &i->o;
-            manifold.b = &j->o;
+            for (u32 i = 0; i < count; ++i)
+            {
+                const vec2& velocity = m_dynamic[targets[i]].o.motion.velocity;
+                x[i] = velocity.x;
+                y[i] = velocity.y;
+            }
+            for (u32 i = 0; i < count; ++i)
+            {
+                x[i] *= -field.strength;
+                y[i] *= -field.strength;
+            }
+        }
+        else
+        {
+            for (u32 i = 0; i < count; ++i)
+            {
+                const vec2& position = m_dynamic[targets[i]].o.transform.position;
+                x[i] = position.x - field.center.x;
+                y[i] = position.y - field.center.y;
+                // Objects exactly on the center are not pushed anywhere instead of producing NaNs
+                w[i] = x[i] * x[i] + y[i] * y[i] + math::epsilon();
+            }
+            math::fast::rsqrt(w, w, count);
 
-            if (collision_vtable[manifold.a->type][manifold.b->type](manifold))
+            // Linear falloff, a zero distance leaves the strength constant
+            precision_t i_falloff = (field.falloff > 0.0F) ? 1.0F / field.falloff : 0.0F;
+            for (u32 i = 0; i < count; ++i)
             {
-                impulse_resolution(manifold);
-                positional_correction_s(manifold);
+                precision_t distance = (x[i] * x[i] + y[i] * y[i]) * w[i];
+                w[i] = field.strength * w[i] * math::max(1.0F - distance * i_falloff, precision_t(0.0F));
+            }
+            if (field.type == field_vortex)
+            {
+                // Tangent is the direction rotated by a quarter turn
+                for (u32 i = 0; i < count; ++i)
+                {
+                    precision_t t = x[i];
+                    x[i] = -y[i] * w[i];
+                    y[i] = t * w[i];
+                }
+            }
+            else
+            {
+                for (u32 i = 0; i < count; ++i)
+                {
+                    x[i] *= w[i];
+                    y[i] *= w[i];
+                }
             }
         }
-        // Linear motion integration
-        i->o.motion.velocity += ((i->o.motion.force) * (i->o.body.i_mass) + m_gravity) * m_half_timestep;
-        i->o.transform.position += (i->o.motion.velocity) * m_timestep;
-        i->o.motion.force = {};
-        // Angular motion integration
-        i->o.motion.omega += (i->o.motion.torque) * (i->o.body.i_moment_inertia) * m_half_timestep;
-        i->o.transform.orientation += (i->o.motion.omega) * m_timestep;
-        i->o.motion.torque = {};
+
+        for (u32 i = 0; i < count; ++i) m_accelerations[targets[i]] += {x[i], y[i]};
+    }
+}
+
+void Physics2D::update_connected()
+{
+    m_connected.clear();
+    for (const auto& joint : m_joints)
+    {
+        if (joint.collide || !joint.b) continue;
+        m_connected.push_back(ordered_pair<object_pair_t>(joint.a, joint.b));
+    }
+    std::sort(m_connected.begin(), m_connected.end(), pair_less<object_pair_t>);
+}
+
+bool Physics2D::connected(const object_t* a, const object_t* b) const
+{
+    if (m_connected.empty()) return false;
+    object_pair_t pair = ordered_pair<object_pair_t>(a, b);
+    return std::binary_search(m_connected.begin(), m_connected.end(), pair, pair_less<object_pair_t>);
+}
+
+void Physics2D::prepare_joints()
+{
+    // Fraction of the position error removed in one step (Baumgarte stabilization)
+    const precision_t baumgarte = 0.2F / m_timestep;
+    constexpr precision_t unbounded = math::infinity();
+
+    auto is_frozen = [this](const object_t* o)
+    {
+        auto shape = reinterpret_cast<const shape_t*>(o);
+        return (shape >= m_dynamic.data()) && (shape < m_dynamic.data() + m_dynamic.size()) && m_frozen[shape - m_dynamic.data()];
+    };
+    auto cross = [](vec2 u, vec2 v) { return mat2 {u, v}.determinant(); };
+
+    m_rows.clear();
+    for (const auto& joint : m_joints)
+    {
+        object_t* a = joint.a;
+        object_t* b = joint.b ? joint.b : &m_ground;
+        if (is_frozen(a) || is_frozen(b)) continue;
+
+        precision_t sin_a, cos_a, sin_b, cos_b;
+        math::fast::sin_cos(a->transform.orientation, sin_a, cos_a);
+        math::fast::sin_cos(b->transform.orientation, sin_b, cos_b);
+        vec2 ra = joint.anchor_a.rotate(sin_a, cos_a);
+        vec2 rb = joint.anchor_b.rotate(sin_b, cos_b);
+        vec2 d = (b->transform.position + rb) - (a->transform.position + ra);
+        precision_t angle = b->transform.orientation - a->transform.orientation - joint.reference;
+
+        // Angular rows have no linear part, [error] is the position error the row must remove
+        auto row = [&](vec2 normal, precision_t ca, precision_t cb, precision_t error, precision_t lower, precision_t upper)
+        {
+            precision_t k = (a->body.i_mass + b->body.i_mass) * normal.lengthSq()
+                          + (a->body.i_moment_inertia) * ca * ca + (b->body.i_moment_inertia) * cb * cb;
+            if (k <= 0.0F) return;
+            m_rows.push_back({a, b, normal, ca, cb, 1.0F / k, error * baumgarte, lower, upper, 0.0F});
+        };
+        auto point = [&]()
+        {
+            row({1.0F, 0.0F}, ra.y, -rb.y, d.x, -unbounded, unbounded);
+            row({0.0F, 1.0F}, -ra.x, rb.x, d.y, -unbounded, unbounded);
+        };
+        auto limits = [&](vec2 normal, precision_t ca, precision_t cb, precision_t value)
+        {
+            if (!joint.limit) return;
+            if (value <= joint.lower) row(normal, ca, cb, value - joint.lower, 0.0F, unbounded);
+            else if (value >= joint.upper) row(normal, ca, cb, value - joint.upper, -unbounded, 0.0F);
+        };
+
+        switch (joint.type)
+        {
+
+        case joint_distance:
+        {
+            precision_t length = d.length();
+            if (length < math::epsilon()) break;
+            vec2 n = d / length;
+            row(n, -cross(ra, n), cross(rb, n), length - joint.length, -unbounded, unbounded);
+            break;
+        }
+
+        case joint_revolute:
+            point();
+            limits({0.0F, 0.0F}, -1.0F, 1.0F, angle);
+            break;
+
+        case joint_prismatic:
+        {
+            // The axis turns with a, so the rows of a also depend on the separation of the anchors
+            vec2 axis = joint.axis.rotate(sin_a, cos_a);
+            vec2 perpendicular = axis.rotateCCW90();
+            row(perpendicular, -cross(d + ra, perpendicular), cross(rb, perpendicular), math::dot(perpendicular, d), -unbounded, unbounded);
+            row({0.0F, 0.0F}, -1.0F, 1.0F, angle, -unbounded, unbounded);
+            limits(axis, -cross(d + ra, axis), cross(rb, axis), math::dot(axis, d));
+            break;
+        }
+
+        case joint_weld:
+            point();
+            row({0.0F, 0.0F}, -1.0F, 1.0F, angle, -unbounded, unbounded);
+            break;
+
+        default:
+            assert(false);
+        }
+    }
+}
+
+void Physics2D::solve_rows()
+{
+    for (auto& row : m_rows)
+    {
+        object_t* a = row.a;
+        object_t* b = row.b;
+        precision_t speed = math::dot(row.normal, b->motion.velocity - a->motion.velocity)
+                          + row.ca * (a->motion.omega) + row.cb * (b->motion.omega);
+
+        // Clamp the total impulse of the step, not the increment, so limits can let go again
+        precision_t previous = row.impulse;
+        row.impulse = math::clamp(row.lower, row.upper, previous - row.mass * (speed + row.bias));
+        precision_t lambda = row.impulse - previous;
+
+        a->motion.velocity -= row.normal * ((a->body.i_mass) * lambda);
+        a->motion.omega += (a->body.i_moment_inertia) * row.ca * lambda;
+        b->motion.velocity += row.normal * ((b->body.i_mass) * lambda);
+        b->motion.omega += (b->body.i_moment_inertia) * row.cb * lambda;
+    }
+}
+
+void Physics2D::update_contact_events()
+{
+    // Identify pairs regardless of the order in which the colliders reported the objects
+    // Objects live in two different arrays, std::less gives a total order over their addresses
+    std::less<const object_t*> order;
+    auto less = [order](const contact_event_t& x, const contact_event_t& y)
+    {
+        return (x.a != y.a) ? order(x.a, y.a) : order(x.b, y.b);
+    };
+    for (auto& contact : m_contacts)
+    {
+        if (order(contact.b, contact.a))
+        {
+            std::swap(contact.a, contact.b);
+            contact.normal = -contact.normal;
+        }
+    }
+    std::sort(m_contacts.begin(), m_contacts.end(), less);
+
+    // Compounds report one manifold per pair of parts, merge them into a single contact
+    u32 unique = 0;
+    for (u32 i = 0; i < m_contacts.size(); ++i)
+    {
+        if (unique && (m_contacts[unique - 1].a == m_contacts[i].a) && (m_contacts[unique - 1].b == m_contacts[i].b))
+        {
+            m_contacts[unique - 1].impulse += m_contacts[i].impulse;
+            continue;
+        }
+        m_contacts[unique++] = m_contacts[i];
     }
+    m_contacts.resize(unique);
+
+    // Both lists are sorted, walk them together
+    m_events.clear();
+    u32 i = 0;
+    u32 j = 0;
+    while ((i < m_contacts.size()) || (j < m_previous_contacts.size()))
+    {
+        if ((j == m_previous_contacts.size()) || ((i < m_contacts.size()) && less(m_contacts[i], m_previous_contacts[j])))
+        {
+            m_events.push_back(m_contacts[i++]);
+            m_events.back().type = contact_begin;
+        }
+        else if ((i == m_contacts.size()) || less(m_previous_contacts[j], m_contacts[i]))
+        {
+            m_events.push_back(m_previous_contacts[j++]);
+            m_events.back().impulse = 0.0F;
+            m_events.back().type = contact_end;
+        }
+        else
+        {
+            m_events.push_back(m_contacts[i++]);
+            ++j;
+        }
+    }
+    std::swap(m_contacts, m_previous_contacts);
 }
 
-f32 Physics2D::interval() const
+precision_t Physics2D::interval() const
 {
     return m_timestep;
 }
@@ -526,16 +1212,149 @@ vec2& Physics2D::gravity()
     return m_gravity;
 }
 
+force_field_t* Physics2D::fields()
+{
+    return m_fields.data();
+}
+
+u32 Physics2D::fields_c() const
+{
+    return m_fields.size();
+}
+
+joint_t* Physics2D::joints()
+{
+    return m_joints.data();
+}
+
+u32 Physics2D::joints_c() const
+{
+    return m_joints.size();
+}
+
+u32& Physics2D::iterations()
+{
+    return m_iterations;
+}
+
+bool& Physics2D::speculative()
+{
+    return m_speculative;
+}
+
+void Physics2D::reserve_arena(std::size_t bytes)
+{
+    m_arenas[0].reserve(bytes);
+    m_arenas[1].reserve(bytes);
+}
+
+arena_stats_t Physics2D::arena_stats() const
+{
+    arena_stats_t a = m_arenas[0].stats();
+    arena_stats_t b = m_arenas[1].stats();
+    return {math::max(a.capacity, b.capacity), math::max(a.high_water, b.high_water), a.growths + b.growths};
+}
+
+void Physics2D::rebase(vec2 origin)
+{
+    if (m_recorder) m_recorder->rebase(origin);
+    for (auto& blob : m_dynamic) blob.o.transform.position -= origin;
+    for (auto& blob : m_static)  blob.o.transform.position -= origin;
+    for (auto& field : m_fields)
+    {
+        field.region.min -= origin;
+        field.region.max -= origin;
+        field.center -= origin;
+    }
+    for (auto& joint : m_joints)
+        if (!joint.b) joint.anchor_b -= origin;
+    m_origin += {f64(origin.x), f64(origin.y)};
+    m_static_dirty = true;
+}
+
+MATH_NAMESPACE::v2_t<f64> Physics2D::origin() const
+{
+    return m_origin;
+}
+
+void Physics2D::query(const aabb_t& box, query_callback_t callback, void* user)
+{
+    m_static_tree.query(box, [this, callback, user](u32 index)
+    {
+        callback(m_static[m_static_items[index]].o, user);
+    });
+    // Objects added since the last step are not in the tree yet, and frozen objects are never in it
+    m_dynamic_tree.query(box, [this, callback, user](u32 index)
+    {
+        callback(m_dynamic[m_active[index]].o, user);
+    });
+}
+
+const contact_event_t* Physics2D::contact_events() const
+{
+    return m_events.data();
+}
+
+u32 Physics2D::contact_events_c() const
+{
+    return m_events.size();
+}
+
+void Physics2D::record(TraceRecorder* recorder)
+{
+    assert(!recorder || recorder->is_open());
+    m_recorder = recorder;
+}
+
+void Physics2D::debug_draw(DebugDraw& buffer) const
+{
+    constexpr u32 contact_color = debug_color(255, 255, 0);
+    constexpr u32 field_color = debug_color(255, 0, 255, 128);
+    constexpr u32 joint_color = debug_color(0, 255, 255);
+    for (const auto& shape : m_static)
+        if (shape.o.type != removed) buffer.object(shape.o);
+    for (const auto& shape : m_dynamic) buffer.object(shape.o);
+    for (const auto& field : m_fields)
+    {
+        const aabb_t& r = field.region;
+        buffer.line(r.min, {r.max.x, r.min.y}, field_color);
+        buffer.line({r.max.x, r.min.y}, r.max, field_color);
+        buffer.line(r.max, {r.min.x, r.max.y}, field_color);
+        buffer.line({r.min.x, r.max.y}, r.min, field_color);
+        vec2 middle = (r.min + r.max) * 0.5F;
+        if (field.type == field_directional) buffer.arrow(middle, middle + field.direction * 50.0F, field_color);
+        else if (field.type != field_drag) buffer.point(field.center, field_color, 5.0F);
+    }
+    for (const auto& joint : m_joints)
+    {
+        const object_t* a = joint.a;
+        vec2 anchor_a = joint.anchor_a.rotate(a->transform.orientation) + a->transform.position;
+        vec2 anchor_b = joint.b ? joint.anchor_b.rotate(joint.b->transform.orientation) + joint.b->transform.position : joint.anchor_b;
+        buffer.line(a->transform.position, anchor_a, joint_color);
+        buffer.line(anchor_a, anchor_b, joint_color);
+        if (joint.b) buffer.line(anchor_b, joint.b->transform.position, joint_color);
+        buffer.point(anchor_a, joint_color, 4.0F);
+    }
+    // The contacts of the last step were moved to the previous list when the events were generated
+    for (const auto& contact : m_previous_contacts)
+    {
+        buffer.point(contact.point, contact_color, 4.0F);
+        buffer.line(contact.point, contact.point + contact.normal * 10.0F, contact_color);
+    }
+}
+
 void Physics2D::for_each_object(object_callback_t callback)
 {
     for (auto& blob : m_dynamic) callback(blob.o);
-    for (auto& blob : m_static)  callback(blob.o);
+    for (auto& blob : m_static)
+        if (blob.o.type != removed) callback(blob.o);
 }
 
 void Physics2D::for_each_object(const_object_callback_t callback) const
 {
     for (auto& blob : m_dynamic) callback(blob.o);
-    for (auto& blob : m_static)  callback(blob.o);
+    for (auto& blob : m_static)
+        if (blob.o.type != removed) callback(blob.o);
 }
 
 }
@@ -3,19 +3,44 @@
 
 #include "Configuration.hpp"
 #include "PhysicsTypes.hpp"
+#include "AABBTree.hpp"
+#include "Arena.hpp"
+#include "Handles.hpp"
 #include "Mesh.hpp"
 #include "Matrix2.hpp"
 #include "Vector2.hpp"
 #include "Math.hpp"
 
 #include <vector>
+#include <deque>
 
 namespace PHYSICS_NAMESPACE
 {
 
+// Runs the narrowphase between two objects, which don't need to belong to a world
+// Calls callback(manifold, user) once per pair of convex parts in contact
+using manifold_callback_t = void(*)(manifold_t&, void*);
+void collide(object_t* a, object_t* b, manifold_callback_t callback, void* user);
+
+// Makes a joint from anchors given in world space, in the current placement of the objects
+// Both anchors are usually the same point, except for distance joints. [axis] is only used by prismatic joints
+joint_t make_joint(u32 type, object_t* a, object_t* b, vec2 anchor_a, vec2 anchor_b, vec2 axis = {1.0F, 0.0F});
+
+class Scene;
+class RegionStreamer;
+class DebugDraw;
+class TraceRecorder;
+class TracePlayer;
+
 class Physics2D final
 {
 
+    // Scenes, streamed regions and traces build and read the object arrays directly, see Scene.hpp, Streaming.hpp and Trace.hpp
+    friend class Scene;
+    friend class RegionStreamer;
+    friend class TraceRecorder;
+    friend class TracePlayer;
+
     // Prevent object slicing
     // Unions can be used here because all objects are trivially constructible
     union shape_t
@@ -23,36 +48,202 @@ class Physics2D final
         object_t o;
         circle_t c;
         polygon_t p;
+        compound_t m;
     };
 
-    const f32 m_timestep;
-    const f32 m_half_timestep;
+    // Storage for the children of compound bodies
+    // Kept in a deque so that the addresses handed to [compound_t] remain valid
+    struct compound_data_t
+    {
+        std::vector<child_t> children;
+        AABBTree tree;
+    };
+
+    const precision_t m_timestep;
+    const precision_t m_half_timestep;
 
     const std::size_t m_max_objects;
     vec2 m_gravity;
 
+    // Floating origin, positions are stored relative to it
+    // Always kept in double precision so it stays exact when the engine is built with f32
+    MATH_NAMESPACE::v2_t<f64> m_origin;
+
     std::vector<shape_t> m_dynamic;
     std::vector<shape_t> m_static;
+    // Static objects removed by the streaming of regions stay in place as [removed] tombstones, so that the
+    // others never move, and their slots are reused by the next static objects
+    static constexpr u8 removed = object_type_count;
+    std::vector<u32> m_static_free;
+    std::deque<compound_data_t> m_compounds;
+
+    // Frozen dynamic objects are left out of the step entirely, they keep their state until thawed
+    // Used by the streaming of regions, for the objects that are outside of the loaded area
+    std::vector<u8> m_frozen;
+
+    // Scratch memory of the steps, the arrays below are rebuilt by every step and live in one of two arenas
+    // Steps alternate between the arenas, so the results of the last step (contacts and events) survive until the next one
+    // Once the arenas have seen the busiest step, stepping doesn't touch the heap anymore
+    FrameArena m_arenas[2];
+    u32 m_frame;
+
+    FrameArray<u32> m_active; // Dynamic objects that are not frozen, the dynamic tree refers to this list
+
+    // Broadphase
+    FrameArray<aabb_t> m_dynamic_boxes;
+    std::vector<aabb_t> m_static_boxes;
+    std::vector<u32> m_static_items; // Static object of every box, tombstones are left out of the tree
+    AABBTree m_dynamic_tree;
+    AABBTree m_static_tree;
+    bool m_static_dirty;
+
+    // Narrowphase results of the current step, resolved once every pair has been found
+    FrameArray<manifold_t> m_manifolds;
+
+    // Contact events, touching pairs are sorted so that consecutive steps can be compared
+    FrameArray<contact_event_t> m_contacts;
+    FrameArray<contact_event_t> m_previous_contacts;
+    FrameArray<contact_event_t> m_events;
+
+    // Force fields, each one is applied to the dynamic objects the broadphase finds in its region
+    HandleArray<force_field_t> m_fields;
+    FrameArray<vec2> m_accelerations; // Sum of the fields acting on every dynamic object during the step
+    // Objects found inside the field being applied, their state is gathered into arrays so the field is evaluated in straight loops
+    FrameArray<u32> m_field_targets;
+    FrameArray<precision_t> m_field_x;
+    FrameArray<precision_t> m_field_y;
+    FrameArray<precision_t> m_field_w;
+
+    struct object_pair_t
+    {
+        const object_t* first;
+        const object_t* second;
+    };
+
+    // Joints are expanded into scalar rows every step, rows and contacts are then solved together for a
+    // number of iterations (sequential impulses), the impulse of each row is accumulated to enforce limits
+    struct row_t
+    {
+        object_t* a;
+        object_t* b;
+        vec2 normal;       // Linear part of the jacobian for b, a gets the opposite
+        precision_t ca;    // Angular part of the jacobian for a and b
+        precision_t cb;
+        precision_t mass;  // Inverse of the effective mass along the row
+        precision_t bias;  // Velocity that removes the position error
+        precision_t lower; // Bounds of the accumulated impulse
+        precision_t upper;
+        precision_t impulse;
+    };
+
+    HandleArray<joint_t> m_joints;
+    FrameArray<object_pair_t> m_connected; // Sorted pairs of joined objects that don't collide
+    FrameArray<row_t> m_rows;
+    FrameArray<precision_t> m_impulses; // Normal impulse applied to every manifold over the iterations
+    object_t m_ground; // Stands in for the world in joints attached to it
+    u32 m_iterations;
+    bool m_speculative;
+
+    TraceRecorder* m_recorder;
+
+    shape_t* add_static(const shape_t& shape);
+    // Turns a static object into a tombstone, [forget_removed] must be called before the next step
+    void remove_static(u32 index);
+    // Drops the contacts, events and joints that refer to tombstones, they would otherwise name the next objects in their slots
+    void forget_removed();
+
+    void begin_frame();
+    void update_static_tree();
+    void apply_fields();
+    void update_connected();
+    bool connected(const object_t* a, const object_t* b) const;
+    void prepare_joints();
+    void solve_rows();
+    void update_contact_events();
 
 public:
 
     using const_object_callback_t = void(*)(const object_t&);
     using object_callback_t = void(*)(object_t&);
+    using query_callback_t = void(*)(object_t&, void*);
 
     Physics2D() = delete;
-    explicit Physics2D(std::size_t max_objects, f32 timestep = 0.01F);
-
-    circle_t* add(const transform_t&, const material_t&, const motion_t&, f32 density, f32 radius);
-    polygon_t* add(const transform_t&, const material_t&, const motion_t&, f32 density, vec2* positions, vec2* normals, u32 vertices_c);
+    explicit Physics2D(std::size_t max_objects, precision_t timestep = 0.01F);
+
+    circle_t* add(const transform_t&, const material_t&, const motion_t&, precision_t density, precision_t radius);
+    polygon_t* add(const transform_t&, const material_t&, const motion_t&, precision_t density, vec2* positions, vec2* normals, u32 vertices_c);
+    compound_t* add(const transform_t&, const material_t&, const motion_t&, const child_t* children, u32 children_c);
+
+    // Fields stay in the world until removed, see [force_field_t]
+    // The handle stays valid until the field is removed, the field itself is reached through [field]
+    handle_t<force_field_t> add(const force_field_t& field);
+    // Removing a field twice does nothing
+    void remove(handle_t<force_field_t> field);
+    // Null once the field was removed, the address is only valid until the next field is added or removed
+    force_field_t* field(handle_t<force_field_t> field);
+
+    // Joints refer to their objects by address, objects never move once added
+    // The handle stays valid until the joint is removed, the joint itself is reached through [joint]
+    handle_t<joint_t> add(const joint_t& joint);
+    // Does nothing when the joint was already removed, also by the streaming of the regions of its objects
+    void remove(handle_t<joint_t> joint);
+    // Null once the joint was removed, the address is only valid until the next joint is added or removed
+    joint_t* joint(handle_t<joint_t> joint);
 
     void simulate();
 
-    f32 interval() const;
+    precision_t interval() const;
     u32 entities() const;
     u32 capacity() const;
     
     vec2& gravity();
 
+    // Every field, packed in no particular order
+    force_field_t* fields();
+    u32 fields_c() const;
+
+    // Every joint, packed in no particular order
+    joint_t* joints();
+    u32 joints_c() const;
+
+    // Number of passes over the joints and contacts in every step, more iterations make joints stiffer
+    u32& iterations();
+
+    // Speculative contacts: pairs closer than the distance they close in one step get a contact before they touch,
+    // which only removes the part of the approaching speed that would make them overlap by the end of the step
+    // Fast objects then stop at the surface instead of tunnelling or being pushed back out, which keeps large
+    // timesteps stable at a fraction of the cost of continuous detection. Disabled by default
+    // Rotation is not taken into account, and bounces happen in the step after the objects meet
+    bool& speculative();
+
+    // Sizes both step arenas for [bytes] of scratch memory, so that even the first steps don't allocate
+    // The high water mark reported by [arena_stats] after a representative run is a good value
+    void reserve_arena(std::size_t bytes);
+    // Largest capacity and high water mark of the two arenas, and how many times they had to grow
+    arena_stats_t arena_stats() const;
+
+    // Shifts every object so that [origin] (relative to the current origin) becomes the new origin
+    // Keeping the origin close to the area of interest preserves f32 accuracy in large worlds
+    void rebase(vec2 origin);
+    MATH_NAMESPACE::v2_t<f64> origin() const;
+
+    // Calls callback(object, user) for every object whose bounding box overlaps [box]
+    // Objects are tested against the boxes computed at the beginning of the last step
+    // Doesn't modify the world, so it can be called from several threads at once
+    void query(const aabb_t& box, query_callback_t callback, void* user);
+
+    // Begin, persist and end events generated by the last step, one per pair of touching objects
+    // The buffer is reused and stays valid until the next call to simulate
+    const contact_event_t* contact_events() const;
+    u32 contact_events_c() const;
+
+    // Records every object added, every write to the dynamic objects and every step into [recorder]
+    // The recorder must be open, passing nullptr stops recording
+    void record(TraceRecorder* recorder);
+
+    // Appends every object, the field regions, the joints and the contacts of the last step to a debug draw buffer
+    void debug_draw(DebugDraw& buffer) const;
+
     void for_each_object(object_callback_t callback);
     void for_each_object(const_object_callback_t callback) const;
 
@@ -0,0 +1,272 @@
+#include "PhysicsC.h"
+#include "Physics.hpp"
+#include "Mesh.hpp"
+
+#include <new>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <type_traits>
+
+using namespace PHYSICS_NAMESPACE;
+
+static_assert(sizeof(p2d_real_t) == sizeof(precision_t), "The C interface must be built with the precision of the engine");
+static_assert(sizeof(p2d_vec2_t) == sizeof(vec2), "Vectors are copied as they are");
+
+/// C interface implementation
+
+struct p2d_world_t
+{
+    Physics2D world;
+    std::vector<object_t*> bodies; // Indexed by handle, the engine keeps its objects in place
+    std::unordered_map<const object_t*, p2d_body_t> handles;
+    std::deque<gfx::Mesh> meshes;  // Polygons point at the vertices, a deque never moves them
+    u32 static_c;
+
+    p2d_world_t(u32 max_objects, precision_t timestep)
+        : world(max_objects, timestep), static_c {0}
+    {
+        bodies.reserve(2 * max_objects);
+    }
+};
+
+// Runs fn() and turns what it throws into an error, exceptions must not cross into C
+template <typename F>
+static p2d_result_t guard(F fn)
+{
+    try
+    {
+        return fn();
+    }
+    catch (const std::bad_alloc&)
+    {
+        return P2D_ERROR_MEMORY;
+    }
+    catch (...)
+    {
+        return P2D_ERROR_INTERNAL;
+    }
+}
+
+// Calls fn(object, element) for every body of a bulk transfer, once all of the handles were checked
+template <typename T, typename F>
+static p2d_result_t for_each_element(const p2d_world_t* w, const p2d_body_t* bodies, p2d_body_t first, u32 count, T* elements, std::size_t stride, F fn)
+{
+    u32 bodies_c = w->bodies.size();
+    if (bodies)
+    {
+        for (u32 i = 0; i < count; ++i) if (bodies[i] >= bodies_c) return P2D_ERROR_ARGUMENT;
+    }
+    else if ((first > bodies_c) || (count > bodies_c - first))
+    {
+        return P2D_ERROR_ARGUMENT;
+    }
+
+    using byte_t = typename std::conditional<std::is_const<T>::value, const u8, u8>::type;
+    auto bytes = reinterpret_cast<byte_t*>(elements);
+    for (u32 i = 0; i < count; ++i)
+    {
+        p2d_body_t body = bodies ? bodies[i] : first + i;
+        fn(*w->bodies[body], reinterpret_cast<T*>(bytes + i * stride));
+    }
+    return P2D_OK;
+}
+
+static bool is_valid(const p2d_world_t* w, const p2d_body_def_t& def)
+{
+    // Written so that NaN fails every test, an infinite density is how static bodies are asked for
+    if (!(def.density > 0.0F)) return false;
+    if (def.shape == P2D_CIRCLE) return (def.radius > 0.0F) && (def.radius < math::infinity());
+    if (def.shape == P2D_POLYGON) return def.mesh < w->meshes.size();
+    return false;
+}
+
+static bool is_static(const object_t& o)
+{
+    return o.body.i_mass == 0.0F;
+}
+
+extern "C"
+{
+
+uint32_t p2d_precision(void)
+{
+    return sizeof(p2d_real_t);
+}
+
+p2d_world_t* p2d_create(uint32_t max_objects, p2d_real_t timestep)
+{
+    // Exceptions must not cross into C, the constructor allocates too
+    try
+    {
+        return new p2d_world_t(max_objects, timestep);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void p2d_destroy(p2d_world_t* world)
+{
+    delete world;
+}
+
+void p2d_set_gravity(p2d_world_t* world, p2d_real_t x, p2d_real_t y)
+{
+    world->world.gravity() = {x, y};
+}
+
+void p2d_set_iterations(p2d_world_t* world, uint32_t iterations)
+{
+    world->world.iterations() = iterations;
+}
+
+void p2d_set_speculative(p2d_world_t* world, int enabled)
+{
+    world->world.speculative() = (enabled != 0);
+}
+
+p2d_result_t p2d_add_mesh(p2d_world_t* world, const p2d_vec2_t* points, uint32_t points_c, p2d_mesh_t* mesh)
+{
+    return guard([&]
+    {
+        auto first = reinterpret_cast<const vec2*>(points);
+        std::vector<vec2> hull = gfx::Mesh::hull({first, first + points_c});
+        if (hull.size() < 3) return P2D_ERROR_ARGUMENT;
+        world->meshes.emplace_back(std::move(hull));
+        *mesh = world->meshes.size() - 1;
+        return P2D_OK;
+    });
+}
+
+p2d_result_t p2d_add_bodies(p2d_world_t* world, const p2d_body_def_t* defs, uint32_t defs_c, p2d_body_t* bodies)
+{
+    Physics2D& w = world->world;
+    u32 static_c = 0;
+    for (u32 i = 0; i < defs_c; ++i)
+    {
+        if (!is_valid(world, defs[i])) return P2D_ERROR_ARGUMENT;
+        if (defs[i].density == math::infinity()) ++static_c;
+    }
+    if ((static_c > w.capacity() - world->static_c) || (defs_c - static_c > w.capacity() - w.entities())) return P2D_ERROR_FULL;
+
+    return guard([&]
+    {
+        for (u32 i = 0; i < defs_c; ++i)
+        {
+            const p2d_body_def_t& def = defs[i];
+            bool fixed = def.density == math::infinity();
+
+            transform_t transform = {{def.x, def.y}, def.orientation, 1.0F};
+            material_t material = {def.restitution, def.static_friction, def.dynamic_friction};
+            motion_t motion = {};
+            motion.velocity = {def.vx, def.vy};
+            motion.omega = def.omega;
+
+            object_t* o;
+            if (def.shape == P2D_CIRCLE)
+            {
+                o = w.add(transform, material, motion, def.density, def.radius);
+            }
+            else
+            {
+                gfx::Mesh& mesh = world->meshes[def.mesh];
+                o = w.add(transform, material, motion, def.density, mesh.positions().data(), mesh.normals().data(), mesh.vertices());
+            }
+            if (fixed) ++world->static_c;
+
+            // Reserved for all of the bodies the world can hold, only the map can still fail to allocate
+            p2d_body_t handle = world->bodies.size();
+            world->bodies.push_back(o);
+            if (bodies) bodies[i] = handle;
+            world->handles[o] = handle;
+        }
+        return P2D_OK;
+    });
+}
+
+uint32_t p2d_bodies_c(const p2d_world_t* world)
+{
+    return world->bodies.size();
+}
+
+p2d_result_t p2d_step(p2d_world_t* world, uint32_t steps)
+{
+    return guard([&]
+    {
+        for (u32 i = 0; i < steps; ++i) world->world.simulate();
+        return P2D_OK;
+    });
+}
+
+p2d_result_t p2d_read_transforms(const p2d_world_t* world, const p2d_body_t* bodies, p2d_body_t first, uint32_t count, void* out, size_t stride)
+{
+    return for_each_element(world, bodies, first, count, static_cast<p2d_real_t*>(out), stride, [](const object_t& o, p2d_real_t* e)
+    {
+        e[0] = o.transform.position.x;
+        e[1] = o.transform.position.y;
+        e[2] = o.transform.orientation;
+    });
+}
+
+p2d_result_t p2d_write_transforms(p2d_world_t* world, const p2d_body_t* bodies, p2d_body_t first, uint32_t count, const void* in, size_t stride)
+{
+    // The static tree is only rebuilt when static objects are added, so they can't be moved
+    return for_each_element(world, bodies, first, count, static_cast<const p2d_real_t*>(in), stride, [](object_t& o, const p2d_real_t* e)
+    {
+        if (is_static(o)) return;
+        o.transform.position = {e[0], e[1]};
+        o.transform.orientation = e[2];
+    });
+}
+
+p2d_result_t p2d_read_velocities(const p2d_world_t* world, const p2d_body_t* bodies, p2d_body_t first, uint32_t count, void* out, size_t stride)
+{
+    return for_each_element(world, bodies, first, count, static_cast<p2d_real_t*>(out), stride, [](const object_t& o, p2d_real_t* e)
+    {
+        e[0] = o.motion.velocity.x;
+        e[1] = o.motion.velocity.y;
+        e[2] = o.motion.omega;
+    });
+}
+
+p2d_result_t p2d_write_velocities(p2d_world_t* world, const p2d_body_t* bodies, p2d_body_t first, uint32_t count, const void* in, size_t stride)
+{
+    return for_each_element(world, bodies, first, count, static_cast<const p2d_real_t*>(in), stride, [](object_t& o, const p2d_real_t* e)
+    {
+        if (is_static(o)) return;
+        o.motion.velocity = {e[0], e[1]};
+        o.motion.omega = e[2];
+    });
+}
+
+p2d_result_t p2d_apply_forces(p2d_world_t* world, const p2d_body_t* bodies, p2d_body_t first, uint32_t count, const void* in, size_t stride)
+{
+    return for_each_element(world, bodies, first, count, static_cast<const p2d_real_t*>(in), stride, [](object_t& o, const p2d_real_t* e)
+    {
+        o.motion.force += {e[0], e[1]};
+        o.motion.torque += e[2];
+    });
+}
+
+uint32_t p2d_contacts(const p2d_world_t* world, p2d_contact_t* out, uint32_t capacity)
+{
+    const contact_event_t* events = world->world.contact_events();
+    u32 events_c = world->world.contact_events_c();
+    for (u32 i = 0; i < math::min(events_c, capacity); ++i)
+    {
+        const contact_event_t& event = events[i];
+        auto a = world->handles.find(event.a);
+        auto b = world->handles.find(event.b);
+        out[i].a = (a != world->handles.end()) ? a->second : P2D_INVALID;
+        out[i].b = (b != world->handles.end()) ? b->second : P2D_INVALID;
+        out[i].normal = {event.normal.x, event.normal.y};
+        out[i].point = {event.point.x, event.point.y};
+        out[i].impulse = event.impulse;
+        out[i].type = event.type;
+    }
+    return events_c;
+}
+
+}
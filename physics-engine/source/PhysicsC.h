@@ -0,0 +1,148 @@
+#ifndef PHYSICS_C_H
+#define PHYSICS_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// C interface
+/// Flat functions over Physics2D for C programs and other runtimes, built as a shared library (see build_dll.bat)
+/// Bodies are referred to by handles, the order in which they were added starting at zero
+/// Transforms, velocities and forces move in bulk through arrays owned by the caller, so a binding crosses the
+/// interface once per step instead of once per body
+/// Functions that can fail return a [p2d_result_t], no C++ exception ever crosses the interface
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Same as precision_t, a library built with PHYSICS_DOUBLE_PRECISION must be used with the same define
+// Bindings that can't see the define check [p2d_precision] after loading the library
+#ifdef PHYSICS_DOUBLE_PRECISION
+typedef double p2d_real_t;
+#else
+typedef float p2d_real_t;
+#endif
+
+typedef struct p2d_world_t p2d_world_t;
+typedef uint32_t p2d_body_t;
+typedef uint32_t p2d_mesh_t;
+
+#define P2D_INVALID 0xFFFFFFFFu
+
+typedef enum
+{
+
+    P2D_OK,
+    P2D_ERROR_ARGUMENT, // A handle, a definition or the points of a mesh are invalid, nothing was changed
+    P2D_ERROR_FULL,     // The world can't take that many more bodies, nothing was changed
+    P2D_ERROR_MEMORY,   // An allocation failed, see the function for what was done before
+    P2D_ERROR_INTERNAL  // The engine failed in any other way
+
+} p2d_result_t;
+
+typedef enum
+{
+
+    P2D_CIRCLE,
+    P2D_POLYGON
+
+} p2d_shape_t;
+
+typedef enum
+{
+
+    P2D_CONTACT_BEGIN,
+    P2D_CONTACT_PERSIST,
+    P2D_CONTACT_END
+
+} p2d_contact_type_t;
+
+typedef struct
+{
+
+    p2d_real_t x;
+    p2d_real_t y;
+
+} p2d_vec2_t;
+
+typedef struct
+{
+
+    uint32_t shape;          // See [p2d_shape_t], other values are rejected
+    p2d_real_t x, y;         // Center of mass, in world space
+    p2d_real_t orientation;  // Radians
+    p2d_real_t vx, vy;
+    p2d_real_t omega;
+    p2d_real_t restitution;
+    p2d_real_t static_friction;
+    p2d_real_t dynamic_friction;
+    p2d_real_t density;      // Positive, INFINITY makes the body static
+    p2d_real_t radius;       // Circles only, positive and finite
+    p2d_mesh_t mesh;         // Polygons only, see [p2d_add_mesh]
+
+} p2d_body_def_t;
+
+typedef struct
+{
+
+    p2d_body_t a;
+    p2d_body_t b;
+    p2d_vec2_t normal;       // Points from a to b
+    p2d_vec2_t point;
+    p2d_real_t impulse;
+    uint32_t type;           // See [p2d_contact_type_t]
+
+} p2d_contact_t;
+
+// Size in bytes of p2d_real_t in the library
+uint32_t p2d_precision(void);
+
+// [max_objects] bounds the dynamic and the static bodies separately
+// Returns NULL when the world can't be allocated
+p2d_world_t* p2d_create(uint32_t max_objects, p2d_real_t timestep);
+void p2d_destroy(p2d_world_t* world);
+
+void p2d_set_gravity(p2d_world_t* world, p2d_real_t x, p2d_real_t y);
+void p2d_set_iterations(p2d_world_t* world, uint32_t iterations);
+void p2d_set_speculative(p2d_world_t* world, int enabled);
+
+// Builds the convex hull of [points_c] points and writes its handle to [mesh], the world owns the vertices
+// Vertices are moved so that the center of mass of the hull is at (0, 0), bodies are positioned by it
+// P2D_ERROR_ARGUMENT when the points don't make a polygon
+p2d_result_t p2d_add_mesh(p2d_world_t* world, const p2d_vec2_t* points, uint32_t points_c, p2d_mesh_t* mesh);
+
+// Adds [defs_c] bodies and writes their handles to [bodies] (may be NULL), handles are consecutive
+// Every definition is checked first, no body is added when one of them is invalid or the world is too full
+// On P2D_ERROR_MEMORY the bodies added before the failure stay, [p2d_bodies_c] tells how many there are
+p2d_result_t p2d_add_bodies(p2d_world_t* world, const p2d_body_def_t* defs, uint32_t defs_c, p2d_body_t* bodies);
+uint32_t p2d_bodies_c(const p2d_world_t* world);
+
+// On failure the step that failed is left half done, the world should be destroyed
+p2d_result_t p2d_step(p2d_world_t* world, uint32_t steps);
+
+/// Bulk transfers
+/// [bodies] lists the handles to use, or NULL for the handles first .. first + count - 1
+/// Each element holds three consecutive p2d_real_t and starts [stride] bytes after the previous one,
+/// so the values can be written straight into the vertex or entity arrays of the caller
+/// Every handle is checked first, P2D_ERROR_ARGUMENT when one isn't a body of the world and nothing is transferred
+
+// x, y, orientation
+p2d_result_t p2d_read_transforms(const p2d_world_t* world, const p2d_body_t* bodies, p2d_body_t first, uint32_t count, void* out, size_t stride);
+// Static bodies are skipped and keep their transform, the static tree is only rebuilt when static bodies are added
+p2d_result_t p2d_write_transforms(p2d_world_t* world, const p2d_body_t* bodies, p2d_body_t first, uint32_t count, const void* in, size_t stride);
+// vx, vy, omega
+p2d_result_t p2d_read_velocities(const p2d_world_t* world, const p2d_body_t* bodies, p2d_body_t first, uint32_t count, void* out, size_t stride);
+// Static bodies are skipped, they never move
+p2d_result_t p2d_write_velocities(p2d_world_t* world, const p2d_body_t* bodies, p2d_body_t first, uint32_t count, const void* in, size_t stride);
+// fx, fy, torque, added to what the bodies already received and consumed by the next step
+p2d_result_t p2d_apply_forces(p2d_world_t* world, const p2d_body_t* bodies, p2d_body_t first, uint32_t count, const void* in, size_t stride);
+
+// Copies up to [capacity] contact events of the last step to [out], returns the number of events available
+// A body whose handle couldn't be recorded because an allocation failed in [p2d_add_bodies] is reported as P2D_INVALID
+uint32_t p2d_contacts(const p2d_world_t* world, p2d_contact_t* out, uint32_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PHYSICS_C_H
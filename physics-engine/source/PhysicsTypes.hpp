@@ -7,34 +7,53 @@
 namespace PHYSICS_NAMESPACE
 {
 
+class AABBTree;
+
+// Object type enumeration is used to index the dispatch function in the collision vtable
+enum object_type_t
+{
+    circle,
+    polygon,
+    compound,
+    object_type_count
+};
+
+struct aabb_t
+{
+    vec2 min; // Lower bound in world space
+    vec2 max; // Upper bound in world space
+};
+
 struct material_t
 {
-    f32 restitution;  // Represents the ellasticity of an object
-    f32 static_coef;  // Static friction coefficient is used to determine friction when resting
-    f32 dynamic_coef; // Dynamic friction coefficient is used to determine friction when in motion
+    precision_t restitution;  // Represents the ellasticity of an object
+    precision_t static_coef;  // Static friction coefficient is used to determine friction when resting
+    precision_t dynamic_coef; // Dynamic friction coefficient is used to determine friction when in motion
 };
 
 struct body_t
 {
-    f32 mass;
-    f32 i_mass;           // The inverse of the mass
-    f32 moment_inertia;   // Moment of inertia is the difficulty to rotate an object
-    f32 i_moment_inertia; // The inverse moment of inertia
+    precision_t mass;
+    precision_t i_mass;           // The inverse of the mass
+    precision_t moment_inertia;   // Moment of inertia is the difficulty to rotate an object
+    precision_t i_moment_inertia; // The inverse moment of inertia
 };
 
 struct transform_t
 {
     vec2 position;   // Translation in world space
-    f32 orientation; // Rotation in world space
-    f32 scale;       // Scale in world space (TODO: actually use it)
+    precision_t orientation; // Rotation in world space
+    precision_t scale;       // Scale in world space (TODO: actually use it)
 };
 
 struct motion_t
 {
     vec2 velocity; // Linear velocity
     vec2 force;    // Linear force
-    f32 omega;     // Angular velocity
-    f32 torque;    // Angular force
+    precision_t omega;     // Angular velocity
+    precision_t torque;    // Angular force
+    precision_t linear_damping;  // Fraction of the linear velocity lost per second, zero keeps it
+    precision_t angular_damping; // Fraction of the angular velocity lost per second
 };
 
 struct object_t
@@ -48,7 +67,7 @@ struct object_t
 
 struct circle_t : public object_t
 {
-    f32 radius;
+    precision_t radius;
 };
 
 struct polygon_t : public object_t
@@ -58,16 +77,97 @@ struct polygon_t : public object_t
     u32 vertices_c;  // The number of elements in the positions and normals vector
 };
 
+struct child_t
+{
+    u8 type;         // Circle or Polygon -- compounds can't be nested
+    vec2 offset;     // Position relative to the center of mass of the compound
+    precision_t orientation; // Rotation relative to the compound
+    precision_t density;     // Used to compute the mass of the compound
+    precision_t radius;      // Only used by circles
+    vec2* positions; // Only used by polygons, see [polygon_t]
+    vec2* normals;
+    u32 vertices_c;
+};
+
+struct compound_t : public object_t
+{
+    child_t* children;    // The convex shapes that make up this body (owned by the engine)
+    u32 children_c;       // The number of elements in the children vector
+    const AABBTree* tree; // Bounding volume hierarchy over the children in model space
+};
+
 struct manifold_t
 {
     object_t* a;
     object_t* b;
     vec2 normal; // The collision normal represents the direction in which the least amount of penetration occurred
-    f32 penetration; // The penetration value indicates by how much the two bodies are colliding
+    precision_t penetration; // The penetration value indicates by how much the two bodies are colliding
     u32 contacts_c; // Indicates how many contact points there are between the objects
     vec2 contacts[2]; // The points where the two objects are colliding
 };
 
+// Force fields accelerate the dynamic objects whose bounding box overlaps their region
+// Strengths are accelerations, so the same field moves light and heavy objects alike, like gravity
+enum force_field_type_t
+{
+    field_radial,      // Along the direction from the center, negative strengths attract
+    field_directional, // Along [direction], uniform inside the region
+    field_vortex,      // Counter-clockwise around the center, negative strengths turn clockwise
+    field_drag         // Against the velocity, [strength] is the fraction of velocity lost per second
+};
+
+struct force_field_t
+{
+    u32 type;       // See [force_field_type_t]
+    aabb_t region;  // Objects outside of it are not affected
+    vec2 center;    // Only used by radial and vortex fields
+    vec2 direction; // Only used by directional fields, should be normalized
+    precision_t strength;
+    precision_t falloff; // Distance from the center at which radial and vortex fields fade out, zero for no falloff
+};
+
+// Joints keep two objects together, each one is solved as a few scalar constraint rows
+enum joint_type_t
+{
+    joint_distance,  // Keeps the anchors at a fixed distance, the objects rotate freely
+    joint_revolute,  // Pins the anchors together, the objects rotate around them
+    joint_prismatic, // The anchor of b slides along an axis of a, the objects don't rotate relative to each other
+    joint_weld       // Pins the anchors together and locks the relative rotation
+};
+
+struct joint_t
+{
+    u32 type;      // See [joint_type_t]
+    object_t* a;
+    object_t* b;   // Null attaches [a] to the world, [anchor_b] is then in world space
+    vec2 anchor_a; // Model space of a
+    vec2 anchor_b; // Model space of b
+    vec2 axis;     // Prismatic only, model space of a, normalized
+    precision_t length;    // Distance only, rest length
+    precision_t reference; // Orientation of b minus orientation of a when the joint was made
+    precision_t lower;     // Revolute angle relative to [reference], or prismatic translation along the axis
+    precision_t upper;
+    u32 limit;     // Non zero keeps the angle or translation between [lower] and [upper]
+    u32 collide;   // Non zero lets the two objects collide with each other
+};
+
+enum contact_event_type_t
+{
+    contact_begin,   // The objects started touching during this step
+    contact_persist, // The objects were already touching during the previous step
+    contact_end      // The objects stopped touching, the normal and point are the last ones seen
+};
+
+struct contact_event_t
+{
+    object_t* a;
+    object_t* b;
+    vec2 normal;         // Points from a to b
+    vec2 point;          // One of the contact points, in world space
+    precision_t impulse; // Magnitude of the normal impulse applied during the step
+    u32 type;            // See [contact_event_type_t]
+};
+
 }
 
 #endif // PHYSICS_TYPES_HPP
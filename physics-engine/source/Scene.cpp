@@ -0,0 +1,369 @@
+#include "Scene.hpp"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <vector>
+#include <fstream>
+#include <unordered_map>
+
+namespace PHYSICS_NAMESPACE
+{
+
+/// Scene class implementation
+
+Scene::Scene()
+    : m_data {nullptr}, m_size {0}, m_file {nullptr}, m_mapping {nullptr}
+{
+}
+
+Scene::~Scene()
+{
+    close();
+}
+
+const scene_header_t& Scene::header() const
+{
+    return *reinterpret_cast<const scene_header_t*>(m_data);
+}
+
+bool Scene::open(const char* path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    HANDLE mapping = nullptr;
+    void* view = nullptr;
+    if (GetFileSizeEx(file, &size) && (size.QuadPart > 0))
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping)
+        view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view)
+    {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    m_file = file;
+    m_mapping = mapping;
+    m_data = static_cast<const u8*>(view);
+    m_size = std::size_t(size.QuadPart);
+#else
+    int file = ::open(path, O_RDONLY);
+    if (file < 0) return false;
+    struct stat info;
+    void* view = MAP_FAILED;
+    if ((fstat(file, &info) == 0) && (info.st_size > 0))
+        view = mmap(nullptr, std::size_t(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    // The mapping keeps the file alive on its own
+    ::close(file);
+    if (view == MAP_FAILED) return false;
+    m_data = static_cast<const u8*>(view);
+    m_size = std::size_t(info.st_size);
+#endif
+
+    // The sections must lie within the file, then every record must stay within the sections it refers to
+    auto fits = [this](u64 offset, u64 count, u64 size)
+    {
+        return (offset % 8 == 0) && (offset <= m_size) && (count <= (m_size - offset) / size);
+    };
+    const scene_header_t& h = header();
+    bool valid = (m_size >= sizeof(scene_header_t))
+              && (h.magic == scene_magic)
+              && (h.version == scene_version)
+              && (h.precision == sizeof(precision_t))
+              && fits(h.objects, h.objects_c, sizeof(scene_object_t))
+              && fits(h.children, h.children_c, sizeof(scene_child_t))
+              && fits(h.positions, h.vertices_c, sizeof(vec2))
+              && fits(h.normals, h.vertices_c, sizeof(vec2))
+              && fits(h.nodes, h.nodes_c, sizeof(AABBTree::node_t))
+              && validate();
+    if (!valid) close();
+    return valid;
+}
+
+bool Scene::validate() const
+{
+    const scene_header_t& h = header();
+    auto objects = section<scene_object_t>(h.objects);
+    auto children = section<scene_child_t>(h.children);
+    auto nodes = section<AABBTree::node_t>(h.nodes);
+
+    // Ranges are added in 64 bits so that a huge [first] can't wrap around
+    auto within = [](u32 first, u32 count, u32 size) { return u64(first) + u64(count) <= u64(size); };
+    auto valid_shape = [&](u32 type, u32 first, u32 count)
+    {
+        if (type == circle) return true;
+        return (type == polygon) && (count >= 3) && within(first, count, h.vertices_c);
+    };
+
+    u32 static_c = 0;
+    for (u32 i = 0; i < h.objects_c; ++i)
+    {
+        const scene_object_t& object = objects[i];
+        if (object.is_static) ++static_c;
+        if (object.type != compound)
+        {
+            if (!valid_shape(object.type, object.first, object.count)) return false;
+            continue;
+        }
+        if ((object.count == 0) || !within(object.first, object.count, h.children_c)) return false;
+        for (u32 j = 0; j < object.count; ++j)
+        {
+            const scene_child_t& child = children[object.first + j];
+            if (!valid_shape(child.type, child.first, child.count)) return false;
+        }
+    }
+
+    // Children come after their parent, which also rules out cycles, and leaves refer to static objects
+    // A node has at most one parent, so that queries visit it once, and the depth fits the stack of [query]
+    // Parents come first, so the depth of a node is known by the time its children are checked
+    std::vector<u32> depth(h.nodes_c, 0);
+    std::vector<bool> parented(h.nodes_c, false);
+    for (u32 i = 0; i < h.nodes_c; ++i)
+    {
+        const AABBTree::node_t& node = nodes[i];
+        if (node.right == AABBTree::leaf)
+        {
+            if (node.left >= static_c) return false;
+            continue;
+        }
+        if ((node.left <= i) || (node.left >= h.nodes_c) || (node.right <= i) || (node.right >= h.nodes_c)) return false;
+        if (node.left == node.right) return false;
+        if (depth[i] == AABBTree::max_depth) return false;
+        for (u32 child : {node.left, node.right})
+        {
+            if (parented[child]) return false;
+            parented[child] = true;
+            depth[child] = depth[i] + 1;
+        }
+    }
+    return true;
+}
+
+void Scene::close()
+{
+    if (!m_data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping);
+    CloseHandle(m_file);
+#else
+    munmap(const_cast<u8*>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_file = nullptr;
+    m_mapping = nullptr;
+}
+
+bool Scene::is_open() const
+{
+    return m_data != nullptr;
+}
+
+u32 Scene::objects() const
+{
+    assert(is_open());
+    return header().objects_c;
+}
+
+void Scene::instantiate(Physics2D& world) const
+{
+    assert(is_open());
+    const scene_header_t& h = header();
+    auto objects = section<scene_object_t>(h.objects);
+    auto children = section<scene_child_t>(h.children);
+    // The engine never writes to the vertices of a polygon
+    auto positions = const_cast<vec2*>(section<vec2>(h.positions));
+    auto normals = const_cast<vec2*>(section<vec2>(h.normals));
+
+    // Positions are relative to the origin of the world that was saved
+    vec2 shift = {precision_t(h.origin[0] - world.m_origin.x), precision_t(h.origin[1] - world.m_origin.y)};
+    bool shifted = (shift.x != 0.0F) || (shift.y != 0.0F);
+
+    // The saved static tree only matches when the static objects keep the same indices and places
+    bool keep_tree = (h.nodes_c > 0) && world.m_static.empty() && !shifted;
+
+    std::vector<child_t> parts;
+    bool added_static = false;
+    for (u32 i = 0; i < h.objects_c; ++i)
+    {
+        const scene_object_t& object = objects[i];
+        transform_t transform = object.transform;
+        transform.position += shift;
+        added_static |= (object.is_static != 0);
+
+        // Compounds own their children and tree, they go through the regular path
+        if (object.type == compound)
+        {
+            parts.resize(object.count);
+            for (u32 j = 0; j < object.count; ++j)
+            {
+                const scene_child_t& child = children[object.first + j];
+                parts[j] = {u8(child.type), child.offset, child.orientation, child.density, child.radius,
+                            positions + child.first, normals + child.first, child.count};
+            }
+            world.add(transform, object.material, object.motion, parts.data(), object.count);
+            continue;
+        }
+
+        Physics2D::shape_t shape;
+        shape.o.type = u8(object.type);
+        shape.o.body = object.body;
+        shape.o.motion = object.motion;
+        shape.o.material = object.material;
+        shape.o.transform = transform;
+        if (object.type == circle)
+        {
+            shape.c.radius = object.radius;
+        }
+        else
+        {
+            shape.p.positions = positions + object.first;
+            shape.p.normals = normals + object.first;
+            shape.p.vertices_c = object.count;
+        }
+
+        if (object.is_static)
+        {
+            world.add_static(shape);
+            continue;
+        }
+        // The vector must not reallocate, the objects are referenced by address
+        assert(world.m_dynamic.size() < world.m_max_objects);
+        world.m_dynamic.push_back(shape);
+    }
+
+    if (keep_tree)
+    {
+        // The world had no static objects, so the items of the tree are the indices of the objects
+        world.m_static_tree.assign(section<AABBTree::node_t>(h.nodes), h.nodes_c);
+        world.m_static_items.resize(world.m_static.size());
+        for (u32 i = 0; i < world.m_static.size(); ++i) world.m_static_items[i] = i;
+        world.m_static_dirty = false;
+    }
+    else if (added_static)
+    {
+        world.m_static_dirty = true;
+    }
+}
+
+bool Scene::save(Physics2D& world, const char* path)
+{
+    std::vector<scene_object_t> objects;
+    std::vector<scene_child_t> children;
+    std::vector<vec2> positions;
+    std::vector<vec2> normals;
+
+    // Meshes are usually shared by many objects, identify them by the address of their vertices
+    std::unordered_map<const vec2*, u32> shared;
+    auto store_vertices = [&](const vec2* p, const vec2* n, u32 count)
+    {
+        auto found = shared.find(p);
+        if (found != shared.end()) return found->second;
+        u32 first = positions.size();
+        positions.insert(positions.end(), p, p + count);
+        normals.insert(normals.end(), n, n + count);
+        shared.emplace(p, first);
+        return first;
+    };
+
+    auto store_object = [&](const Physics2D::shape_t& shape, bool is_static)
+    {
+        scene_object_t object = {};
+        object.type = shape.o.type;
+        object.is_static = is_static;
+        object.body = shape.o.body;
+        object.motion = shape.o.motion;
+        object.material = shape.o.material;
+        object.transform = shape.o.transform;
+        if (shape.o.type == circle)
+        {
+            object.radius = shape.c.radius;
+        }
+        else if (shape.o.type == polygon)
+        {
+            object.first = store_vertices(shape.p.positions, shape.p.normals, shape.p.vertices_c);
+            object.count = shape.p.vertices_c;
+        }
+        else
+        {
+            object.first = children.size();
+            object.count = shape.m.children_c;
+            for (u32 i = 0; i < shape.m.children_c; ++i)
+            {
+                const child_t& child = shape.m.children[i];
+                scene_child_t record = {};
+                record.type = child.type;
+                record.offset = child.offset;
+                record.orientation = child.orientation;
+                record.density = child.density;
+                record.radius = child.radius;
+                if (child.type == polygon)
+                {
+                    record.first = store_vertices(child.positions, child.normals, child.vertices_c);
+                    record.count = child.vertices_c;
+                }
+                children.push_back(record);
+            }
+        }
+        objects.push_back(object);
+    };
+
+    // Static objects first, in the order of the items of the static tree so that the saved tree refers to them
+    world.update_static_tree();
+    for (u32 item : world.m_static_items) store_object(world.m_static[item], true);
+    for (const auto& shape : world.m_dynamic) store_object(shape, false);
+
+    const AABBTree& tree = world.m_static_tree;
+
+    // Every section starts on a 16 byte boundary
+    auto align = [](u64 offset) { return (offset + 15) & ~u64(15); };
+    scene_header_t h = {};
+    h.magic = scene_magic;
+    h.version = scene_version;
+    h.precision = sizeof(precision_t);
+    h.objects_c = objects.size();
+    h.children_c = children.size();
+    h.vertices_c = positions.size();
+    h.nodes_c = tree.nodes_c();
+    h.origin[0] = world.m_origin.x;
+    h.origin[1] = world.m_origin.y;
+    h.objects = align(sizeof(scene_header_t));
+    h.children = align(h.objects + objects.size() * sizeof(scene_object_t));
+    h.positions = align(h.children + children.size() * sizeof(scene_child_t));
+    h.normals = align(h.positions + positions.size() * sizeof(vec2));
+    h.nodes = align(h.normals + normals.size() * sizeof(vec2));
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+
+    u64 written = 0;
+    auto write = [&](u64 offset, const void* data, u64 size)
+    {
+        static const char padding[16] = {};
+        file.write(padding, offset - written);
+        file.write(static_cast<const char*>(data), size);
+        written = offset + size;
+    };
+    write(0, &h, sizeof(h));
+    write(h.objects, objects.data(), objects.size() * sizeof(scene_object_t));
+    write(h.children, children.data(), children.size() * sizeof(scene_child_t));
+    write(h.positions, positions.data(), positions.size() * sizeof(vec2));
+    write(h.normals, normals.data(), normals.size() * sizeof(vec2));
+    write(h.nodes, tree.nodes(), u64(tree.nodes_c()) * sizeof(AABBTree::node_t));
+    return bool(file);
+}
+
+}
@@ -0,0 +1,114 @@
+#ifndef SCENE_HPP
+#define SCENE_HPP
+
+#include "Configuration.hpp"
+#include "PhysicsTypes.hpp"
+#include "AABBTree.hpp"
+#include "Physics.hpp"
+
+namespace PHYSICS_NAMESPACE
+{
+
+/// Binary scene format
+/// Every section is an array of fixed size records, so a mapped file can be used in place
+/// Files are only readable by builds with the same precision_t and byte order that wrote them
+
+constexpr u32 scene_magic = 0x53443250; // "P2DS"
+constexpr u32 scene_version = 2;
+
+struct scene_header_t
+{
+    u32 magic;
+    u32 version;
+    u32 precision;  // sizeof(precision_t) of the build that wrote the file
+    u32 objects_c;  // Static objects are stored first, in the order of the static tree items
+    u32 children_c;
+    u32 vertices_c;
+    u32 nodes_c;    // Zero when the file has no static tree
+    u32 reserved;
+    f64 origin[2];  // Floating origin of the world that was saved, see [Physics2D::rebase]
+    u64 objects;    // Byte offsets of each section from the beginning of the file
+    u64 children;
+    u64 positions;
+    u64 normals;
+    u64 nodes;
+};
+
+struct scene_object_t
+{
+    u32 type;
+    u32 is_static;
+    body_t body;     // Mass properties are stored so loading doesn't compute them again
+    motion_t motion;
+    material_t material;
+    transform_t transform;
+    precision_t radius; // Only used by circles
+    u32 first;       // First vertex of a polygon or first child of a compound
+    u32 count;       // Number of vertices or children
+};
+
+struct scene_child_t
+{
+    u32 type;
+    u32 first;       // First vertex, only used by polygons
+    u32 count;
+    vec2 offset;
+    precision_t orientation;
+    precision_t density;
+    precision_t radius;
+};
+
+// Read-only view of a scene file mapped in memory
+class Scene final
+{
+
+    // Copies the records of region files, see Streaming.hpp
+    friend class RegionStreamer;
+
+    const u8* m_data;
+    std::size_t m_size;
+    void* m_file;    // Platform handles, owned by the scene
+    void* m_mapping;
+
+    const scene_header_t& header() const;
+    template <typename T>
+    const T* section(u64 offset) const;
+    // Checks that the records only refer to vertices, children and objects that exist in the file
+    bool validate() const;
+
+public:
+
+    Scene();
+    ~Scene();
+
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+
+    // Maps a scene file, returns false when it can't be read, was written by an incompatible build, or has
+    // sections or records that point outside of the file
+    bool open(const char* path);
+    void close();
+    bool is_open() const;
+
+    // Adds every object of the scene to [world]
+    // Polygons point at the vertices in the mapped file, so the scene must stay open while the world uses them
+    void instantiate(Physics2D& world) const;
+
+    u32 objects() const;
+
+    // Writes every object of [world] to a scene file
+    // Vertex arrays shared by several polygons are only written once
+    // Brings the static tree of [world] up to date so it can be saved along with the objects
+    static bool save(Physics2D& world, const char* path);
+
+};
+
+template <typename T>
+inline const T* Scene::section(u64 offset) const
+{
+    return reinterpret_cast<const T*>(m_data + offset);
+}
+
+}
+
+#endif // SCENE_HPP
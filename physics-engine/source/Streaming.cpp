@@ -0,0 +1,287 @@
+#include "Streaming.hpp"
+
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+namespace PHYSICS_NAMESPACE
+{
+
+/// Region streamer class implementation
+
+RegionStreamer::RegionStreamer(Physics2D& world, precision_t size, loader_t loader, void* user, u32 max_loads)
+    : m_world {world}, m_size {size}, m_loader {loader}, m_user {user}, m_max_loads {max_loads}, m_next_id {1}, m_loading {0}, m_radius {0.0F}
+{
+    assert(size > 0.0F);
+    assert(loader && (max_loads > 0));
+}
+
+RegionStreamer::~RegionStreamer()
+{
+    m_unload.clear();
+    for (auto& entry : m_regions)
+    {
+        if (!entry.second.loaded) entry.second.load.wait();
+        else m_unload.push_back(entry.first);
+    }
+    unload();
+}
+
+u64 RegionStreamer::key(i32 x, i32 y)
+{
+    return (u64(u32(x)) << 32) | u64(u32(y));
+}
+
+i32 RegionStreamer::cell(f64 coordinate) const
+{
+    return i32(std::floor(coordinate / f64(m_size)));
+}
+
+f64 RegionStreamer::distance(i32 x, i32 y, MATH_NAMESPACE::v2_t<f64> p) const
+{
+    f64 size = f64(m_size);
+    f64 dx = math::max(f64(x) * size - p.x, p.x - f64(x + 1) * size, 0.0);
+    f64 dy = math::max(f64(y) * size - p.y, p.y - f64(y + 1) * size, 0.0);
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+bool RegionStreamer::load_scene(i32 x, i32 y, region_data_t& data, void* user)
+{
+    char path[512];
+    std::snprintf(path, sizeof(path), static_cast<const char*>(user), x, y);
+    Scene scene;
+    if (!scene.open(path)) return false;
+
+    // The file is only mapped while the records are copied, the region owns its vertices afterwards
+    const scene_header_t& h = scene.header();
+    auto objects = scene.section<scene_object_t>(h.objects);
+    auto children = scene.section<scene_child_t>(h.children);
+    auto positions = scene.section<vec2>(h.positions);
+    auto normals = scene.section<vec2>(h.normals);
+    data.origin[0] = h.origin[0];
+    data.origin[1] = h.origin[1];
+    data.objects.assign(objects, objects + h.objects_c);
+    data.children.assign(children, children + h.children_c);
+    data.positions.assign(positions, positions + h.vertices_c);
+    data.normals.assign(normals, normals + h.vertices_c);
+    return true;
+}
+
+void RegionStreamer::instantiate(region_t& region)
+{
+    const region_data_t& data = region.data;
+    Physics2D& world = m_world;
+    m_owners.resize(world.m_static.size(), 0);
+
+    // The engine never writes to the vertices of a polygon
+    auto positions = const_cast<vec2*>(data.positions.data());
+    auto normals = const_cast<vec2*>(data.normals.data());
+    vec2 shift = {precision_t(data.origin[0] - world.m_origin.x), precision_t(data.origin[1] - world.m_origin.y)};
+
+    auto insert = [&](const Physics2D::shape_t& shape)
+    {
+        // Slots left by unloaded regions are reused first
+        std::size_t index = world.add_static(shape) - world.m_static.data();
+        m_owners.resize(world.m_static.size(), 0);
+        m_owners[index] = region.id;
+    };
+
+    for (const auto& object : data.objects)
+    {
+        if (!object.is_static) continue;
+        transform_t transform = object.transform;
+        transform.position += shift;
+
+        Physics2D::shape_t shape;
+        shape.o.motion = {};
+        shape.o.material = object.material;
+
+        // A static compound never moves, so its parts are added as separate objects
+        // This way the region owns every vertex and nothing is left in the world once it is unloaded
+        if (object.type == compound)
+        {
+            precision_t sin, cos;
+            math::fast::sin_cos(transform.orientation, sin, cos);
+            for (u32 i = 0; i < object.count; ++i)
+            {
+                const scene_child_t& child = data.children[object.first + i];
+                shape.o.type = u8(child.type);
+                shape.o.body = {math::infinity(), 0.0F, math::infinity(), 0.0F};
+                shape.o.transform = {child.offset.rotate(sin, cos) + transform.position,
+                                     child.orientation + transform.orientation,
+                                     transform.scale};
+                if (child.type == circle)
+                {
+                    shape.c.radius = child.radius;
+                }
+                else
+                {
+                    shape.p.positions = positions + child.first;
+                    shape.p.normals = normals + child.first;
+                    shape.p.vertices_c = child.count;
+                }
+                insert(shape);
+            }
+            continue;
+        }
+
+        shape.o.type = u8(object.type);
+        shape.o.body = object.body;
+        shape.o.transform = transform;
+        if (object.type == circle)
+        {
+            shape.c.radius = object.radius;
+        }
+        else
+        {
+            shape.p.positions = positions + object.first;
+            shape.p.normals = normals + object.first;
+            shape.p.vertices_c = object.count;
+        }
+        insert(shape);
+    }
+
+    region.loaded = true;
+}
+
+void RegionStreamer::unload()
+{
+    Physics2D& world = m_world;
+    m_owners.resize(world.m_static.size(), 0);
+    m_unload_ids.clear();
+    for (u64 region : m_unload) m_unload_ids.push_back(m_regions.at(region).id);
+    std::sort(m_unload_ids.begin(), m_unload_ids.end());
+
+    // Removed objects become tombstones, so that the objects that stay never move and every pointer to them
+    // (objects returned by add, joints, contacts) remains valid. Contacts, events and joints of the removed
+    // objects are dropped, no end event is sent for them
+    for (u32 i = 0; i < world.m_static.size(); ++i)
+    {
+        u32 owner = m_owners[i];
+        if (!owner || !std::binary_search(m_unload_ids.begin(), m_unload_ids.end(), owner)) continue;
+        world.remove_static(i);
+        m_owners[i] = 0;
+    }
+    world.forget_removed();
+
+    for (u64 region : m_unload) m_regions.erase(region);
+}
+
+void RegionStreamer::freeze()
+{
+    Physics2D& world = m_world;
+    world.m_frozen.resize(world.m_dynamic.size(), 0);
+    for (std::size_t i = 0; i < world.m_dynamic.size(); ++i)
+    {
+        const vec2& position = world.m_dynamic[i].o.transform.position;
+        u64 region = key(cell(f64(position.x) + world.m_origin.x), cell(f64(position.y) + world.m_origin.y));
+        auto found = m_regions.find(region);
+        world.m_frozen[i] = (found == m_regions.end()) || !found->second.loaded;
+    }
+}
+
+void RegionStreamer::refresh()
+{
+    // Loads that finished since the last update
+    for (auto& entry : m_regions)
+    {
+        region_t& region = entry.second;
+        if (region.loaded || (region.load.wait_for(std::chrono::seconds(0)) != std::future_status::ready)) continue;
+        // A region without a file is still loaded, it just has no objects
+        if (!region.load.get()) region.data = {};
+        --m_loading;
+        instantiate(region);
+    }
+
+    auto nearest = [this](i32 x, i32 y)
+    {
+        f64 closest = math::infinity<f64>();
+        for (const auto& centre : m_centres) closest = math::min(closest, distance(x, y, centre));
+        return closest;
+    };
+
+    m_unload.clear();
+    for (auto& entry : m_regions)
+    {
+        const region_t& region = entry.second;
+        if (region.loaded && (nearest(region.x, region.y) > f64(m_radius + m_size))) m_unload.push_back(entry.first);
+    }
+    if (!m_unload.empty()) unload();
+
+    // Missing regions are read closest first, a few at a time
+    m_requests.clear();
+    for (const auto& centre : m_centres)
+    {
+        for (i32 y = cell(centre.y - m_radius); y <= cell(centre.y + m_radius); ++y)
+        {
+            for (i32 x = cell(centre.x - m_radius); x <= cell(centre.x + m_radius); ++x)
+            {
+                f64 d = distance(x, y, centre);
+                if ((d <= f64(m_radius)) && !m_regions.count(key(x, y))) m_requests.push_back({d, key(x, y)});
+            }
+        }
+    }
+    std::sort(m_requests.begin(), m_requests.end());
+    for (const auto& request : m_requests)
+    {
+        if (m_loading == m_max_loads) break;
+        // Regions close to several centres are requested more than once
+        auto inserted = m_regions.emplace(request.second, region_t {});
+        if (!inserted.second) continue;
+
+        // Elements of an unordered map keep their address, the worker writes straight into the region
+        region_t& region = inserted.first->second;
+        region.x = i32(u32(request.second >> 32));
+        region.y = i32(u32(request.second));
+        region.id = m_next_id++;
+        region.loaded = false;
+        region.data.origin[0] = 0.0;
+        region.data.origin[1] = 0.0;
+        region.load = std::async(std::launch::async, [this, &region]
+        {
+            return m_loader(region.x, region.y, region.data, m_user);
+        });
+        ++m_loading;
+    }
+
+    freeze();
+}
+
+void RegionStreamer::update(const vec2* centres, u32 centres_c, precision_t radius)
+{
+    m_centres.resize(centres_c);
+    for (u32 i = 0; i < centres_c; ++i)
+        m_centres[i] = {f64(centres[i].x) + m_world.m_origin.x, f64(centres[i].y) + m_world.m_origin.y};
+    m_radius = radius;
+    refresh();
+}
+
+void RegionStreamer::wait()
+{
+    // Requests that didn't fit in the loads in flight are started as the previous ones finish
+    while (m_loading)
+    {
+        for (auto& entry : m_regions)
+            if (!entry.second.loaded) entry.second.load.wait();
+        refresh();
+    }
+}
+
+bool RegionStreamer::is_loaded(i32 x, i32 y) const
+{
+    auto found = m_regions.find(key(x, y));
+    return (found != m_regions.end()) && found->second.loaded;
+}
+
+u32 RegionStreamer::regions() const
+{
+    return m_regions.size() - m_loading;
+}
+
+u32 RegionStreamer::loading() const
+{
+    return m_loading;
+}
+
+}
@@ -0,0 +1,117 @@
+#ifndef STREAMING_HPP
+#define STREAMING_HPP
+
+#include "Configuration.hpp"
+#include "PhysicsTypes.hpp"
+#include "Physics.hpp"
+#include "Scene.hpp"
+
+#include <vector>
+#include <future>
+#include <unordered_map>
+
+namespace PHYSICS_NAMESPACE
+{
+
+/// Region streaming
+/// The static geometry of a level is cut into square regions on a fixed grid, only the regions close to
+/// a set of activity centres are kept in the world. Regions are loaded on worker threads and added to the
+/// world between steps, so memory and the static broadphase scale with the active area instead of the level
+/// Dynamic objects standing in a region that isn't loaded are frozen until it is
+/// Unloading never moves the static objects that stay, the unloaded ones leave slots that the next regions reuse.
+/// Their contacts, contact events and joints are dropped with them, without end events
+/// Streaming changes the static objects behind the back of traces, so it must not be used while recording
+
+// Static objects of one region, in the same records as the binary scene format
+// Positions are relative to [origin], which is in the same absolute space as [Physics2D::origin]
+struct region_data_t
+{
+    f64 origin[2];
+    std::vector<scene_object_t> objects; // Dynamic objects are ignored, only static geometry is streamed
+    std::vector<scene_child_t> children;
+    std::vector<vec2> positions;
+    std::vector<vec2> normals;
+};
+
+class RegionStreamer final
+{
+
+public:
+
+    // Fills [data] with the region at grid coordinates (x, y), returns false when there is nothing there
+    // Called from worker threads, several loads can run at the same time
+    using loader_t = bool(*)(i32 x, i32 y, region_data_t& data, void* user);
+
+private:
+
+    struct region_t
+    {
+        i32 x, y;
+        u32 id;                 // Tags the static objects of the region, never zero
+        bool loaded;            // Its objects are in the world, otherwise the load is still running
+        std::future<bool> load;
+        region_data_t data;     // Owns the vertices the polygons of the region point at
+    };
+
+    Physics2D& m_world;
+    const precision_t m_size;
+    const loader_t m_loader;
+    void* const m_user;
+    const u32 m_max_loads;
+
+    std::unordered_map<u64, region_t> m_regions; // Loaded or loading, keyed by their packed coordinates
+    std::vector<u32> m_owners; // Region id of every static object of the world, zero for the ones added directly and for free slots
+    u32 m_next_id;
+    u32 m_loading;
+
+    // Activity centres of the last update, in absolute coordinates
+    std::vector<MATH_NAMESPACE::v2_t<f64>> m_centres;
+    precision_t m_radius;
+
+    // Scratch lists reused by every update
+    std::vector<std::pair<f64, u64>> m_requests; // Missing regions and their distance to the closest centre
+    std::vector<u64> m_unload;
+    std::vector<u32> m_unload_ids;
+
+    static u64 key(i32 x, i32 y);
+    i32 cell(f64 coordinate) const;
+    // Distance from an absolute position to the closest point of a region
+    f64 distance(i32 x, i32 y, MATH_NAMESPACE::v2_t<f64> p) const;
+
+    void refresh();
+    void instantiate(region_t& region);
+    void unload();
+    void freeze();
+
+public:
+
+    // [size] is the side of the regions in world units, at most [max_loads] regions are read at the same time
+    RegionStreamer(Physics2D& world, precision_t size, loader_t loader, void* user, u32 max_loads = 2);
+    // Waits for the loads in flight and removes every streamed object from the world
+    ~RegionStreamer();
+
+    RegionStreamer(const RegionStreamer&) = delete;
+    RegionStreamer& operator=(const RegionStreamer&) = delete;
+
+    // Loader reading one scene file per region, [user] is a printf pattern taking the grid coordinates
+    // such as "level/%d_%d.p2ds". The regions can be written by saving a world per region with [Scene::save]
+    static bool load_scene(i32 x, i32 y, region_data_t& data, void* user);
+
+    // Call between steps with the positions the game cares about (players, cameras) in world space
+    // Regions within [radius] of a centre are requested, loaded regions are removed once they are farther
+    // than [radius] plus the size of a region, so objects moving back and forth on a border don't thrash
+    // Finished loads are added to the world and the dynamic objects are frozen or thawed
+    void update(const vec2* centres, u32 centres_c, precision_t radius);
+
+    // Blocks until every load in flight is added to the world, useful at startup
+    void wait();
+
+    bool is_loaded(i32 x, i32 y) const;
+    u32 regions() const; // Regions in the world
+    u32 loading() const; // Regions being read
+
+};
+
+}
+
+#endif // STREAMING_HPP
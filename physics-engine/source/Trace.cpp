@@ -0,0 +1,430 @@
+#include "Trace.hpp"
+
+#include <cstring>
+
+namespace PHYSICS_NAMESPACE
+{
+
+/// Trace recorder class implementation
+
+TraceRecorder::TraceRecorder()
+    : m_static_c {0}, m_gravity {0.0F, 0.0F}, m_iterations {0}, m_speculative {false}, m_steps {0}
+{
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    close();
+}
+
+template <typename T>
+void TraceRecorder::write(const T& value)
+{
+    m_file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+u32 TraceRecorder::reference(const Physics2D& world, const object_t* o)
+{
+    if (!o) return ~0U;
+    auto shape = reinterpret_cast<const Physics2D::shape_t*>(o);
+    if ((shape >= world.m_dynamic.data()) && (shape < world.m_dynamic.data() + world.m_dynamic.size()))
+        return u32(shape - world.m_dynamic.data()) * 2;
+    assert((shape >= world.m_static.data()) && (shape < world.m_static.data() + world.m_static.size()));
+    return u32(shape - world.m_static.data()) * 2 + 1;
+}
+
+u32 TraceRecorder::write_mesh(const vec2* positions, const vec2* normals, u32 vertices_c)
+{
+    auto found = m_meshes.find(positions);
+    if (found != m_meshes.end()) return found->second;
+
+    write(u32(trace_mesh));
+    write(vertices_c);
+    m_file.write(reinterpret_cast<const char*>(positions), vertices_c * sizeof(vec2));
+    m_file.write(reinterpret_cast<const char*>(normals), vertices_c * sizeof(vec2));
+
+    u32 index = m_meshes.size();
+    m_meshes.emplace(positions, index);
+    return index;
+}
+
+void TraceRecorder::write_object(const object_t& o, bool is_static)
+{
+    scene_object_t object = {};
+    object.type = o.type;
+    object.is_static = is_static;
+    object.body = o.body;
+    object.motion = o.motion;
+    object.material = o.material;
+    object.transform = o.transform;
+
+    std::vector<scene_child_t> children;
+    if (o.type == circle)
+    {
+        object.radius = static_cast<const circle_t&>(o).radius;
+    }
+    else if (o.type == polygon)
+    {
+        auto& p = static_cast<const polygon_t&>(o);
+        object.first = write_mesh(p.positions, p.normals, p.vertices_c);
+        object.count = p.vertices_c;
+    }
+    else
+    {
+        auto& m = static_cast<const compound_t&>(o);
+        object.count = m.children_c;
+        for (u32 i = 0; i < m.children_c; ++i)
+        {
+            const child_t& child = m.children[i];
+            scene_child_t record = {};
+            record.type = child.type;
+            record.offset = child.offset;
+            record.orientation = child.orientation;
+            record.density = child.density;
+            record.radius = child.radius;
+            if (child.type == polygon)
+            {
+                record.first = write_mesh(child.positions, child.normals, child.vertices_c);
+                record.count = child.vertices_c;
+            }
+            children.push_back(record);
+        }
+    }
+
+    // Meshes must be written before the object that uses them
+    write(u32(trace_object));
+    write(object);
+    for (auto& child : children) write(child);
+}
+
+void TraceRecorder::begin_step(const Physics2D& world)
+{
+    // Objects added since the last step, either through add or by loading a scene
+    for (; m_static_c < world.m_static.size(); ++m_static_c) write_object(world.m_static[m_static_c].o, true);
+
+    // Bodies whose state changed since the end of the last step were written to by the game
+    for (u32 i = 0; i < m_states.size(); ++i)
+    {
+        const object_t& o = world.m_dynamic[i].o;
+        state_t state = {o.transform, o.motion};
+        if (std::memcmp(&state, &m_states[i], sizeof(state_t)) == 0) continue;
+        write(u32(trace_motion));
+        write(i);
+        write(state.transform);
+        write(state.motion);
+    }
+    for (std::size_t i = m_states.size(); i < world.m_dynamic.size(); ++i) write_object(world.m_dynamic[i].o, false);
+
+    if ((world.m_gravity.x != m_gravity.x) || (world.m_gravity.y != m_gravity.y))
+    {
+        m_gravity = world.m_gravity;
+        write(u32(trace_gravity));
+        write(m_gravity);
+    }
+
+    if ((world.m_iterations != m_iterations) || (world.m_speculative != m_speculative))
+    {
+        m_iterations = world.m_iterations;
+        m_speculative = world.m_speculative;
+        write(u32(trace_solver));
+        write(m_iterations);
+        write(u32(m_speculative));
+    }
+
+    // Fields are few, any change rewrites all of them
+    bool fields_changed = (world.m_fields.size() != m_fields.size())
+                       || (std::memcmp(world.m_fields.data(), m_fields.data(), m_fields.size() * sizeof(force_field_t)) != 0);
+    if (fields_changed)
+    {
+        m_fields.assign(world.m_fields.begin(), world.m_fields.end());
+        write(u32(trace_fields));
+        write(u32(m_fields.size()));
+        m_file.write(reinterpret_cast<const char*>(m_fields.data()), m_fields.size() * sizeof(force_field_t));
+    }
+
+    bool joints_changed = (world.m_joints.size() != m_joints.size())
+                       || (std::memcmp(world.m_joints.data(), m_joints.data(), m_joints.size() * sizeof(joint_t)) != 0);
+    if (joints_changed)
+    {
+        m_joints.assign(world.m_joints.begin(), world.m_joints.end());
+        write(u32(trace_joints));
+        write(u32(m_joints.size()));
+        for (const auto& joint : m_joints)
+        {
+            write(joint);
+            write(reference(world, joint.a));
+            write(reference(world, joint.b));
+        }
+    }
+
+    write(u32(trace_step));
+    ++m_steps;
+}
+
+void TraceRecorder::end_step(const Physics2D& world)
+{
+    m_states.resize(world.m_dynamic.size());
+    for (std::size_t i = 0; i < world.m_dynamic.size(); ++i)
+    {
+        const object_t& o = world.m_dynamic[i].o;
+        m_states[i] = {o.transform, o.motion};
+    }
+}
+
+void TraceRecorder::rebase(vec2 origin)
+{
+    // The snapshot moves along with the objects, so later changes are still detected
+    write(u32(trace_rebase));
+    write(origin);
+    for (auto& state : m_states) state.transform.position -= origin;
+    for (auto& field : m_fields)
+    {
+        field.region.min -= origin;
+        field.region.max -= origin;
+        field.center -= origin;
+    }
+    for (auto& joint : m_joints)
+        if (!joint.b) joint.anchor_b -= origin;
+}
+
+bool TraceRecorder::open(const char* path, const Physics2D& world)
+{
+    close();
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file) return false;
+
+    trace_header_t header = {};
+    header.magic = trace_magic;
+    header.version = trace_version;
+    header.precision = sizeof(precision_t);
+    header.max_objects = world.m_max_objects;
+    header.timestep = world.m_timestep;
+    write(header);
+
+    // Objects that already exist are written by the first step, like new ones
+    m_meshes.clear();
+    m_states.clear();
+    m_static_c = 0;
+    m_gravity = {0.0F, 0.0F};
+    // No world runs zero iterations, so the first step always writes the solver settings
+    m_iterations = 0;
+    m_speculative = false;
+    m_fields.clear();
+    m_joints.clear();
+    m_steps = 0;
+    return true;
+}
+
+void TraceRecorder::close()
+{
+    if (m_file.is_open()) m_file.close();
+}
+
+bool TraceRecorder::is_open() const
+{
+    return m_file.is_open();
+}
+
+u32 TraceRecorder::steps() const
+{
+    return m_steps;
+}
+
+/// Trace player class implementation
+
+TracePlayer::TracePlayer()
+    : m_steps {0}
+{
+}
+
+TracePlayer::~TracePlayer() = default;
+
+template <typename T>
+bool TracePlayer::read(T& value)
+{
+    return bool(m_file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+bool TracePlayer::read_object()
+{
+    scene_object_t object;
+    if (!read(object)) return false;
+    Physics2D& world = *m_world;
+
+    if (object.type == compound)
+    {
+        m_children.resize(object.count);
+        for (u32 i = 0; i < object.count; ++i)
+        {
+            scene_child_t child;
+            if (!read(child)) return false;
+            assert((child.type == circle) || (child.first < m_positions.size()));
+            vec2* positions = (child.type == polygon) ? m_positions[child.first].data() : nullptr;
+            vec2* normals = (child.type == polygon) ? m_normals[child.first].data() : nullptr;
+            m_children[i] = {u8(child.type), child.offset, child.orientation, child.density, child.radius,
+                             positions, normals, child.count};
+        }
+        // Children were already centered on the center of mass, restore the recorded values exactly
+        // so that rounding in the recentering doesn't make the replay diverge
+        compound_t* m = world.add(object.transform, object.material, object.motion, m_children.data(), object.count);
+        m->transform = object.transform;
+        m->body = object.body;
+        for (u32 i = 0; i < object.count; ++i) m->children[i].offset = m_children[i].offset;
+        return true;
+    }
+
+    // Same as loading a scene, the recorded mass properties are used as they are
+    Physics2D::shape_t shape;
+    shape.o.type = u8(object.type);
+    shape.o.body = object.body;
+    shape.o.motion = object.motion;
+    shape.o.material = object.material;
+    shape.o.transform = object.transform;
+    if (object.type == circle)
+    {
+        shape.c.radius = object.radius;
+    }
+    else
+    {
+        assert(object.first < m_positions.size());
+        shape.p.positions = m_positions[object.first].data();
+        shape.p.normals = m_normals[object.first].data();
+        shape.p.vertices_c = object.count;
+    }
+
+    auto& objects = object.is_static ? world.m_static : world.m_dynamic;
+    assert(objects.size() < world.m_max_objects);
+    objects.push_back(shape);
+    world.m_static_dirty |= (object.is_static != 0);
+    return true;
+}
+
+object_t* TracePlayer::object(u32 reference)
+{
+    if (reference == ~0U) return nullptr;
+    auto& objects = (reference & 1) ? m_world->m_static : m_world->m_dynamic;
+    assert((reference >> 1) < objects.size());
+    return &objects[reference >> 1].o;
+}
+
+bool TracePlayer::open(const char* path)
+{
+    m_file.open(path, std::ios::binary);
+    trace_header_t header;
+    if (!m_file || !read(header)) return false;
+    if ((header.magic != trace_magic) || (header.version != trace_version) || (header.precision != sizeof(precision_t)))
+        return false;
+
+    m_world.reset(new Physics2D(header.max_objects, header.timestep));
+    m_steps = 0;
+    return true;
+}
+
+bool TracePlayer::next()
+{
+    assert(m_world);
+    Physics2D& world = *m_world;
+
+    u32 tag;
+    while (read(tag))
+    {
+        switch (tag)
+        {
+
+        case trace_mesh:
+        {
+            u32 vertices_c;
+            if (!read(vertices_c)) return false;
+            m_positions.emplace_back(vertices_c);
+            m_normals.emplace_back(vertices_c);
+            m_file.read(reinterpret_cast<char*>(m_positions.back().data()), vertices_c * sizeof(vec2));
+            m_file.read(reinterpret_cast<char*>(m_normals.back().data()), vertices_c * sizeof(vec2));
+            break;
+        }
+
+        case trace_object:
+            if (!read_object()) return false;
+            break;
+
+        case trace_motion:
+        {
+            u32 index;
+            transform_t transform;
+            motion_t motion;
+            if (!read(index) || !read(transform) || !read(motion)) return false;
+            assert(index < world.m_dynamic.size());
+            world.m_dynamic[index].o.transform = transform;
+            world.m_dynamic[index].o.motion = motion;
+            break;
+        }
+
+        case trace_gravity:
+            if (!read(world.m_gravity)) return false;
+            break;
+
+        case trace_solver:
+        {
+            u32 speculative;
+            if (!read(world.m_iterations) || !read(speculative)) return false;
+            world.m_speculative = (speculative != 0);
+            break;
+        }
+
+        case trace_rebase:
+        {
+            vec2 origin;
+            if (!read(origin)) return false;
+            world.rebase(origin);
+            break;
+        }
+
+        case trace_fields:
+        {
+            u32 count;
+            if (!read(count)) return false;
+            std::vector<force_field_t> fields(count);
+            if (!m_file.read(reinterpret_cast<char*>(fields.data()), count * sizeof(force_field_t))) return false;
+            world.m_fields.assign(fields.data(), count);
+            break;
+        }
+
+        case trace_joints:
+        {
+            u32 count;
+            if (!read(count)) return false;
+            std::vector<joint_t> joints(count);
+            for (auto& joint : joints)
+            {
+                u32 a, b;
+                if (!read(joint) || !read(a) || !read(b)) return false;
+                joint.a = object(a);
+                joint.b = object(b);
+            }
+            world.m_joints.assign(joints.data(), count);
+            break;
+        }
+
+        case trace_step:
+            ++m_steps;
+            return true;
+
+        default:
+            assert(false);
+            return false;
+        }
+    }
+    return false;
+}
+
+Physics2D& TracePlayer::world()
+{
+    assert(m_world);
+    return *m_world;
+}
+
+u32 TracePlayer::steps() const
+{
+    return m_steps;
+}
+
+}
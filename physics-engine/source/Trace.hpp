@@ -0,0 +1,133 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include "Configuration.hpp"
+#include "PhysicsTypes.hpp"
+#include "Physics.hpp"
+#include "Scene.hpp"
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <fstream>
+#include <unordered_map>
+
+namespace PHYSICS_NAMESPACE
+{
+
+/// Input traces
+/// A trace is the sequence of everything the game did to a world: objects added, velocities and forces
+/// written, gravity, force field, joint and solver setting changes, rebases and steps. Replaying it in the same build reproduces the simulation
+
+constexpr u32 trace_magic = 0x54443250; // "P2DT"
+constexpr u32 trace_version = 4;
+
+struct trace_header_t
+{
+    u32 magic;
+    u32 version;
+    u32 precision; // sizeof(precision_t) of the build that wrote the trace
+    u32 max_objects;
+    precision_t timestep;
+};
+
+// Every record starts with its tag, followed by the payload listed here
+enum trace_record_t
+{
+    trace_mesh,   // u32 vertices_c, vec2 positions[vertices_c], vec2 normals[vertices_c]
+    trace_object, // scene_object_t, then scene_child_t[count] for compounds (first is a mesh index)
+    trace_motion, // u32 index of the dynamic object, transform_t, motion_t
+    trace_gravity,// vec2
+    trace_rebase, // vec2
+    trace_fields, // u32 count, force_field_t[count], replaces every field of the world
+    trace_joints, // u32 count, then joint_t and two u32 object references per joint, replaces every joint of the world
+    trace_solver, // u32 iterations, u32 speculative
+    trace_step
+};
+
+// Records the inputs of a world, see [Physics2D::record]
+// Objects and body changes are picked up when the world steps, by comparing the dynamic objects
+// against their state at the end of the previous step. Changes to static objects are not recorded
+class TraceRecorder final
+{
+
+    friend class Physics2D;
+
+    struct state_t
+    {
+        transform_t transform;
+        motion_t motion;
+    };
+
+    std::ofstream m_file;
+    std::unordered_map<const vec2*, u32> m_meshes; // Vertex arrays already written, and their index
+    std::vector<state_t> m_states; // Dynamic objects at the end of the last step
+    std::size_t m_static_c;        // Number of static objects already written
+    vec2 m_gravity;
+    u32 m_iterations;
+    bool m_speculative;
+    std::vector<force_field_t> m_fields;
+    std::vector<joint_t> m_joints;
+    u32 m_steps;
+
+    template <typename T>
+    void write(const T& value);
+    // Objects are referenced by their index, odd for static objects, ~0 for the world
+    static u32 reference(const Physics2D& world, const object_t* o);
+    u32 write_mesh(const vec2* positions, const vec2* normals, u32 vertices_c);
+    void write_object(const object_t& o, bool is_static);
+
+    // Hooks called by the world
+    void begin_step(const Physics2D& world);
+    void end_step(const Physics2D& world);
+    void rebase(vec2 origin);
+
+public:
+
+    TraceRecorder();
+    ~TraceRecorder();
+
+    bool open(const char* path, const Physics2D& world);
+    void close();
+    bool is_open() const;
+
+    u32 steps() const;
+
+};
+
+// Rebuilds a world from a trace, one step at a time
+class TracePlayer final
+{
+
+    std::ifstream m_file;
+    std::unique_ptr<Physics2D> m_world;
+    std::deque<std::vector<vec2>> m_positions; // Vertex arrays read from the trace, indexed by mesh
+    std::deque<std::vector<vec2>> m_normals;
+    std::vector<child_t> m_children;
+    u32 m_steps;
+
+    template <typename T>
+    bool read(T& value);
+    bool read_object();
+    object_t* object(u32 reference);
+
+public:
+
+    TracePlayer();
+    ~TracePlayer();
+
+    // Returns false when the file can't be read or was written by an incompatible build
+    bool open(const char* path);
+
+    // Applies the records up to the next step, returns false at the end of the trace
+    // The step itself is left to the caller so that it can be timed on its own
+    bool next();
+
+    Physics2D& world();
+    u32 steps() const;
+
+};
+
+}
+
+#endif // TRACE_HPP
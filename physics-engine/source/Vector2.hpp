@@ -4,6 +4,9 @@
 #include "Configuration.hpp"
 #include "Math.hpp"
 
+#include <type_traits>
+#include <ostream>
+
 namespace MATH_NAMESPACE
 {
 
@@ -18,8 +21,11 @@ struct v2_t
     T angle() const;
 
     v2_t<T> normalize() const;
+    v2_t<T> normalizeFast() const;
 
     v2_t<T> rotate(T radians) const;
+    v2_t<T> rotate(T sin, T cos) const;
+    v2_t<T> rotateFast(T radians) const;
     v2_t<T> rotateCW90() const;
     v2_t<T> rotateCCW90() const;
 
@@ -86,19 +92,19 @@ static inline void operator*=(v2_t<T>& left, v2_t<T> right)
 }
 
 template <typename T = precision_t>
-static inline v2_t<T> operator*(v2_t<T> left, T right)
+static inline v2_t<T> operator*(v2_t<T> left, scalar_t<T> right)
 {
     return {left.x * right, left.y * right};
 }
 
 template <typename T = precision_t>
-static inline v2_t<T> operator*(T left, v2_t<T> right)
+static inline v2_t<T> operator*(scalar_t<T> left, v2_t<T> right)
 {
     return {left * right.x, left * right.y};
 }
 
 template <typename T = precision_t>
-static inline void operator*=(v2_t<T>& left, T right)
+static inline void operator*=(v2_t<T>& left, scalar_t<T> right)
 {
     left.x *= right;
     left.y *= right;
@@ -118,13 +124,13 @@ static inline void operator/=(v2_t<T>& left, v2_t<T> right)
 }
 
 template <typename T = precision_t>
-static inline v2_t<T> operator/(v2_t<T> left, T right)
+static inline v2_t<T> operator/(v2_t<T> left, scalar_t<T> right)
 {
     return {left.x / right, left.y / right};
 }
 
 template <typename T = precision_t>
-static inline void operator/=(v2_t<T>& left, T right)
+static inline void operator/=(v2_t<T>& left, scalar_t<T> right)
 {
     left.x /= right;
     left.y /= right;
@@ -171,45 +177,64 @@ static inline std::ostream& operator<<(std::ostream& stream, v2_t<T> vec)
 
 /// Member functions implementation
 
-template<typename T = precision_t>
+template <typename T>
 inline T v2_t<T>::lengthSq() const
 {
     return (x * x) + (y * y);
 }
 
-template <typename T = precision_t>
+template <typename T>
 inline T v2_t<T>::length() const
 {
     return math::sqrt((x * x) + (y * y));
 }
 
-template <typename T = precision_t>
+template <typename T>
 inline T v2_t<T>::angle() const
 {
     return math::atan2(y, x);
 }
 
-template<typename T = precision_t>
+template <typename T>
 inline v2_t<T> v2_t<T>::normalize() const
 {
     return (*this) / length();
 }
 
-template <typename T = precision_t>
+template <typename T>
+inline v2_t<T> v2_t<T>::normalizeFast() const
+{
+    return (*this) * math::fast::rsqrt(lengthSq());
+}
+
+template <typename T>
 inline v2_t<T> v2_t<T>::rotate(T radians) const
 {
-    auto sin = math::sin(radians);
-    auto cos = math::cos(radians);
+    return rotate(math::sin(radians), math::cos(radians));
+}
+
+// Allows hoisting the trigonometry out of loops that rotate many vectors by the same angle
+template <typename T>
+inline v2_t<T> v2_t<T>::rotate(T sin, T cos) const
+{
     return {x * cos - y * sin, x * sin + y * cos};
 }
 
-template <typename T = precision_t>
+template <typename T>
+inline v2_t<T> v2_t<T>::rotateFast(T radians) const
+{
+    T sin, cos;
+    math::fast::sin_cos(radians, sin, cos);
+    return rotate(sin, cos);
+}
+
+template <typename T>
 inline v2_t<T> v2_t<T>::rotateCW90() const
 {
     return {y, -x};
 }
 
-template <typename T = precision_t>
+template <typename T>
 inline v2_t<T> v2_t<T>::rotateCCW90() const
 {
     return {-y, x};
@@ -0,0 +1,52 @@
+@ECHO OFF
+
+SET VcDir=C:\Program Files (x86)\Microsoft Visual Studio 14.0\VC\
+SET BuildDir=Y:\build\
+
+SET SrcDir=Y:\physics-engine\source\
+SET SrcFiles="%SrcDir%PhysicsC.cpp" "%SrcDir%Physics.cpp" "%SrcDir%Arena.cpp" "%SrcDir%AABBTree.cpp" "%SrcDir%Math.cpp" "%SrcDir%Mesh.cpp" "%SrcDir%Trace.cpp" "%SrcDir%Scene.cpp" "%SrcDir%DebugDraw.cpp"
+SET ObjFiles=PhysicsC.obj Physics.obj Arena.obj AABBTree.obj Math.obj Mesh.obj Trace.obj Scene.obj DebugDraw.obj
+SET DefFile=PhysicsC.def
+SET OutProgram=physics2d.dll
+
+REM Add /DPHYSICS_DOUBLE_PRECISION for large worlds, programs using PhysicsC.h must then define it too
+SET Preprocessor=/DNDEBUG
+SET ClFlags=/FC /nologo /Zi /O2 /EHsc
+SET LinkFlags=/nologo /DEBUG
+
+SET LinkLibs=
+
+if not defined DevEnvDir (
+  PUSHD "%VcDir%"
+    CALL vcvarsall.bat x86
+  POPD
+)
+
+if not exist "%BuildDir%" mkdir "%BuildDir%"
+
+PUSHD "%BuildDir%"
+
+  ECHO Compiling...
+  
+  cl %Preprocessor% %ClFlags% -c %SrcFiles%
+
+  if errorlevel 1 (
+    ECHO Compilation FAILED
+    GOTO FAILED
+  )
+
+  link %LinkFlags% /DLL /def:"%SrcDir%%DefFile%" %ObjFiles% %LinkLibs% /out:%OutProgram%
+  ECHO.
+
+  if errorlevel 1 (
+  	ECHO Link FAILED
+  	GOTO FAILED
+  )
+  
+  ECHO Compilation finished at %time%
+
+:FAILED
+
+POPD
+
+EXIT /b %errorlevel%
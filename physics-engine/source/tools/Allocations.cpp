@@ -0,0 +1,169 @@
+// Check that stepping a warmed up world never touches the heap
+// Usage: allocations [warm up steps] [checked steps]
+//   g++ -std=c++14 -O2 -DNDEBUG tools/Allocations.cpp Physics.cpp Arena.cpp AABBTree.cpp Math.cpp Mesh.cpp Trace.cpp Scene.cpp DebugDraw.cpp -o allocations
+// Builds a pile of bodies with a chain of joints and a vortex field and steps it once to measure the high water mark
+// of the step arenas, then steps the same scene again in a world that reserved it up front, as a game would
+// The allocations of the second run are counted after a few warm up steps that build the static tree and such,
+// exits with 2 when any step allocates
+// Unlike tools/Replay.cpp it needs no trace, so it can run as a check after every change to the step
+
+#include "../Configuration.hpp"
+#include "../Physics.hpp"
+#include "../Mesh.hpp"
+
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <new>
+
+using namespace PHYSICS_NAMESPACE;
+
+// Every allocation of the process goes through these, only the ones made by [simulate] are looked at
+static u64 allocations = 0;
+
+void* operator new(std::size_t size)
+{
+    ++allocations;
+    void* memory = std::malloc(size ? size : 1);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+constexpr u32 columns = 20;
+constexpr u32 rows = 15; // Alternating boxes and circles, 300 bodies
+constexpr u32 links = 12;
+
+static void build(Physics2D& world, gfx::Mesh& ground, gfx::Mesh& wall, gfx::Mesh& box, gfx::Mesh& link)
+{
+    const material_t material = {0.2F, 0.5F, 0.3F};
+    world.gravity() = {0.0F, -200.0F};
+
+    // Container, static because of the infinite density
+    world.add(transform_t {{320.0F, 0.0F}, 0.0F, 1.0F}, material, motion_t {}, math::infinity(),
+              ground.positions().data(), ground.normals().data(), ground.vertices());
+    world.add(transform_t {{0.0F, 300.0F}, 0.0F, 1.0F}, material, motion_t {}, math::infinity(),
+              wall.positions().data(), wall.normals().data(), wall.vertices());
+    world.add(transform_t {{640.0F, 300.0F}, 0.0F, 1.0F}, material, motion_t {}, math::infinity(),
+              wall.positions().data(), wall.normals().data(), wall.vertices());
+
+    for (u32 y = 0; y < rows; ++y)
+    {
+        for (u32 x = 0; x < columns; ++x)
+        {
+            vec2 position = {40.0F + x * 24.0F + (y & 1) * 10.0F, 40.0F + y * 24.0F};
+            if ((x + y) & 1)
+            {
+                world.add(transform_t {position, 0.0F, 1.0F}, material, motion_t {}, 1.0F, 10.0F);
+            }
+            else
+            {
+                world.add(transform_t {position, 0.1F * x, 1.0F}, material, motion_t {}, 1.0F,
+                          box.positions().data(), box.normals().data(), box.vertices());
+            }
+        }
+    }
+
+    // Chain hanging from the world above the pile, swinging into it
+    object_t* previous = nullptr;
+    for (u32 i = 0; i < links; ++i)
+    {
+        vec2 pin = {100.0F + i * 20.0F, 560.0F};
+        polygon_t* piece = world.add(transform_t {pin + vec2 {10.0F, 0.0F}, 0.0F, 1.0F}, material, motion_t {}, 1.0F,
+                                     link.positions().data(), link.normals().data(), link.vertices());
+        world.add(make_joint(joint_revolute, piece, previous, pin, pin));
+        previous = piece;
+    }
+
+    vec2 center = {320.0F, 200.0F};
+    world.add(force_field_t {field_vortex, aabb_t {center - vec2 {200.0F, 200.0F}, center + vec2 {200.0F, 200.0F}},
+                             center, {}, 2000.0F, 200.0F});
+}
+
+// Steps a freshly built world, counting the allocations made after the warm up
+struct run_t
+{
+    u64 warming;        // Allocations of the warm up
+    u64 total;          // Allocations of the checked steps
+    u32 allocating;     // Checked steps that allocated
+    u32 first;          // The first of them
+    arena_stats_t warm; // Arenas after the warm up
+    arena_stats_t end;
+};
+
+static run_t run(u32 warm_up, u32 steps, std::size_t reserve, gfx::Mesh* meshes)
+{
+    Physics2D world(columns * rows + links + 3, 1.0F / 120.0F);
+    if (reserve) world.reserve_arena(reserve);
+    build(world, meshes[0], meshes[1], meshes[2], meshes[3]);
+
+    run_t r = {};
+    u64 before = allocations;
+    for (u32 i = 0; i < warm_up; ++i) world.simulate();
+    r.warming = allocations - before;
+    r.warm = world.arena_stats();
+
+    // Steps are counted one by one so that the first one to allocate can be reported
+    for (u32 i = 0; i < steps; ++i)
+    {
+        before = allocations;
+        world.simulate();
+        u64 count = allocations - before;
+        if (count && !r.allocating++) r.first = i;
+        r.total += count;
+    }
+    r.end = world.arena_stats();
+    return r;
+}
+
+static void report(const char* name, u32 warm_up, u32 steps, const run_t& r)
+{
+    std::printf("%s\n", name);
+    std::printf("  warm up: %u steps, %llu allocations, arena high water %zu bytes, %u growths\n",
+                warm_up, (unsigned long long)r.warming, r.warm.high_water, r.warm.growths);
+    std::printf("  checked: %u steps, %llu allocations in %u steps, arena high water %zu bytes, %u growths\n",
+                steps, (unsigned long long)r.total, r.allocating, r.end.high_water, r.end.growths);
+}
+
+int main(int argc, char** argv)
+{
+    u32 warm_up = (argc > 1) ? u32(std::max(std::atoi(argv[1]), 0)) : 10;
+    u32 steps = (argc > 2) ? u32(std::max(std::atoi(argv[2]), 1)) : 1000;
+
+    gfx::Mesh meshes[] =
+    {
+        gfx::Mesh({vec2 {320.0F, 10.0F}, vec2 {-320.0F, 10.0F}, vec2 {-320.0F, -10.0F}, vec2 {320.0F, -10.0F}}),
+        gfx::Mesh({vec2 {10.0F, 300.0F}, vec2 {-10.0F, 300.0F}, vec2 {-10.0F, -300.0F}, vec2 {10.0F, -300.0F}}),
+        gfx::Mesh({vec2 {10.0F, 10.0F}, vec2 {-10.0F, 10.0F}, vec2 {-10.0F, -10.0F}, vec2 {10.0F, -10.0F}}),
+        gfx::Mesh({vec2 {10.0F, 3.0F}, vec2 {-10.0F, 3.0F}, vec2 {-10.0F, -3.0F}, vec2 {10.0F, -3.0F}})
+    };
+    std::printf("%u bodies, %u joints, 1 field\n", columns * rows + links + 3, links);
+
+    // The pile keeps gaining contacts until it settles, so no warm up is long enough for the arenas to stop
+    // growing on their own. Games reserve the high water mark of a representative run, the check does the same:
+    // the simulation is deterministic, the second run has the same steps as the first one
+    run_t measured = run(warm_up, steps, 0, meshes);
+    report("measuring run, arenas growing on demand", warm_up, steps, measured);
+    std::size_t reserve = measured.end.high_water;
+    run_t reserved = run(warm_up, steps, reserve, meshes);
+    std::printf("reserving %zu bytes per arena\n", reserve);
+    report("checked run", warm_up, steps, reserved);
+
+    if (reserved.allocating)
+    {
+        std::printf("FAILED: %u step(s) allocated, the first one %u steps after warming up\n", reserved.allocating, reserved.first);
+        return 2;
+    }
+    std::printf("OK: no step allocated\n");
+    return 0;
+}
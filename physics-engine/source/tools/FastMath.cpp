@@ -0,0 +1,134 @@
+// Accuracy and throughput of the math::fast approximations against the standard library
+// Usage: fastmath [count]
+//   g++ -std=c++14 -O2 -DNDEBUG tools/FastMath.cpp Math.cpp -o fastmath
+// Angles are drawn in [-1000, 1000] and rsqrt inputs in [1E-3, 1E6], the errors are measured against long double
+// Sine and cosine report the largest absolute error, rsqrt the largest relative error
+
+#include "../Configuration.hpp"
+#include "../Timer.hpp"
+#include "../Math.hpp"
+
+#include <cmath>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+using ld = long double;
+
+// Best time of a few runs of fn(), in millions of elements per second
+template <typename F>
+static f64 throughput(u32 count, F fn)
+{
+    f64 best = math::infinity<f64>();
+    for (u32 run = 0; run < 5; ++run)
+    {
+        Timer timer;
+        fn();
+        best = std::min(best, timer.elapsed());
+    }
+    return count / best * 1E-6;
+}
+
+// Keeps the compiler from dropping the loops whose results are never read
+volatile f64 sink;
+
+template <typename T>
+static void consume(const std::vector<T>& values)
+{
+    T sum = 0;
+    for (T value : values) sum += value;
+    sink = f64(sum);
+}
+
+template <typename T>
+static void report_sin_cos(const char* name, const std::vector<T>& theta, const std::vector<T>& sin, const std::vector<T>& cos, f64 mops)
+{
+    ld error = 0;
+    for (std::size_t i = 0; i < theta.size(); ++i)
+    {
+        ld x = ld(theta[i]);
+        error = std::max(error, std::fabs(std::sin(x) - ld(sin[i])));
+        error = std::max(error, std::fabs(std::cos(x) - ld(cos[i])));
+    }
+    std::printf("  %-22s max abs error %.2e  %8.1f Mops/s\n", name, f64(error), mops);
+}
+
+template <typename T>
+static void report_rsqrt(const char* name, const std::vector<T>& number, const std::vector<T>& result, f64 mops)
+{
+    ld error = 0;
+    for (std::size_t i = 0; i < number.size(); ++i)
+    {
+        ld exact = 1 / std::sqrt(ld(number[i]));
+        error = std::max(error, std::fabs(ld(result[i]) - exact) / exact);
+    }
+    std::printf("  %-22s max rel error %.2e  %8.1f Mops/s\n", name, f64(error), mops);
+}
+
+template <typename T>
+static void measure(const char* type, u32 count)
+{
+    std::vector<T> theta(count), number(count), sin(count), cos(count), result(count);
+    for (u32 i = 0; i < count; ++i)
+    {
+        theta[i] = math::random(T(-1000), T(1000));
+        number[i] = T(std::exp(math::random(std::log(1E-3), std::log(1E6))));
+    }
+
+    std::printf("%s\n", type);
+
+    f64 mops = throughput(count, [&]
+    {
+        for (u32 i = 0; i < count; ++i)
+        {
+            sin[i] = std::sin(theta[i]);
+            cos[i] = std::cos(theta[i]);
+        }
+        consume(sin);
+    });
+    report_sin_cos("libm sin + cos", theta, sin, cos, mops);
+
+    mops = throughput(count, [&]
+    {
+        for (u32 i = 0; i < count; ++i) math::fast::sin_cos(theta[i], sin[i], cos[i]);
+        consume(sin);
+    });
+    report_sin_cos("fast sin_cos", theta, sin, cos, mops);
+
+    mops = throughput(count, [&]
+    {
+        math::fast::sin_cos(theta.data(), sin.data(), cos.data(), count);
+        consume(sin);
+    });
+    report_sin_cos("fast sin_cos batch", theta, sin, cos, mops);
+
+    mops = throughput(count, [&]
+    {
+        for (u32 i = 0; i < count; ++i) result[i] = T(1) / std::sqrt(number[i]);
+        consume(result);
+    });
+    report_rsqrt("libm 1 / sqrt", number, result, mops);
+
+    mops = throughput(count, [&]
+    {
+        for (u32 i = 0; i < count; ++i) result[i] = math::fast::rsqrt(number[i]);
+        consume(result);
+    });
+    report_rsqrt("fast rsqrt", number, result, mops);
+
+    mops = throughput(count, [&]
+    {
+        math::fast::rsqrt(number.data(), result.data(), count);
+        consume(result);
+    });
+    report_rsqrt("fast rsqrt batch", number, result, mops);
+}
+
+int main(int argc, char** argv)
+{
+    u32 count = (argc > 1) ? u32(std::max(std::atoi(argv[1]), 16)) : 1000000;
+    measure<f32>("f32", count);
+    measure<f64>("f64", count);
+    return 0;
+}
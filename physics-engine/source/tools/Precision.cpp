@@ -0,0 +1,104 @@
+// Headless step timing of a pile of bodies, to compare the f32 and f64 builds of the engine
+// Usage: precision [steps] [runs]
+// Build it twice, with and without PHYSICS_DOUBLE_PRECISION, and run both on the same machine:
+//   g++ -std=c++14 -O2 -DNDEBUG tools/Precision.cpp Physics.cpp Arena.cpp AABBTree.cpp Math.cpp Mesh.cpp Trace.cpp Scene.cpp DebugDraw.cpp -o precision_f32
+//   g++ -std=c++14 -O2 -DNDEBUG -DPHYSICS_DOUBLE_PRECISION <same files> -o precision_f64
+// Prints the mean and median time of a step over the best run, and where the pile came to rest so that
+// the two builds can be checked to simulate the same thing
+
+#include "../Configuration.hpp"
+#include "../Timer.hpp"
+#include "../Physics.hpp"
+#include "../Mesh.hpp"
+
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace PHYSICS_NAMESPACE;
+
+constexpr u32 columns = 50;
+constexpr u32 rows = 30; // Alternating boxes and circles, 1500 bodies
+
+static void build(Physics2D& world, gfx::Mesh& ground, gfx::Mesh& wall, gfx::Mesh& box)
+{
+    const material_t material = {0.2F, 0.5F, 0.3F};
+    world.gravity() = {0.0F, -200.0F};
+
+    // Container, static because of the infinite density
+    world.add(transform_t {{640.0F, 0.0F}, 0.0F, 1.0F}, material, motion_t {}, math::infinity(),
+              ground.positions().data(), ground.normals().data(), ground.vertices());
+    world.add(transform_t {{0.0F, 600.0F}, 0.0F, 1.0F}, material, motion_t {}, math::infinity(),
+              wall.positions().data(), wall.normals().data(), wall.vertices());
+    world.add(transform_t {{1280.0F, 600.0F}, 0.0F, 1.0F}, material, motion_t {}, math::infinity(),
+              wall.positions().data(), wall.normals().data(), wall.vertices());
+
+    for (u32 y = 0; y < rows; ++y)
+    {
+        for (u32 x = 0; x < columns; ++x)
+        {
+            // Every other row is shifted so that the bodies don't stack in perfect columns
+            vec2 position = {40.0F + x * 24.0F + (y & 1) * 10.0F, 40.0F + y * 24.0F};
+            if ((x + y) & 1)
+            {
+                world.add(transform_t {position, 0.0F, 1.0F}, material, motion_t {}, 1.0F, 10.0F);
+            }
+            else
+            {
+                world.add(transform_t {position, 0.1F * x, 1.0F}, material, motion_t {}, 1.0F,
+                          box.positions().data(), box.normals().data(), box.vertices());
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    u32 steps = (argc > 1) ? u32(std::max(std::atoi(argv[1]), 1)) : 500;
+    u32 runs = (argc > 2) ? u32(std::max(std::atoi(argv[2]), 1)) : 3;
+
+    gfx::Mesh ground({vec2 {640.0F, 10.0F}, vec2 {-640.0F, 10.0F}, vec2 {-640.0F, -10.0F}, vec2 {640.0F, -10.0F}});
+    gfx::Mesh wall({vec2 {10.0F, 600.0F}, vec2 {-10.0F, 600.0F}, vec2 {-10.0F, -600.0F}, vec2 {10.0F, -600.0F}});
+    gfx::Mesh box({vec2 {10.0F, 10.0F}, vec2 {-10.0F, 10.0F}, vec2 {-10.0F, -10.0F}, vec2 {10.0F, -10.0F}});
+
+    // Keep the best time of every step over the runs to filter out noise from the machine
+    std::vector<f64> times(steps, math::infinity<f64>());
+    f64 height = 0.0;
+    f64 speed = 0.0;
+    for (u32 run = 0; run < runs; ++run)
+    {
+        Physics2D world(columns * rows + 3, 1.0F / 120.0F);
+        build(world, ground, wall, box);
+
+        Timer timer;
+        for (u32 i = 0; i < steps; ++i)
+        {
+            timer.reset();
+            world.simulate();
+            times[i] = std::min(times[i], timer.elapsed());
+        }
+
+        // Mean height and speed of the dynamic bodies, the same in both builds up to rounding
+        static f64 sums[2];
+        sums[0] = sums[1] = 0.0;
+        world.for_each_object([](const object_t& o)
+        {
+            if (o.body.i_mass == 0.0F) return;
+            sums[0] += f64(o.transform.position.y);
+            sums[1] += f64(o.motion.velocity.length());
+        });
+        height = sums[0] / world.entities();
+        speed = sums[1] / world.entities();
+    }
+
+    f64 total = 0.0;
+    for (f64 time : times) total += time;
+    std::vector<f64> sorted = times;
+    std::sort(sorted.begin(), sorted.end());
+
+    std::printf("precision_t: f%u, %u bodies, %u steps, %u run(s)\n", u32(sizeof(precision_t) * 8), columns * rows, steps, runs);
+    std::printf("mean %.3f ms/step, median %.3f ms/step\n", total / steps * 1E3, sorted[steps / 2] * 1E3);
+    std::printf("final mean height %.2f, mean speed %.2f\n", height, speed);
+    return 0;
+}
@@ -0,0 +1,132 @@
+// Headless replay of a Physics2D input trace
+// Usage: replay <trace> [worst steps to list] [runs]
+// Prints the time taken by every step, the slowest ones are marked and listed at the end
+// Also counts the heap allocations of every step, once the step arenas are large enough a step that doesn't
+// add objects must not allocate. Exits with 2 when one does, so the replay can be used as a check
+
+#include "../Configuration.hpp"
+#include "../Timer.hpp"
+#include "../Trace.hpp"
+
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <new>
+
+using namespace PHYSICS_NAMESPACE;
+
+// Every allocation of the process goes through these, only the ones made by [simulate] are looked at
+static u64 allocations = 0;
+
+void* operator new(std::size_t size)
+{
+    ++allocations;
+    void* memory = std::malloc(size ? size : 1);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::printf("usage: %s <trace> [worst steps to list] [runs]\n", argv[0]);
+        return 1;
+    }
+    u32 worst_c = (argc > 2) ? u32(std::atoi(argv[2])) : 10;
+    u32 runs = (argc > 3) ? u32(std::max(std::atoi(argv[3]), 1)) : 1;
+
+    // Keep the best time of every step over several runs to filter out noise from the machine
+    std::vector<f64> times;
+    std::vector<u32> allocated;
+    std::vector<bool> is_warm; // Neither the arenas nor the objects grew since the last step
+    arena_stats_t arena = {};
+    for (u32 run = 0; run < runs; ++run)
+    {
+        TracePlayer player;
+        if (!player.open(argv[1]))
+        {
+            std::printf("%s: not a trace, or recorded by an incompatible build\n", argv[1]);
+            return 1;
+        }
+
+        Timer timer;
+        u32 step = 0;
+        u32 entities = 0;
+        while (player.next())
+        {
+            // Objects added by the trace since the last step grow the arrays that follow the object count
+            Physics2D& world = player.world();
+            bool added = world.entities() != entities;
+            entities = world.entities();
+            u32 growths = world.arena_stats().growths;
+            u64 before = allocations;
+            timer.reset();
+            world.simulate();
+            f64 elapsed = timer.elapsed();
+            u32 count = u32(allocations - before);
+            bool warm = !added && (world.arena_stats().growths == growths);
+            if (step == times.size())
+            {
+                times.push_back(elapsed);
+                allocated.push_back(count);
+                is_warm.push_back(warm);
+            }
+            else
+            {
+                times[step] = std::min(times[step], elapsed);
+            }
+            ++step;
+        }
+        arena = player.world().arena_stats();
+    }
+    if (times.empty())
+    {
+        std::printf("%s: the trace has no steps\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<u32> order(times.size());
+    for (u32 i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&times](u32 a, u32 b) { return times[a] > times[b]; });
+    worst_c = std::min<u32>(worst_c, order.size());
+
+    std::vector<bool> is_worst(times.size(), false);
+    for (u32 i = 0; i < worst_c; ++i) is_worst[order[i]] = true;
+
+    f64 total = 0.0;
+    u32 unexpected = 0;
+    for (u32 i = 0; i < times.size(); ++i)
+    {
+        total += times[i];
+        if (allocated[i] && is_warm[i]) ++unexpected;
+        std::printf("%8u %10.3f ms %6u alloc%s\n", i, times[i] * 1E3, allocated[i], is_worst[i] ? "  <<<" : "");
+    }
+
+    std::vector<f64> sorted = times;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](f64 p) { return sorted[std::min<std::size_t>(sorted.size() - 1, std::size_t(p * sorted.size()))]; };
+
+    std::printf("\n%u steps, %u run(s)\n", u32(times.size()), runs);
+    std::printf("mean %.3f ms, median %.3f ms, p99 %.3f ms, max %.3f ms\n",
+                total / times.size() * 1E3, percentile(0.5) * 1E3, percentile(0.99) * 1E3, sorted.back() * 1E3);
+    std::printf("\nworst steps:\n");
+    for (u32 i = 0; i < worst_c; ++i)
+        std::printf("%8u %10.3f ms (%.1fx median)\n", order[i], times[order[i]] * 1E3, times[order[i]] / percentile(0.5));
+
+    // Reserve the high water mark with [Physics2D::reserve_arena] to avoid the growths altogether
+    std::printf("\narena: capacity %zu bytes, high water %zu bytes, %u growth(s)\n", arena.capacity, arena.high_water, arena.growths);
+    std::printf("steps allocating without growing: %u\n", unexpected);
+    return unexpected ? 2 : 0;
+}